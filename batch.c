@@ -0,0 +1,276 @@
+/* batch.c
+
+   Worker-Pool fuer das Offline-Rendern, siehe batch.h.
+
+   Die Queue enthaelt Job-Nummern (int), am Ende fuer jeden Worker ein
+   -1 als Ende-Marke. Grosse Dateien kommen zuerst in die Queue, damit
+   am Schluss nicht ein Worker allein an der laengsten Datei rechnet.
+   Ein Job schreibt nur in seinen eigenen Eintrag von l->job[], fertige
+   Worker melden sich ueber doneSema.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "batch.h"
+
+#if (PLATFORM==OS_LINUX)
+  #include <dirent.h>
+  #include <sys/stat.h>
+  #define BATCH_PATH_SEP '/'
+#endif
+#if (PLATFORM==OS_MS_WINDOWS)
+  #define BATCH_PATH_SEP '\\'
+#endif
+
+/* Daten, die sich alle Worker eines Laufs teilen */
+typedef struct
+{   batch_list_t *l;
+    const sRam_t *parameter;
+    PTL_queue_t q;
+    PTL_sem_t doneSema;
+} batch_pool_t;
+
+
+/*---------------------------------------------*/
+static PTL_THREAD_RET_TYPE BatchWorkerFunc(void *pt)
+{   batch_pool_t *pool = (batch_pool_t *)pt;
+    batch_job_t *job;
+    int k;
+
+    while (0 == PTL_QueueRead(&pool->q, 1, (char *)&k))
+    {   if (k < 0) break;    /* Ende-Marke */
+        job = &pool->l->job[k];
+        job->result = RenderWAVFile(job->inName, job->outName, pool->parameter, &job->st);
+    }
+    PTL_SemSignal(&pool->doneSema);
+    return 0;
+}
+
+/*---------------------------------------------*/
+/* Dateiname ohne Verzeichnis */
+static const char *base_name(const char *path)
+{   const char *p, *b = path;
+
+    for (p = path; *p; p++)
+        if ((*p == '/') || (*p == '\\')) b = p + 1;
+    return b;
+}
+
+/*---------------------------------------------*/
+static int has_wav_suffix(const char *name)
+{   size_t n = strlen(name);
+
+    return (n > 4) && (name[n-4] == '.')
+        && (tolower((unsigned char)name[n-3]) == 'w')
+        && (tolower((unsigned char)name[n-2]) == 'a')
+        && (tolower((unsigned char)name[n-1]) == 'v');
+}
+
+/*---------------------------------------------*/
+static long file_size(const char *name)
+{   FILE *fp = fopen(name, "rb");
+    long size = -1;
+
+    if (NULL != fp)
+    {   if (0 == fseek(fp, 0, SEEK_END)) size = ftell(fp);
+        fclose(fp);
+    }
+    return size;
+}
+
+/*---------------------------------------------*/
+/* Rueckgabe: 0 ok (oder doppelt, dann ohne neuen Job), -1 Fehler */
+static int add_job(batch_list_t *l, const char *inName, const char *outDir)
+{   batch_job_t *job;
+    int n;
+
+    if (l->nJobs == l->maxJobs)
+    {   n = (l->maxJobs > 0) ? 2 * l->maxJobs : 16;
+        job = realloc(l->job, n * sizeof(batch_job_t));
+        if (NULL == job)
+        {   puts("BatchAddInput: out of memory");
+            return -1;
+        }
+        l->job = job;
+        l->maxJobs = n;
+    }
+    job = &l->job[l->nJobs];
+    memset(job, 0, sizeof(batch_job_t));
+    n = snprintf(job->inName, BATCH_NAME_LEN, "%s", inName);
+    if ((n < 0) || (n >= BATCH_NAME_LEN)
+        || (0 > (n = snprintf(job->outName, BATCH_NAME_LEN, "%s%c%s",
+                              outDir, BATCH_PATH_SEP, base_name(inName))))
+        || (n >= BATCH_NAME_LEN))
+    {   printf("BatchAddInput: Pfad zu lang: %s\n", inName);
+        return -1;
+    }
+    for (n = 0; n < l->nJobs; n++)
+    {   if (0 == strcmp(l->job[n].outName, job->outName))
+        {   /* zwei Worker duerfen nicht dieselbe Datei schreiben */
+            printf("BatchAddInput: %s gibt es schon, %s uebersprungen\n", job->outName, inName);
+            return 0;
+        }
+    }
+    job->size = file_size(inName);
+    job->result = -1;
+    l->nJobs++;
+    return 0;
+}
+
+/*---------------------------------------------*/
+static int cmp_name(const void *a, const void *b)
+{
+    return strcmp(((const batch_job_t *)a)->inName, ((const batch_job_t *)b)->inName);
+}
+
+/*---------------------------------------------*/
+int BatchAddInput(batch_list_t *l, const char *path, const char *outDir)
+{   char name[BATCH_NAME_LEN];
+    int n0 = l->nJobs;
+  #if (PLATFORM==OS_LINUX)
+    struct stat sb;
+    struct dirent *de;
+    DIR *dir;
+
+    if ((0 != stat(path, &sb)) || !S_ISDIR(sb.st_mode))
+        return (0 == add_job(l, path, outDir)) ? l->nJobs - n0 : -1;
+
+    dir = opendir(path);
+    if (NULL == dir)
+    {   printf("BatchAddInput: cannot open %s\n", path);
+        return -1;
+    }
+    while (NULL != (de = readdir(dir)))
+    {   if (!has_wav_suffix(de->d_name)) continue;
+        snprintf(name, BATCH_NAME_LEN, "%s%c%s", path, BATCH_PATH_SEP, de->d_name);
+        if (0 != add_job(l, name, outDir))
+        {   closedir(dir);
+            return -1;
+        }
+    }
+    closedir(dir);
+  #endif
+
+  #if (PLATFORM==OS_MS_WINDOWS)
+    WIN32_FIND_DATA fd;
+    HANDLE h;
+    DWORD attr = GetFileAttributes(path);
+
+    if ((attr == INVALID_FILE_ATTRIBUTES) || !(attr & FILE_ATTRIBUTE_DIRECTORY))
+        return (0 == add_job(l, path, outDir)) ? l->nJobs - n0 : -1;
+
+    snprintf(name, BATCH_NAME_LEN, "%s%c*.wav", path, BATCH_PATH_SEP);
+    h = FindFirstFile(name, &fd);
+    if (h != INVALID_HANDLE_VALUE)
+    {   do
+        {   if ((fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || !has_wav_suffix(fd.cFileName))
+                continue;
+            snprintf(name, BATCH_NAME_LEN, "%s%c%s", path, BATCH_PATH_SEP, fd.cFileName);
+            if (0 != add_job(l, name, outDir))
+            {   FindClose(h);
+                return -1;
+            }
+        } while (FindNextFile(h, &fd));
+        FindClose(h);
+    }
+  #endif
+
+    /* Reihenfolge des Verzeichnisses ist zufaellig, nach Namen sortieren */
+    qsort(l->job + n0, l->nJobs - n0, sizeof(batch_job_t), cmp_name);
+    return l->nJobs - n0;
+}
+
+/*---------------------------------------------*/
+void BatchFree(batch_list_t *l)
+{
+    free(l->job);
+    l->job = NULL;
+    l->nJobs = 0;
+    l->maxJobs = 0;
+}
+
+/*---------------------------------------------*/
+/* Job-Nummern, groesste Datei zuerst */
+static const batch_list_t *sort_list;
+
+static int cmp_size_desc(const void *a, const void *b)
+{   long sa = sort_list->job[*(const int *)a].size;
+    long sb = sort_list->job[*(const int *)b].size;
+
+    if (sa != sb) return (sa < sb) ? 1 : -1;
+    return *(const int *)a - *(const int *)b;
+}
+
+/*---------------------------------------------*/
+int BatchRun(batch_list_t *l, int nWorkers, const sRam_t *parameter, batch_stats_t *st)
+{   batch_pool_t pool;
+    PTL_thread_t tid;
+    int *order;
+    int i, k, nStarted = 0, nFailed = 0;
+    double t0, t, audio = 0.0;
+
+    if (NULL != st) memset(st, 0, sizeof(batch_stats_t));
+    if (nWorkers <= 0) nWorkers = PTL_GetNumberOfCPUs();
+    if (nWorkers > BATCH_MAX_WORKERS) nWorkers = BATCH_MAX_WORKERS;
+    if ((l->nJobs > 0) && (nWorkers > l->nJobs)) nWorkers = l->nJobs;
+
+    order = malloc((l->nJobs + 1) * sizeof(int));
+    if (NULL == order)
+    {   puts("BatchRun: out of memory");
+        return -1;
+    }
+    for (i = 0; i < l->nJobs; i++) order[i] = i;
+    sort_list = l;
+    qsort(order, l->nJobs, sizeof(int), cmp_size_desc);
+
+    pool.l = l;
+    pool.parameter = parameter;
+    if (0 != PTL_QueueCreate(&pool.q, sizeof(int), l->nJobs + nWorkers))
+    {   puts("BatchRun: cannot create queue");
+        free(order);
+        return -1;
+    }
+    PTL_SemCreate(&pool.doneSema, 0);
+
+    /* alle Jobs und Ende-Marken vorab, die Queue ist gross genug */
+    PTL_QueueWrite(&pool.q, l->nJobs, (char *)order);
+    k = -1;
+    for (i = 0; i < nWorkers; i++) PTL_QueueWrite(&pool.q, 1, (char *)&k);
+
+    EQ_init_kernel();   /* nicht erst parallel in den Workern */
+    t0 = PTL_GetTime();
+    for (i = 0; i < nWorkers; i++)
+    {   if (0 != PTL_CreateThread(&tid, BatchWorkerFunc, &pool))
+        {   puts("BatchRun: error starting thread");
+            break;
+        }
+        nStarted++;
+    }
+    if (nStarted == 0)
+    {   /* ohne Worker selbst rechnen, die Ende-Marke beendet die Schleife */
+        BatchWorkerFunc(&pool);
+        nStarted = 1;
+    }
+    for (i = 0; i < nStarted; i++) PTL_SemWait(&pool.doneSema);
+    t = PTL_GetTime() - t0;
+
+    for (i = 0; i < l->nJobs; i++)
+    {   if (0 != l->job[i].result) nFailed++;
+        else audio += l->job[i].st.audio_seconds;
+    }
+    if (NULL != st)
+    {   st->nJobs = l->nJobs;
+        st->nFailed = nFailed;
+        st->nWorkers = nStarted;
+        st->seconds = t;
+        st->audio_seconds = audio;
+        st->realtime_factor = (t > 0.0) ? audio / t : 0.0;
+    }
+
+    PTL_SemDestroy(&pool.doneSema);
+    PTL_QueueDestroy(&pool.q);
+    free(order);
+    return (nFailed == 0) ? 0 : -1;
+}
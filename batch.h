@@ -0,0 +1,54 @@
+/* batch.h :
+   Viele WAV-Dateien offline rendern (render.h), verteilt auf einen
+   Pool von Worker-Threads. Die Jobs stehen in einer PTL-Queue, jeder
+   Worker holt sich den naechsten, sobald er frei ist. Jeder Job hat
+   seine eigene dsp_chain, die Einstellungen (*parameter) teilen sich
+   alle Worker nur lesend.
+*/
+
+#ifndef _batch_h_
+#define _batch_h_
+
+#include "render.h"
+
+#define BATCH_NAME_LEN    512  /* Pfadlaenge von Ein- und Ausgabedatei */
+#define BATCH_MAX_WORKERS 64
+
+/* eine Datei */
+typedef struct
+{   char inName[BATCH_NAME_LEN];
+    char outName[BATCH_NAME_LEN];
+    long size;                /* Dateigroesse in Byte, fuer die Reihenfolge */
+    int result;               /* 0: ok, -1: Fehler, wie RenderWAVFile() */
+    render_stats_t st;
+} batch_job_t;
+
+/* Liste der Jobs, mit BatchAddInput() fuellen, mit BatchFree() freigeben */
+typedef struct
+{   batch_job_t *job;
+    int nJobs;
+    int maxJobs;
+} batch_list_t;
+
+/* Ergebnis eines ganzen Laufs */
+typedef struct
+{   int nJobs;
+    int nFailed;
+    int nWorkers;
+    double seconds;           /* Wanduhrzeit vom Start bis zum letzten Job */
+    double audio_seconds;     /* Summe der Dateidauern */
+    double realtime_factor;   /* audio_seconds / seconds */
+} batch_stats_t;
+
+/* path ist eine WAV-Datei oder ein Verzeichnis, dann alle *.wav darin
+   (nicht rekursiv). Die Ausgabe landet unter gleichem Namen in outDir.
+   Rueckgabe: Anzahl neuer Jobs, -1 bei Fehler */
+int BatchAddInput(batch_list_t *l, const char *path, const char *outDir);
+void BatchFree(batch_list_t *l);
+
+/* alle Jobs mit nWorkers Threads rendern, nWorkers <= 0: einer pro CPU.
+   Ergebnis je Datei in l->job[i], zusammengefasst in *st (darf NULL sein).
+   Rueckgabe: 0 wenn alle Jobs ok, -1 sonst */
+int BatchRun(batch_list_t *l, int nWorkers, const sRam_t *parameter, batch_stats_t *st);
+
+#endif
@@ -0,0 +1,397 @@
+/* conv.c :
+   Faltungshall, siehe conv.h.
+
+   Je Kanal steht in in[] der vorherige Block (0 ... B-1) vor dem
+   aktuellen (B ... 2B-1), B = CONV_BLOCK. Ist der aktuelle Block voll,
+   wird sein Spektrum (FFT ueber beide Bloecke) an Stelle head der
+   Verzoegerungsleitung X abgelegt. Stueck p der Impulsantwort (B Werte,
+   mit B Nullen aufgefuellt) trifft auf das Spektrum von vor p Bloecken:
+
+     Y = sum_p H[p] * X[head - p]
+
+   Von der zyklischen Faltung der Laenge 2B ist nur die zweite Haelfte
+   gleich der linearen (overlap-save), sie wird waehrend des naechsten
+   Blocks ausgegeben.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ptl_lib.h"
+#include "snd_lib.h"
+#include "globals.h"
+#include "conv.h"
+
+#if defined(__SSE__)
+  #include <xmmintrin.h>
+#endif
+
+
+/*---------------------------------------------*/
+int CONV_make_ir(conv_ir_t *ir, const float *h_l, const float *h_r, int nFrames)
+{   float buf[CONV_FFT_SIZE];
+    const float *h;
+    int c, p, i, n, nCh = (NULL == h_r) ? 1 : 2;
+
+    memset(ir, 0, sizeof(conv_ir_t));
+    if ((nFrames < 1) || (nFrames > CONV_MAX_IR_FRAMES)) return -1;
+    if (0 != FFT_plan_create(&ir->plan, CONV_FFT_SIZE)) return -1;
+    ir->nFrames = nFrames;
+    ir->nParts = (nFrames + CONV_BLOCK - 1) / CONV_BLOCK;
+
+    for (c = 0; c < nCh; c++)
+    {   ir->H_re[c] = malloc(ir->nParts * CONV_BINS * sizeof(float));
+        ir->H_im[c] = malloc(ir->nParts * CONV_BINS * sizeof(float));
+        if ((NULL == ir->H_re[c]) || (NULL == ir->H_im[c]))
+        {   CONV_free_ir(ir);
+            return -1;
+        }
+        h = (c == 0) ? h_l : h_r;
+        for (p = 0; p < ir->nParts; p++)
+        {   n = nFrames - p * CONV_BLOCK;
+            if (n > CONV_BLOCK) n = CONV_BLOCK;
+            for (i = 0; i < n; i++) buf[i] = h[p * CONV_BLOCK + i];
+            for (; i < CONV_FFT_SIZE; i++) buf[i] = 0;
+            FFT_real_forward(&ir->plan, buf, ir->H_re[c] + p * CONV_BINS,
+                             ir->H_im[c] + p * CONV_BINS);
+        }
+    }
+    if (nCh == 1)
+    {   ir->H_re[1] = ir->H_re[0];
+        ir->H_im[1] = ir->H_im[0];
+    }
+    return 0;
+}
+
+/*---------------------------------------------*/
+void CONV_free_ir(conv_ir_t *ir)
+{
+    if (ir->H_re[1] != ir->H_re[0]) free(ir->H_re[1]);
+    if (ir->H_im[1] != ir->H_im[0]) free(ir->H_im[1]);
+    free(ir->H_re[0]);
+    free(ir->H_im[0]);
+    FFT_plan_destroy(&ir->plan);
+    memset(ir, 0, sizeof(conv_ir_t));
+}
+
+/*---------------------------------------------*/
+int CONV_load_ir(conv_ir_t *ir, const char *name)
+{   sndWaveHeader_t wh;
+    sndMono16_t m;
+    sndStereo16_t *x = NULL;
+    float *h = NULL;
+    FILE *fp;
+    long nFrames;
+    int i, ret = -1;
+
+    memset(ir, 0, sizeof(conv_ir_t));
+    fp = fopen(name, "rb");
+    if ((NULL == fp) || (0 != sndWAVReadFileHeader(fp, &wh)))
+    {   printf("cannot read %s\n", name);
+        if (NULL != fp) fclose(fp);
+        return -1;
+    }
+    if ((wh.nBitsPerSample != 16) || ((wh.nChannels != 1) && (wh.nChannels != 2)))
+    {   puts("sorry: Impulsantwort bitte als 16Bit Mono- oder Stereo-Datei");
+        fclose(fp);
+        return -1;
+    }
+    if (wh.nSamplesPerSec != F_S)
+    {   printf("Achtung: Impulsantwort hat %lu Hz, gespielt wird mit %d Hz\n",
+               (unsigned long)wh.nSamplesPerSec, F_S);
+    }
+    nFrames = (long)(wh.data_length / wh.nBytesPerSample);
+    if (nFrames > CONV_MAX_IR_FRAMES)
+    {   printf("Achtung: Impulsantwort auf %d Werte gekuerzt (hat %ld)\n",
+               CONV_MAX_IR_FRAMES, nFrames);
+        nFrames = CONV_MAX_IR_FRAMES;
+    }
+    if (nFrames < 1)
+    {   printf("%s: keine Sounddaten\n", name);
+        fclose(fp);
+        return -1;
+    }
+
+    /* links ab h[0], rechts ab h[nFrames] */
+    h = malloc(2 * nFrames * sizeof(float));
+    if ((NULL != h) && (wh.nChannels == 1))
+    {   for (i = 0; i < nFrames; i++)
+        {   if (0 != sndWAVReadSampleMono16(fp, &m)) break;
+            h[i] = m.val * (1.0f / 32768.0f);
+        }
+        nFrames = i;
+        if (nFrames > 0) ret = CONV_make_ir(ir, h, NULL, (int)nFrames);
+    }
+    else if (NULL != h)
+    {   x = malloc(nFrames * sizeof(sndStereo16_t));
+        if (NULL != x) nFrames = sndWAVReadBlockStereo16(fp, x, (int)nFrames);
+        for (i = 0; (NULL != x) && (i < nFrames); i++)
+        {   h[i]           = x[i].val_li * (1.0f / 32768.0f);
+            h[nFrames + i] = x[i].val_re * (1.0f / 32768.0f);
+        }
+        if ((NULL != x) && (nFrames > 0)) ret = CONV_make_ir(ir, h, h + nFrames, (int)nFrames);
+    }
+
+    if (0 != ret) printf("cannot load impulse response %s\n", name);
+    free(x);
+    free(h);
+    fclose(fp);
+    return ret;
+}
+
+/*---------------------------------------------*/
+void CONV_reset(conv_state_t *s)
+{
+    memset(s, 0, sizeof(conv_state_t));
+}
+
+/*---------------------------------------------*/
+/* Y += H * X, n komplexe Werte */
+static void cmac(float *Yr, float *Yi, const float *Hr, const float *Hi,
+                 const float *Xr, const float *Xi, int n)
+{   int k = 0;
+
+#if defined(__SSE__)
+    for (; k + 4 <= n; k += 4)
+    {   __m128 hr = _mm_loadu_ps(Hr + k), hi = _mm_loadu_ps(Hi + k);
+        __m128 xr = _mm_loadu_ps(Xr + k), xi = _mm_loadu_ps(Xi + k);
+        _mm_storeu_ps(Yr + k, _mm_add_ps(_mm_loadu_ps(Yr + k),
+                      _mm_sub_ps(_mm_mul_ps(hr, xr), _mm_mul_ps(hi, xi))));
+        _mm_storeu_ps(Yi + k, _mm_add_ps(_mm_loadu_ps(Yi + k),
+                      _mm_add_ps(_mm_mul_ps(hr, xi), _mm_mul_ps(hi, xr))));
+    }
+#endif
+    for (; k < n; k++)
+    {   Yr[k] += Hr[k] * Xr[k] - Hi[k] * Xi[k];
+        Yi[k] += Hr[k] * Xi[k] + Hi[k] * Xr[k];
+    }
+}
+
+/*---------------------------------------------*/
+/* Hall eines Kanals aus den letzten Spektren, zweite Haelfte nach y */
+static void conv_output(conv_state_t *s, const conv_ir_t *ir, int c, float *y)
+{   int p, slot;
+
+    memset(s->Y_re, 0, CONV_BINS * sizeof(float));
+    memset(s->Y_im, 0, CONV_BINS * sizeof(float));
+    for (p = 0, slot = s->head; p < ir->nParts; p++)
+    {   cmac(s->Y_re, s->Y_im, ir->H_re[c] + p * CONV_BINS, ir->H_im[c] + p * CONV_BINS,
+             s->X_re[c] + slot * CONV_BINS, s->X_im[c] + slot * CONV_BINS, CONV_BINS);
+        if (--slot < 0) slot = CONV_MAX_PARTS - 1;
+    }
+    FFT_real_inverse(&ir->plan, s->Y_re, s->Y_im, s->Y_re);
+    memcpy(y, s->Y_re + CONV_BLOCK, CONV_BLOCK * sizeof(float));
+}
+
+/*---------------------------------------------*/
+/* aktueller Block ist voll: Spektrum ablegen, Hall fuer den naechsten
+   Block rechnen, Bloecke weiterschieben. Neue Impulsantwort: der
+   naechste Block wird mit beiden gerechnet und uebergeblendet */
+static void conv_block(conv_state_t *s, const conv_ir_t *ir)
+{   float g, dg = 1.0f / CONV_BLOCK;
+    int c, i;
+
+    /* Verzoegerungsleitung immer ueber CONV_MAX_PARTS, damit die Spektren
+       auch fuer eine laengere neue Impulsantwort passen */
+    s->head = (s->head + 1) % CONV_MAX_PARTS;
+    for (c = 0; c < 2; c++)
+    {   FFT_real_forward(&ir->plan, s->in[c], s->X_re[c] + s->head * CONV_BINS,
+                         s->X_im[c] + s->head * CONV_BINS);
+        if ((NULL == s->ir) || (s->ir == ir))
+        {   conv_output(s, ir, c, s->out[c]);
+        }
+        else
+        {   conv_output(s, s->ir, c, s->out[c]);
+            conv_output(s, ir, c, s->Y_re);
+            for (i = 0; i < CONV_BLOCK; i++)
+            {   g = dg * (i+1);
+                s->out[c][i] += (s->Y_re[i] - s->out[c][i]) * g;
+            }
+        }
+        memcpy(s->in[c], s->in[c] + CONV_BLOCK, CONV_BLOCK * sizeof(float));
+    }
+    s->ir = ir;
+}
+
+/*---------------------------------------------*/
+/* y = dry * y + wet * Hall, dry und wet als Rampe ueber nFrames */
+static void conv_run(conv_state_t *s, const conv_ir_t *ir, float dry0, float dry1,
+                     float wet0, float wet1, float *y, int nFrames)
+{   float dd = (nFrames > 0) ? (dry1 - dry0) / nFrames : 0.0f;
+    float dw = (nFrames > 0) ? (wet1 - wet0) / nFrames : 0.0f;
+    float dry, wet, *inL, *inR, *outL, *outR;
+    int i, n, k = 0;
+
+    while (nFrames > 0)
+    {   n = CONV_BLOCK - s->fill;
+        if (n > nFrames) n = nFrames;
+        inL  = s->in[0] + CONV_BLOCK + s->fill;
+        inR  = s->in[1] + CONV_BLOCK + s->fill;
+        outL = s->out[0] + s->fill;
+        outR = s->out[1] + s->fill;
+        for (i = 0; i < n; i++)
+        {   k++;
+            dry = dry0 + dd * k;
+            wet = wet0 + dw * k;
+            inL[i] = y[2*i];
+            inR[i] = y[2*i+1];
+            y[2*i]   = dry * y[2*i]   + wet * outL[i];
+            y[2*i+1] = dry * y[2*i+1] + wet * outR[i];
+        }
+        y += 2*n;
+        nFrames -= n;
+        s->fill += n;
+        if (s->fill == CONV_BLOCK)
+        {   conv_block(s, ir);
+            s->fill = 0;
+        }
+    }
+}
+
+/*---------------------------------------------*/
+void CONV_process_block(conv_state_t *s, const conv_ir_t *ir, float wet0, float wet1,
+                        float *y, int nFrames)
+{
+    conv_run(s, ir, 1.0f, 1.0f, wet0, wet1, y, nFrames);
+}
+
+/*---------------------------------------------*/
+void CONV_mix_block(conv_state_t *s, const conv_ir_t *ir, float g0, float g1,
+                    float *y, int nFrames)
+{
+    conv_run(s, ir, 1.0f - g0, 1.0f - g1, g0, g1, y, nFrames);
+}
+
+
+/****************** Vergleich mit der direkten Faltung **********************/
+
+/* y[i] = sum_j hr[j] * x[i+j], i = 0 ... n-1, hr = Impulsantwort rueckwaerts,
+   x hat n+L-1 Werte (die L-1 Werte vor y[0] zuerst) */
+static void fir_direct(const float *hr, int L, const float *x, float *y, int n)
+{   float acc;
+    int i, j;
+
+    for (i = 0; i < n; i++)
+    {   const float *xi = x + i;
+        j = 0;
+        acc = 0;
+#if defined(__SSE__)
+        {   __m128 a = _mm_setzero_ps();
+            float t[4];
+            for (; j + 4 <= L; j += 4)
+                a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(hr + j), _mm_loadu_ps(xi + j)));
+            _mm_storeu_ps(t, a);
+            acc = (t[0] + t[1]) + (t[2] + t[3]);
+        }
+#endif
+        for (; j < L; j++) acc += hr[j] * xi[j];
+        y[i] = acc;
+    }
+}
+
+/* abklingendes Rauschen als Impulsantwort, Laenge nIR */
+static void make_test_ir(float *h, int nIR)
+{   int i;
+
+    srand(nIR);
+    for (i = 0; i < nIR; i++)
+        h[i] = ((float)rand() / RAND_MAX - 0.5f) * (float)exp(-4.0 * i / nIR) * 0.1f;
+}
+
+/*---------------------------------------------*/
+double CONV_check_accuracy(int nIR, int nFrames)
+{   conv_ir_t ir;
+    conv_state_t *s;
+    float *h, *x, *y;
+    double ref, err = 0, max = 0;
+    int i, j, c, t, n;
+
+    h = malloc(nIR * sizeof(float));
+    x = malloc(2 * nFrames * sizeof(float));
+    y = malloc(2 * nFrames * sizeof(float));
+    s = malloc(sizeof(conv_state_t));
+    if ((NULL != h) && (NULL != x)) make_test_ir(h, nIR);
+    if ((NULL == h) || (NULL == x) || (NULL == y) || (NULL == s)
+        || (0 != CONV_make_ir(&ir, h, NULL, nIR)))
+    {   free(h);  free(x);  free(y);  free(s);
+        return -1;
+    }
+    for (i = 0; i < 2*nFrames; i++) y[i] = x[i] = ((float)rand() / RAND_MAX - 0.5f) * 20000.0f;
+
+    /* ungerade Stueckelung, damit auch Bloecke ueber Aufrufgrenzen gehen */
+    CONV_reset(s);
+    for (i = 0; i < nFrames; i += n)
+    {   n = (nFrames - i < 100) ? nFrames - i : 100;
+        CONV_process_block(s, &ir, 1.0f, 1.0f, y + 2*i, n);
+    }
+
+    /* Erwartung: x[t] + sum_j h[j] * x[t-B-j], in double */
+    for (t = 0; t < nFrames; t++)
+        for (c = 0; c < 2; c++)
+        {   ref = x[2*t+c];
+            for (j = 0; (j < nIR) && (t - CONV_BLOCK - j >= 0); j++)
+                ref += (double)h[j] * x[2*(t - CONV_BLOCK - j) + c];
+            if (fabs(ref - y[2*t+c]) > err) err = fabs(ref - y[2*t+c]);
+            if (fabs(ref) > max) max = fabs(ref);
+        }
+
+    CONV_free_ir(&ir);
+    free(h);  free(x);  free(y);  free(s);
+    return (max > 0) ? err / max : err;
+}
+
+/*---------------------------------------------*/
+double CONV_benchmark(int nIR, int direct, double seconds)
+{   const int N = 1024;               /* Wertepaare je Durchlauf */
+    conv_ir_t ir;
+    conv_state_t *s = NULL;
+    float *h, *x, *y;
+    double t0, t;
+    long count = 0;
+    int i;
+
+    memset(&ir, 0, sizeof(ir));
+    h = malloc(nIR * sizeof(float));
+    x = malloc(2 * (N + nIR) * sizeof(float));
+    y = malloc(2 * N * sizeof(float));
+    if (!direct) s = malloc(sizeof(conv_state_t));
+    if ((NULL != h) && (NULL != x)) make_test_ir(h, nIR);
+    if ((NULL == h) || (NULL == x) || (NULL == y) || (!direct && (NULL == s))
+        || (!direct && (0 != CONV_make_ir(&ir, h, NULL, nIR))))
+    {   free(h);  free(x);  free(y);  free(s);
+        return -1;
+    }
+
+    for (i = 0; i < 2 * (N + nIR); i++) x[i] = ((float)rand() / RAND_MAX - 0.5f) * 20000.0f;
+    if (!direct)
+    {   CONV_reset(s);
+    }
+    else
+    {   /* rueckwaerts, damit die innere Schleife vorwaerts laeuft */
+        for (i = 0; i < nIR / 2; i++)
+        {   float v = h[i];
+            h[i] = h[nIR - 1 - i];
+            h[nIR - 1 - i] = v;
+        }
+    }
+
+    t0 = PTL_GetTime();
+    do
+    {   if (direct)
+        {   /* Kanaele getrennt: x[0...N+nIR-1] links, dahinter rechts */
+            fir_direct(h, nIR, x, y, N);
+            fir_direct(h, nIR, x + N + nIR, y + N, N);
+        }
+        else
+        {   memcpy(y, x, 2 * N * sizeof(float));
+            CONV_process_block(s, &ir, 0.5f, 0.5f, y, N);
+        }
+        count += N;
+        t = PTL_GetTime() - t0;
+    } while (t < seconds);
+
+    if (!direct) CONV_free_ir(&ir);
+    free(h);  free(x);  free(y);  free(s);
+    return 1e9 * t / count;
+}
@@ -0,0 +1,97 @@
+/* conv.h :
+   Faltungshall: das Signal wird mit einer gemessenen Impulsantwort
+   (16Bit-WAV, mono oder stereo) gefaltet.
+
+   Gleichmaessig partitioniert im Frequenzbereich (overlap-save): die
+   Impulsantwort wird in Stuecke zu CONV_BLOCK Werten zerlegt, jedes
+   Stueck einmal beim Laden transformiert. Pro CONV_BLOCK Eingangswerte
+   wird eine reelle FFT der Laenge 2*CONV_BLOCK gerechnet, ihr Spektrum
+   kommt in eine Verzoegerungsleitung von Spektren. Das Ausgangsspektrum
+   ist die Summe der Produkte aller Stuecke mit den passend verzoegerten
+   Eingangsspektren, zurueck mit einer inversen FFT.
+
+   Aufwand pro Wertepaar und Kanal: zwei FFTs, also O(log CONV_BLOCK),
+   plus eine komplexe Multiplikation je Stueck und Bin (Anzahl Stuecke
+   = Laenge / CONV_BLOCK). Eine direkte FIR-Faltung braucht dagegen eine
+   Multiplikation je Wert der Impulsantwort, siehe CONV_benchmark().
+
+   Latenz: genau CONV_BLOCK Wertepaare. Der Hall eines Blocks wird
+   waehrend des naechsten Blocks ausgegeben; das trockene Signal laeuft
+   unverzoegert daran vorbei, der Hall setzt also CONV_BLOCK spaeter ein.
+
+   Die Verzoegerungsleitung haengt nicht von der Impulsantwort ab. Eine
+   neue Impulsantwort wird daher ohne Loeschen des Zustands an der
+   naechsten Blockgrenze uebernommen, der Block danach wird mit alter
+   und neuer gerechnet und uebergeblendet.
+*/
+
+#ifndef _conv_h_
+#define _conv_h_
+
+#include "fft.h"
+
+#define CONV_BLOCK         256                 /* Latenz, ca. 5,8ms bei 44,1kHz */
+#define CONV_FFT_SIZE      (2*CONV_BLOCK)
+#define CONV_BINS          (CONV_BLOCK + 1)
+#define CONV_MAX_PARTS     512
+#define CONV_MAX_IR_FRAMES (CONV_MAX_PARTS * CONV_BLOCK)  /* knapp 3s */
+
+/* transformierte Impulsantwort. Wird nach dem Laden nur noch gelesen,
+   beliebig viele Ketten koennen sie gleichzeitig benutzen */
+typedef struct
+{   int nFrames;                /* Laenge der Impulsantwort */
+    int nParts;                 /* Stuecke zu CONV_BLOCK Werten */
+    fft_plan_t plan;            /* Laenge CONV_FFT_SIZE */
+    float *H_re[2], *H_im[2];   /* Spektrum von Stueck p ab [p*CONV_BINS],
+                                   mono: H_re[1] == H_re[0] */
+} conv_ir_t;
+
+/* Zustand fuer einen Stereo-Strom */
+typedef struct
+{   float in[2][CONV_FFT_SIZE];                /* vorheriger und aktueller Block */
+    float out[2][CONV_BLOCK];                  /* Hall des vorherigen Blocks */
+    float X_re[2][CONV_MAX_PARTS * CONV_BINS]; /* Spektren der letzten Bloecke */
+    float X_im[2][CONV_MAX_PARTS * CONV_BINS];
+    float Y_re[CONV_FFT_SIZE], Y_im[CONV_BINS]; /* Ausgangsspektrum */
+    int fill;                                  /* Werte im aktuellen Block */
+    int head;                                  /* neuestes Spektrum, mod CONV_MAX_PARTS */
+    const conv_ir_t *ir;                       /* Impulsantwort von out, NULL: noch keine */
+} conv_state_t;
+
+/* Impulsantwort aus einer 16Bit-WAV-Datei (mono oder stereo) laden,
+   laengere werden auf CONV_MAX_IR_FRAMES gekuerzt. Vollaussteuerung
+   entspricht 1.0. Rueckgabe: 0 fuer ok, -1 bei Fehler */
+int CONV_load_ir(conv_ir_t *ir, const char *name);
+
+/* Impulsantwort aus dem Speicher, h_r == NULL: mono.
+   Rueckgabe: 0 fuer ok, -1 bei Fehler */
+int CONV_make_ir(conv_ir_t *ir, const float *h_l, const float *h_r, int nFrames);
+
+void CONV_free_ir(conv_ir_t *ir);
+
+/* Zustand loeschen, vor jedem neuen Strom */
+void CONV_reset(conv_state_t *s);
+
+/* nFrames Wertepaare y (Links,Rechts abwechselnd) an Ort und Stelle:
+   y = y + wet * (y gefaltet mit ir), um CONV_BLOCK verzoegert. wet laeuft
+   ueber den Block linear von wet0 nach wet1 */
+void CONV_process_block(conv_state_t *s, const conv_ir_t *ir, float wet0, float wet1,
+                        float *y, int nFrames);
+
+/* wie CONV_process_block(), aber als Filter statt Hall:
+   y = (1-g) * y + g * (y gefaltet mit ir), g von g0 nach g1.
+   Mit g = 1 nur das gefilterte, um CONV_BLOCK verzoegerte Signal */
+void CONV_mix_block(conv_state_t *s, const conv_ir_t *ir, float g0, float g1,
+                    float *y, int nFrames);
+
+/* Rechenzeit in ns pro Wertepaar (stereo) fuer eine Impulsantwort der
+   Laenge nIR, direct != 0: direkte FIR-Faltung statt partitioniert.
+   Rueckgabe: -1 bei Fehler */
+double CONV_benchmark(int nIR, int direct, double seconds);
+
+/* groesste Abweichung der partitionierten von der direkten Faltung,
+   bezogen auf den groessten Ausgangswert, Zufallsdaten.
+   Rueckgabe: -1 bei Fehler */
+double CONV_check_accuracy(int nIR, int nFrames);
+
+#endif
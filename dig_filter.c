@@ -2,6 +2,7 @@
 #include <math.h>
 #include "dig_filter.h"
 #include "cplx.h"
+#include "globals.h"
 
 
 
@@ -80,88 +81,448 @@ IIR_2_coeff_t compute_HP_Filter_Parameters(double fo_Hz, double fa_Hz) {
     return HP_params;
 };
 
-float TP_filter_left(float x, IIR_2_coeff_t p)
+/*-------------------------------------------------------------*/
+/* weitere Entwuerfe 2. Ordnung fuer den parametrischen EQ      */
+/* (bilineare Transformation nach R. Bristow-Johnson,          */
+/*  Koeffizienten auf a0 = 1 normiert)                          */
+/*-------------------------------------------------------------*/
+static IIR_2_coeff_t _normalize(double b0, double b1, double b2,
+                                double a0, double a1, double a2)
 {
-    static float x1, x2, y0, y1, y2;
+    IIR_2_coeff_t p;
+
+    p.b0 = (float)(b0 / a0);
+    p.b1 = (float)(b1 / a0);
+    p.b2 = (float)(b2 / a0);
+    p.a1 = (float)(a1 / a0);
+    p.a2 = (float)(a2 / a0);
 
-    y0 = p.b0 * x + p.b1 * x1 + p.b2 * x2 - p.a1 * y1 - p.a2 * y2;
+    return p;
+}
 
-    x2 = x1;
-    x1 = x;
-    y2 = y1;
-    y1 = y0;
+/* Glocke: Anhebung/Absenkung um gain_dB bei f0_Hz, Breite ueber Q */
+IIR_2_coeff_t compute_Peak_Filter_Parameters(double f0_Hz, double Q, double gain_dB, double fa_Hz) {
+    double A, w, cw, alpha;
 
-    return (y0);
+    A = pow(10.0, gain_dB / 40.0);
+    w = 2 * M_PI * f0_Hz / fa_Hz;
+    cw = cos(w);
+    alpha = sin(w) / (2 * Q);
+
+    return _normalize(1 + alpha * A, -2 * cw, 1 - alpha * A,
+                      1 + alpha / A, -2 * cw, 1 - alpha / A);
+};
+
+/* Kuhschwanz unten: Frequenzen unterhalb f0_Hz um gain_dB veraendern */
+IIR_2_coeff_t compute_LowShelf_Filter_Parameters(double f0_Hz, double Q, double gain_dB, double fa_Hz) {
+    double A, w, cw, beta;
+
+    A = pow(10.0, gain_dB / 40.0);
+    w = 2 * M_PI * f0_Hz / fa_Hz;
+    cw = cos(w);
+    beta = 2 * sqrt(A) * sin(w) / (2 * Q);
+
+    return _normalize(A * ((A + 1) - (A - 1) * cw + beta),
+                      2 * A * ((A - 1) - (A + 1) * cw),
+                      A * ((A + 1) - (A - 1) * cw - beta),
+                      (A + 1) + (A - 1) * cw + beta,
+                      -2 * ((A - 1) + (A + 1) * cw),
+                      (A + 1) + (A - 1) * cw - beta);
+};
+
+/* Kuhschwanz oben: Frequenzen oberhalb f0_Hz um gain_dB veraendern */
+IIR_2_coeff_t compute_HighShelf_Filter_Parameters(double f0_Hz, double Q, double gain_dB, double fa_Hz) {
+    double A, w, cw, beta;
+
+    A = pow(10.0, gain_dB / 40.0);
+    w = 2 * M_PI * f0_Hz / fa_Hz;
+    cw = cos(w);
+    beta = 2 * sqrt(A) * sin(w) / (2 * Q);
+
+    return _normalize(A * ((A + 1) + (A - 1) * cw + beta),
+                      -2 * A * ((A - 1) + (A + 1) * cw),
+                      A * ((A + 1) + (A - 1) * cw - beta),
+                      (A + 1) - (A - 1) * cw + beta,
+                      2 * ((A - 1) - (A + 1) * cw),
+                      (A + 1) - (A - 1) * cw - beta);
+};
+
+/* Kerbfilter: Nullstelle bei f0_Hz, Breite ueber Q */
+IIR_2_coeff_t compute_Notch_Filter_Parameters(double f0_Hz, double Q, double fa_Hz) {
+    double w, cw, alpha;
+
+    w = 2 * M_PI * f0_Hz / fa_Hz;
+    cw = cos(w);
+    alpha = sin(w) / (2 * Q);
+
+    return _normalize(1, -2 * cw, 1,
+                      1 + alpha, -2 * cw, 1 - alpha);
+};
+
+/*-------------------------------------------------------------*/
+/* Filter 2. Ordnung mit explizitem Zustand                    */
+/*-------------------------------------------------------------*/
+void IIR_2_reset(IIR_2_state_t *s)
+{
+    s->x1 = 0;
+    s->x2 = 0;
+    s->y1 = 0;
+    s->y2 = 0;
 }
 
-float TP_filter_right(float x, IIR_2_coeff_t p)
+float IIR_2_filter(IIR_2_state_t *s, const IIR_2_coeff_t *p, float x)
 {
-    static float x1, x2, y0, y1, y2;
+    double y0;
 
-    y0 = p.b0 * x + p.b1 * x1 + p.b2 * x2 - p.a1 * y1 - p.a2 * y2;
+    y0 = (double)p->b0 * x + (double)p->b1 * s->x1 + (double)p->b2 * s->x2
+         - (double)p->a1 * s->y1 - (double)p->a2 * s->y2;
 
-    x2 = x1;
-    x1 = x;
-    y2 = y1;
-    y1 = y0;
+    s->x2 = s->x1;
+    s->x1 = x;
+    s->y2 = s->y1;
+    s->y1 = y0;
 
-    return (y0);
+    return ((float)y0);
 }
 
-float BP_filter_left(float x, IIR_2_coeff_t p)
+void IIR_2_filter_block(IIR_2_state_t *s, const IIR_2_coeff_t *p,
+                        const float *x, float *y, int n)
 {
-    static float x1, x2, y0, y1, y2;
+    double b0 = p->b0, b1 = p->b1, b2 = p->b2, a1 = p->a1, a2 = p->a2;
+    double x1 = s->x1, x2 = s->x2, y1 = s->y1, y2 = s->y2;
+    double x0, y0;
+    int i;
+
+    /* Zustand und Koeffizienten in Registern halten, gerechnet in double */
+    for (i = 0; i < n; i++) {
+        x0 = x[i];
+        y0 = b0 * x0 + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = y0;
+        y[i] = (float)y0;
+    }
+
+    s->x1 = x1;
+    s->x2 = x2;
+    s->y1 = y1;
+    s->y2 = y2;
+}
+
+void EQ_reset(EQ_state_t *s)
+{   int c;
 
-    y0 = p.b0 * x + p.b1 * x1 + p.b2 * x2 - p.a1 * y1 - p.a2 * y2;
+    for (c = 0; c < 2; c++) {
+        IIR_2_reset(&s->TP[c]);
+        IIR_2_reset(&s->BP[c]);
+        IIR_2_reset(&s->HP[c]);
+    }
+}
 
-    x2 = x1;
-    x1 = x;
-    y2 = y1;
-    y1 = y0;
+#define EQ_CHUNK 256   /* Teilbloecke, damit die Hilfsfelder auf den Stack passen */
 
-    return (y0);
+void EQ_filter_block_scalar(EQ_state_t *s, const IIR_2_coeff_t *p_TP, const IIR_2_coeff_t *p_BP,
+                     const IIR_2_coeff_t *p_HP, float A_TP, float A_BP, float A_HP, float B,
+                     const short *x, float *y, int nFrames)
+{
+    float xc[EQ_CHUNK], tp[EQ_CHUNK], bp[EQ_CHUNK], hp[EQ_CHUNK];
+    int i, c, n, done;
+
+    for (done = 0; done < nFrames; done += n) {
+        n = nFrames - done;
+        if (n > EQ_CHUNK) n = EQ_CHUNK;
+        for (c = 0; c < 2; c++) {
+            /* Kanal aus dem Stereo-Block holen, drei Filter je ueber den Teilblock */
+            for (i = 0; i < n; i++) xc[i] = x[2*(done+i) + c];
+            IIR_2_filter_block(&s->TP[c], p_TP, xc, tp, n);
+            IIR_2_filter_block(&s->BP[c], p_BP, xc, bp, n);
+            IIR_2_filter_block(&s->HP[c], p_HP, xc, hp, n);
+            for (i = 0; i < n; i++)
+                y[2*(done+i) + c] = (xc[i] + tp[i] * A_TP + bp[i] * A_BP + hp[i] * A_HP) * B;
+        }
+    }
 }
 
-float BP_filter_right(float x, IIR_2_coeff_t p)
+/*-------------------------------------------------------------*/
+/* Auswahl des EQ-Rechenkerns (SIMD-Kerne in dig_filter_simd.c) */
+/*-------------------------------------------------------------*/
+typedef void (*EQ_kernel_t)(EQ_state_t *s, const IIR_2_coeff_t *p_TP, const IIR_2_coeff_t *p_BP,
+                            const IIR_2_coeff_t *p_HP, float A_TP, float A_BP, float A_HP, float B,
+                            const short *x, float *y, int nFrames);
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define EQ_HAVE_X86_SIMD 1
+  void EQ_filter_block_sse(EQ_state_t *s, const IIR_2_coeff_t *p_TP, const IIR_2_coeff_t *p_BP,
+                           const IIR_2_coeff_t *p_HP, float A_TP, float A_BP, float A_HP, float B,
+                           const short *x, float *y, int nFrames);
+  void EQ_filter_block_avx(EQ_state_t *s, const IIR_2_coeff_t *p_TP, const IIR_2_coeff_t *p_BP,
+                           const IIR_2_coeff_t *p_HP, float A_TP, float A_BP, float A_HP, float B,
+                           const short *x, float *y, int nFrames);
+#else
+  #define EQ_HAVE_X86_SIMD 0
+#endif
+
+static EQ_kernel_t EQ_kernel = 0;   /* 0: beim ersten Aufruf auswaehlen */
+
+int EQ_select_kernel(int kernel)
 {
-    static float x1, x2, y0, y1, y2;
+#if EQ_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (kernel == EQ_KERNEL_AUTO) {
+        if (__builtin_cpu_supports("avx"))      kernel = EQ_KERNEL_AVX;
+        else if (__builtin_cpu_supports("sse2")) kernel = EQ_KERNEL_SSE;
+        else                                    kernel = EQ_KERNEL_SCALAR;
+    }
+    if ((kernel == EQ_KERNEL_AVX) && __builtin_cpu_supports("avx")) {
+        EQ_kernel = EQ_filter_block_avx;
+        return EQ_KERNEL_AVX;
+    }
+    if ((kernel == EQ_KERNEL_SSE) && __builtin_cpu_supports("sse2")) {
+        EQ_kernel = EQ_filter_block_sse;
+        return EQ_KERNEL_SSE;
+    }
+#endif
+    (void)kernel;
+    EQ_kernel = EQ_filter_block_scalar;
+    return EQ_KERNEL_SCALAR;
+}
 
-    y0 = p.b0 * x + p.b1 * x1 + p.b2 * x2 - p.a1 * y1 - p.a2 * y2;
+void EQ_init_kernel(void)
+{
+    if (EQ_kernel == 0) EQ_select_kernel(EQ_KERNEL_AUTO);
+}
 
-    x2 = x1;
-    x1 = x;
-    y2 = y1;
-    y1 = y0;
+const char *EQ_kernel_name(int kernel)
+{
+    switch (kernel) {
+        case EQ_KERNEL_SCALAR: return "scalar";
+        case EQ_KERNEL_SSE:    return "sse";
+        case EQ_KERNEL_AVX:    return "avx";
+        default:               return "auto";
+    }
+}
 
-    return (y0);
+void EQ_filter_block(EQ_state_t *s, const IIR_2_coeff_t *p_TP, const IIR_2_coeff_t *p_BP,
+                     const IIR_2_coeff_t *p_HP, float A_TP, float A_BP, float A_HP, float B,
+                     const short *x, float *y, int nFrames)
+{
+    EQ_init_kernel();
+    EQ_kernel(s, p_TP, p_BP, p_HP, A_TP, A_BP, A_HP, B, x, y, nFrames);
 }
 
-float HP_filter_left(float x, IIR_2_coeff_t p)
+/*-------------------------------------------------------------*/
+/* Rechenzeit der Kerne                                        */
+/*-------------------------------------------------------------*/
+double EQ_benchmark(int kernel, double seconds, float *maxDiff)
+{   static short x[2*EQ_BENCH_FRAMES];
+    static float y[2*EQ_BENCH_FRAMES], y_ref[2*EQ_BENCH_FRAMES];
+    EQ_kernel_t old = EQ_kernel;
+    IIR_2_coeff_t tp, bp, hp;
+    EQ_state_t s;
+    unsigned int r = 1;
+    double t0, t;
+    long count = 0;
+    float d, dmax = 0;
+    int i;
+
+    /* Rauschen mit festem Startwert, Einstellung wie nach dem Start der GUI */
+    for (i = 0; i < 2*EQ_BENCH_FRAMES; i++) {
+        r = r * 1103515245u + 12345u;
+        x[i] = (short)((int)(r >> 16) - 32768);
+    }
+    tp = compute_TP_Filter_Parameters(300.0, F_S);
+    bp = compute_BP_Filter_Parameters(1000.0, 2.0, F_S);
+    hp = compute_HP_Filter_Parameters(5000.0, F_S);
+
+    EQ_reset(&s);
+    EQ_filter_block_scalar(&s, &tp, &bp, &hp, 0.5f, 1.0f, 0.5f, 0.5f, x, y_ref, EQ_BENCH_FRAMES);
+    if (EQ_select_kernel(kernel) != kernel) {
+        EQ_kernel = old;
+        return -1;
+    }
+    EQ_reset(&s);
+    EQ_filter_block(&s, &tp, &bp, &hp, 0.5f, 1.0f, 0.5f, 0.5f, x, y, EQ_BENCH_FRAMES);
+    for (i = 0; i < 2*EQ_BENCH_FRAMES; i++) {
+        d = fabsf(y[i] - y_ref[i]);
+        if (d > dmax) dmax = d;
+    }
+    if (NULL != maxDiff) *maxDiff = dmax;
+
+    t0 = PTL_GetTime();
+    do {
+        EQ_filter_block(&s, &tp, &bp, &hp, 0.5f, 1.0f, 0.5f, 0.5f, x, y, EQ_BENCH_FRAMES);
+        count += EQ_BENCH_FRAMES;
+        t = PTL_GetTime() - t0;
+    } while (t < seconds);
+
+    EQ_kernel = old;
+    return count / t;
+}
+
+/*-------------------------------------------------------------*/
+/* Frequenzgang                                                */
+/*-------------------------------------------------------------*/
+/* H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2), z = e^jw */
+static cplx IIR_2_H(IIR_2_coeff_t p, cplx z1, cplx z2)
 {
-    static float x1, x2, y0, y1, y2;
+    cplx num, den;
+
+    num = c_add(make_cplx(p.b0, 0),
+                c_add(c_mult(make_cplx(p.b1, 0), z1), c_mult(make_cplx(p.b2, 0), z2)));
+    den = c_add(make_cplx(1, 0),
+                c_add(c_mult(make_cplx(p.a1, 0), z1), c_mult(make_cplx(p.a2, 0), z2)));
+    return c_div(num, den);
+}
 
-    y0 = p.b0 * x + p.b1 * x1 + p.b2 * x2 - p.a1 * y1 - p.a2 * y2;
+/* Equalizer: H_ges = (1 + A_TP*H_TP + A_BP*H_BP + A_HP*H_HP) * B */
+float H_ges_dB(IIR_2_coeff_t p_TP, IIR_2_coeff_t p_BP, IIR_2_coeff_t p_HP,
+               float A_TP, float A_BP, float A_HP, float B, float f_Hz, float fa_Hz)
+{
+    cplx z1, z2, H;
+    double w, mag;
 
-    x2 = x1;
-    x1 = x;
-    y2 = y1;
-    y1 = y0;
+    w = 2 * M_PI * f_Hz / fa_Hz;
+    z1 = c_exp(make_cplx(0, -w));
+    z2 = c_exp(make_cplx(0, -2 * w));
 
-    return (y0);
+    H = make_cplx(1, 0);
+    H = c_add(H, c_mult(make_cplx(A_TP, 0), IIR_2_H(p_TP, z1, z2)));
+    H = c_add(H, c_mult(make_cplx(A_BP, 0), IIR_2_H(p_BP, z1, z2)));
+    H = c_add(H, c_mult(make_cplx(A_HP, 0), IIR_2_H(p_HP, z1, z2)));
+    mag = betrag(H) * B;
+
+    if (mag < 1e-10) mag = 1e-10;   /* -200dB statt -inf */
+    return (float)(20 * log10(mag));
 }
 
-float HP_filter_right(float x, IIR_2_coeff_t p)
+int H_sweep_init_log(H_sweep_t *sw, int n, float f_lo_Hz, float f_hi_Hz, float fa_Hz)
 {
-    static float x1, x2, y0, y1, y2;
+    double r, f, w;
+    int i;
+
+    if ((n < 2) || (n > H_SWEEP_MAX_POINTS) || (f_lo_Hz <= 0) || (f_hi_Hz <= f_lo_Hz) || (fa_Hz <= 0))
+        return -1;
+
+    sw->n = n;
+    sw->fa_Hz = fa_Hz;
+    r = pow(f_hi_Hz / f_lo_Hz, 1.0 / (n - 1));
+    for (i = 0; i < n; i++) {
+        f = f_lo_Hz * pow(r, i);
+        w = 2 * M_PI * f / fa_Hz;
+        sw->f_Hz[i] = (float)f;
+        sw->c1[i] = (float)cos(w);
+        sw->s1[i] = (float)sin(w);
+        sw->c2[i] = (float)cos(2 * w);
+        sw->s2[i] = (float)sin(2 * w);
+    }
+    return 0;
+}
 
-    y0 = p.b0 * x + p.b1 * x1 + p.b2 * x2 - p.a1 * y1 - p.a2 * y2;
+void IIR_2_response_sweep(const H_sweep_t *sw, const IIR_2_coeff_t *p, float *H_re, float *H_im)
+{
+    float b0 = p->b0, b1 = p->b1, b2 = p->b2, a1 = p->a1, a2 = p->a2;
+    float nr, ni, dr, di, d2;
+    int i;
+
+    /* z^-1 = c1 - j s1, z^-2 = c2 - j s2; H = N * conj(D) / |D|^2 */
+    for (i = 0; i < sw->n; i++) {
+        nr = b0 + b1 * sw->c1[i] + b2 * sw->c2[i];
+        ni = -(b1 * sw->s1[i] + b2 * sw->s2[i]);
+        dr = 1 + a1 * sw->c1[i] + a2 * sw->c2[i];
+        di = -(a1 * sw->s1[i] + a2 * sw->s2[i]);
+        d2 = dr * dr + di * di;
+        H_re[i] = (nr * dr + ni * di) / d2;
+        H_im[i] = (ni * dr - nr * di) / d2;
+    }
+}
 
-    x2 = x1;
-    x1 = x;
-    y2 = y1;
-    y1 = y0;
+void IIR_2_mag2_sweep_mul(const H_sweep_t *sw, const IIR_2_coeff_t *p, float *mag2)
+{
+    float b0 = p->b0, b1 = p->b1, b2 = p->b2, a1 = p->a1, a2 = p->a2;
+    float nr, ni, dr, di;
+    int i;
+
+    for (i = 0; i < sw->n; i++) {
+        nr = b0 + b1 * sw->c1[i] + b2 * sw->c2[i];
+        ni = b1 * sw->s1[i] + b2 * sw->s2[i];
+        dr = 1 + a1 * sw->c1[i] + a2 * sw->c2[i];
+        di = a1 * sw->s1[i] + a2 * sw->s2[i];
+        mag2[i] *= (nr * nr + ni * ni) / (dr * dr + di * di);
+    }
+}
 
-    return (y0);
+void H_ges_dB_sweep(const H_sweep_t *sw, const IIR_2_coeff_t *p_TP, const IIR_2_coeff_t *p_BP,
+                    const IIR_2_coeff_t *p_HP, float A_TP, float A_BP, float A_HP, float B,
+                    float *H_dB)
+{
+    float re[H_SWEEP_MAX_POINTS], im[H_SWEEP_MAX_POINTS];
+    float h_re[H_SWEEP_MAX_POINTS], h_im[H_SWEEP_MAX_POINTS];
+    float m;
+    int i;
+
+    for (i = 0; i < sw->n; i++) {
+        re[i] = 1;
+        im[i] = 0;
+    }
+
+    IIR_2_response_sweep(sw, p_TP, h_re, h_im);
+    for (i = 0; i < sw->n; i++) {
+        re[i] += A_TP * h_re[i];
+        im[i] += A_TP * h_im[i];
+    }
+    IIR_2_response_sweep(sw, p_BP, h_re, h_im);
+    for (i = 0; i < sw->n; i++) {
+        re[i] += A_BP * h_re[i];
+        im[i] += A_BP * h_im[i];
+    }
+    IIR_2_response_sweep(sw, p_HP, h_re, h_im);
+    for (i = 0; i < sw->n; i++) {
+        re[i] += A_HP * h_re[i];
+        im[i] += A_HP * h_im[i];
+    }
+
+    /* 20*log10(|H|*B) = 10*log10(|H|^2*B^2) */
+    for (i = 0; i < sw->n; i++) {
+        m = (re[i] * re[i] + im[i] * im[i]) * B * B;
+        if (m < 1e-20f) m = 1e-20f;
+        H_dB[i] = 10 * log10f(m);
+    }
+}
+
+/*-------------------------------------------------------------*/
+/* alte Einzelwert-Schnittstelle mit je einem Modul-Zustand     */
+/*-------------------------------------------------------------*/
+static IIR_2_state_t TP_left, TP_right, BP_left, BP_right, HP_left, HP_right;
+
+float TP_filter_left(float x, IIR_2_coeff_t p)
+{
+    return IIR_2_filter(&TP_left, &p, x);
+}
+
+float TP_filter_right(float x, IIR_2_coeff_t p)
+{
+    return IIR_2_filter(&TP_right, &p, x);
+}
+
+float BP_filter_left(float x, IIR_2_coeff_t p)
+{
+    return IIR_2_filter(&BP_left, &p, x);
+}
+
+float BP_filter_right(float x, IIR_2_coeff_t p)
+{
+    return IIR_2_filter(&BP_right, &p, x);
+}
+
+float HP_filter_left(float x, IIR_2_coeff_t p)
+{
+    return IIR_2_filter(&HP_left, &p, x);
+}
+
+float HP_filter_right(float x, IIR_2_coeff_t p)
+{
+    return IIR_2_filter(&HP_right, &p, x);
 }
 
 float EQ_filter_left(float x, IIR_2_coeff_t p_TP, IIR_2_coeff_t p_BP, IIR_2_coeff_t p_HP,
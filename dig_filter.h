@@ -6,11 +6,85 @@ typedef struct
 {   float a1, a2, b0, b1, b2;
 } IIR_2_coeff_t;
 
+/* Zustand (Vergangenheitswerte) eines Filters 2. Ordnung.
+   Jeder Kanal jedes Stroms braucht sein eigenes Zustandsobjekt.
+   Die Rueckkopplung rechnet in double: bei Polen nahe z=1 verstaerkt sie
+   das Rundungsrauschen um bis zu 1/(1-r)^2, in float waeren das schnell
+   einige LSB (siehe RenderParallelTolerance() in render.h) */
+typedef struct
+{   double x1, x2, y1, y2;
+} IIR_2_state_t;
+
+/* Zustand des Equalizers (TP, BP, HP parallel) fuer einen Stereo-Strom,
+   Index 0: links, 1: rechts */
+typedef struct
+{   IIR_2_state_t TP[2], BP[2], HP[2];
+} EQ_state_t;
+
 void print_IIR_2_coeff(IIR_2_coeff_t p);
 IIR_2_coeff_t compute_TP_Filter_Parameters(double fu_Hz, double fa_Hz);
 IIR_2_coeff_t compute_BP_Filter_Parameters(double f0_Hz, double Q, double fa_Hz);
 IIR_2_coeff_t compute_HP_Filter_Parameters(double fo_Hz, double fa_Hz);
+IIR_2_coeff_t compute_Peak_Filter_Parameters(double f0_Hz, double Q, double gain_dB, double fa_Hz);
+IIR_2_coeff_t compute_LowShelf_Filter_Parameters(double f0_Hz, double Q, double gain_dB, double fa_Hz);
+IIR_2_coeff_t compute_HighShelf_Filter_Parameters(double f0_Hz, double Q, double gain_dB, double fa_Hz);
+IIR_2_coeff_t compute_Notch_Filter_Parameters(double f0_Hz, double Q, double fa_Hz);
+
+void  IIR_2_reset(IIR_2_state_t *s);
+float IIR_2_filter(IIR_2_state_t *s, const IIR_2_coeff_t *p, float x);
+void  IIR_2_filter_block(IIR_2_state_t *s, const IIR_2_coeff_t *p,
+                         const float *x, float *y, int n);
+
+void  EQ_reset(EQ_state_t *s);
+/* Equalizer fuer einen Block von nFrames Stereo-Wertepaaren,
+   x und y liegen abwechselnd Links,Rechts; y = EQ_filter_left/right */
+void  EQ_filter_block(EQ_state_t *s,
+                      const IIR_2_coeff_t *p_TP,
+                      const IIR_2_coeff_t *p_BP,
+                      const IIR_2_coeff_t *p_HP,
+                      float A_TP,
+                      float A_BP,
+                      float A_HP,
+                      float B,
+                      const short *x,
+                      float *y,
+                      int nFrames);
 
+/* Rechenkern fuer EQ_filter_block(), Auswahl zur Laufzeit */
+#define EQ_KERNEL_AUTO    0   /* bester Kern, den die CPU kann */
+#define EQ_KERNEL_SCALAR  1   /* Referenz, auf jeder Plattform */
+#define EQ_KERNEL_SSE     2   /* x86: 6 Filter in 3x2 Lanes double */
+#define EQ_KERNEL_AVX     3   /* x86: 6 Filter in 2x4 Lanes double */
+
+int   EQ_select_kernel(int kernel);   /* Rueckgabe: gewaehlter Kern */
+void  EQ_init_kernel(void);          /* EQ_KERNEL_AUTO, falls noch keiner gewaehlt;
+                                        vor dem Start paralleler Threads aufrufen */
+const char *EQ_kernel_name(int kernel);
+
+/* skalare Referenz, immer verfuegbar */
+void  EQ_filter_block_scalar(EQ_state_t *s,
+                      const IIR_2_coeff_t *p_TP,
+                      const IIR_2_coeff_t *p_BP,
+                      const IIR_2_coeff_t *p_HP,
+                      float A_TP,
+                      float A_BP,
+                      float A_HP,
+                      float B,
+                      const short *x,
+                      float *y,
+                      int nFrames);
+
+/* Rechenzeit von EQ_filter_block() mit dem Kern kernel (EQ_KERNEL_...),
+   seconds lang auf Bloecken von EQ_BENCH_FRAMES Wertepaaren, fuer jeden
+   Kern dasselbe Rauschen und dieselbe Einstellung. *maxDiff (darf NULL
+   sein): groesste Abweichung des ersten Blocks gegen die skalare Referenz.
+   Der vorher gewaehlte Kern bleibt gewaehlt.
+   Rueckgabe: Wertepaare je Sekunde, -1 wenn die CPU den Kern nicht kann */
+#define EQ_BENCH_FRAMES 4096
+double EQ_benchmark(int kernel, double seconds, float *maxDiff);
+
+/* alte Einzelwert-Schnittstelle: ein gemeinsamer Zustand pro Funktion,
+   daher nur fuer genau einen Strom in genau einem Thread */
 float TP_filter_left (float x, IIR_2_coeff_t p);
 float TP_filter_right(float x, IIR_2_coeff_t p);
 
@@ -50,5 +124,42 @@ float H_ges_dB(IIR_2_coeff_t p_TP,
                      float f_Hz,
                      float fa_Hz);
 
+/* Frequenzgang fuer viele Frequenzen auf einmal.
+   Die Stuetzstellen werden einmal festgelegt, cos/sin von w und 2w
+   liegen dann als Felder vor; die Auswertung selbst sind reine
+   float-Schleifen ueber alle Punkte, die der Compiler vektorisiert. */
+#define H_SWEEP_MAX_POINTS 1024
+
+typedef struct
+{   int   n;                           /* Anzahl Punkte */
+    float fa_Hz;                       /* Abtastfrequenz */
+    float f_Hz[H_SWEEP_MAX_POINTS];
+    float c1[H_SWEEP_MAX_POINTS], s1[H_SWEEP_MAX_POINTS]; /* cos(w), sin(w) */
+    float c2[H_SWEEP_MAX_POINTS], s2[H_SWEEP_MAX_POINTS]; /* cos(2w), sin(2w) */
+} H_sweep_t;
+
+/* n Punkte logarithmisch von f_lo_Hz bis f_hi_Hz.
+   Rueckgabe: 0 fuer ok, -1 bei ungueltigen Parametern */
+int   H_sweep_init_log(H_sweep_t *sw, int n, float f_lo_Hz, float f_hi_Hz, float fa_Hz);
+
+/* komplexer Frequenzgang eines Filters 2. Ordnung an allen Punkten */
+void  IIR_2_response_sweep(const H_sweep_t *sw, const IIR_2_coeff_t *p,
+                           float *H_re, float *H_im);
+
+/* |H|^2 eines Filters 2. Ordnung an allen Punkten mit mag2 multiplizieren
+   (Kaskaden: mag2 vorher mit 1 fuellen) */
+void  IIR_2_mag2_sweep_mul(const H_sweep_t *sw, const IIR_2_coeff_t *p, float *mag2);
+
+/* H_ges_dB() an allen Punkten des Sweeps */
+void  H_ges_dB_sweep(const H_sweep_t *sw,
+                     const IIR_2_coeff_t *p_TP,
+                     const IIR_2_coeff_t *p_BP,
+                     const IIR_2_coeff_t *p_HP,
+                     float A_TP,
+                     float A_BP,
+                     float A_HP,
+                     float B,
+                     float *H_dB);
+
 
 #endif
@@ -0,0 +1,208 @@
+/* dig_filter_simd.c :
+   Vektorisierte Equalizer-Kerne fuer EQ_filter_block().
+
+   Die sechs Filter 2. Ordnung eines Stereo-Equalizers (TP, BP, HP je
+   links und rechts) sind voneinander unabhaengig. Sie werden hier in
+   die Lanes von SIMD-Registern gelegt, gerechnet wird wie in der
+   skalaren Referenz in double:
+
+       Lane:   0     1     2     3     4     5     6  7
+              TP_l  TP_r  BP_l  BP_r  HP_l  HP_r   -  -
+
+   SSE2 nimmt je zwei Lanes in ein Register (drei Register), AVX je vier
+   (zwei Register, die letzten beiden Lanes leer). Pro Wertepaar werden
+   dann nur noch drei bzw. zwei Differenzengleichungen gerechnet statt
+   sechs. Die Reihenfolge der Rechenoperationen entspricht der skalaren
+   Referenz IIR_2_filter_block(), die Ergebnisse sind gleich.
+
+   Die Kerne werden nur fuer x86 mit gcc/clang uebersetzt, die Auswahl
+   (SSE2 oder AVX) erfolgt zur Laufzeit in dig_filter.c.
+*/
+
+#include "dig_filter.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+
+/*-------------------------------------------------------------*/
+/* Koeffizienten und Zustand in Lane-Reihenfolge umsortieren    */
+/*-------------------------------------------------------------*/
+static void _lanes_coeff(const IIR_2_coeff_t *p_TP, const IIR_2_coeff_t *p_BP,
+                         const IIR_2_coeff_t *p_HP, double c[5][8])
+{   const IIR_2_coeff_t *p[3];
+    int k, ch;
+
+    p[0] = p_TP;
+    p[1] = p_BP;
+    p[2] = p_HP;
+    for (k = 0; k < 3; k++) {
+        for (ch = 0; ch < 2; ch++) {
+            c[0][2*k+ch] = p[k]->b0;
+            c[1][2*k+ch] = p[k]->b1;
+            c[2][2*k+ch] = p[k]->b2;
+            c[3][2*k+ch] = p[k]->a1;
+            c[4][2*k+ch] = p[k]->a2;
+        }
+    }
+    for (k = 0; k < 5; k++) {
+        c[k][6] = 0;
+        c[k][7] = 0;
+    }
+}
+
+static void _lanes_load_state(const EQ_state_t *s, double z[4][8])
+{   const IIR_2_state_t *st[6];
+    int l;
+
+    st[0] = &s->TP[0]; st[1] = &s->TP[1];
+    st[2] = &s->BP[0]; st[3] = &s->BP[1];
+    st[4] = &s->HP[0]; st[5] = &s->HP[1];
+    for (l = 0; l < 6; l++) {
+        z[0][l] = st[l]->x1;
+        z[1][l] = st[l]->x2;
+        z[2][l] = st[l]->y1;
+        z[3][l] = st[l]->y2;
+    }
+    for (l = 6; l < 8; l++) {
+        z[0][l] = z[1][l] = z[2][l] = z[3][l] = 0;
+    }
+}
+
+static void _lanes_store_state(EQ_state_t *s, double z[4][8])
+{   IIR_2_state_t *st[6];
+    int l;
+
+    st[0] = &s->TP[0]; st[1] = &s->TP[1];
+    st[2] = &s->BP[0]; st[3] = &s->BP[1];
+    st[4] = &s->HP[0]; st[5] = &s->HP[1];
+    for (l = 0; l < 6; l++) {
+        st[l]->x1 = z[0][l];
+        st[l]->x2 = z[1][l];
+        st[l]->y1 = z[2][l];
+        st[l]->y2 = z[3][l];
+    }
+}
+
+
+/*-------------------------------------------------------------*/
+/* SSE2: drei Register mit je 2 Lanes (TP, BP, HP)             */
+/*-------------------------------------------------------------*/
+__attribute__((target("sse2")))
+void EQ_filter_block_sse(EQ_state_t *s, const IIR_2_coeff_t *p_TP, const IIR_2_coeff_t *p_BP,
+                         const IIR_2_coeff_t *p_HP, float A_TP, float A_BP, float A_HP, float B,
+                         const short *x, float *y, int nFrames)
+{
+    double c[5][8], z[4][8];
+    double y0v[8] __attribute__((aligned(16)));
+    __m128d b0[3], b1[3], b2[3], a1[3], a2[3], x1[3], x2[3], y1[3], y2[3];
+    __m128d xv, yv;
+    float xl, xr;
+    int i, k;
+
+    _lanes_coeff(p_TP, p_BP, p_HP, c);
+    _lanes_load_state(s, z);
+
+    for (k = 0; k < 3; k++) {
+        b0[k] = _mm_loadu_pd(&c[0][2*k]);
+        b1[k] = _mm_loadu_pd(&c[1][2*k]);
+        b2[k] = _mm_loadu_pd(&c[2][2*k]);
+        a1[k] = _mm_loadu_pd(&c[3][2*k]);
+        a2[k] = _mm_loadu_pd(&c[4][2*k]);
+        x1[k] = _mm_loadu_pd(&z[0][2*k]);
+        x2[k] = _mm_loadu_pd(&z[1][2*k]);
+        y1[k] = _mm_loadu_pd(&z[2][2*k]);
+        y2[k] = _mm_loadu_pd(&z[3][2*k]);
+    }
+
+    for (i = 0; i < nFrames; i++) {
+        xl = x[2*i];
+        xr = x[2*i+1];
+        xv = _mm_setr_pd(xl, xr);
+
+        /* y0 = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2, je Filter beide Kanaele */
+        for (k = 0; k < 3; k++) {
+            yv = _mm_sub_pd(_mm_sub_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(b0[k], xv), _mm_mul_pd(b1[k], x1[k])),
+                                                  _mm_mul_pd(b2[k], x2[k])),
+                                       _mm_mul_pd(a1[k], y1[k])),
+                            _mm_mul_pd(a2[k], y2[k]));
+            x2[k] = x1[k]; x1[k] = xv; y2[k] = y1[k]; y1[k] = yv;
+            _mm_store_pd(&y0v[2*k], yv);
+        }
+
+        y[2*i]   = (xl + (float)y0v[0] * A_TP + (float)y0v[2] * A_BP + (float)y0v[4] * A_HP) * B;
+        y[2*i+1] = (xr + (float)y0v[1] * A_TP + (float)y0v[3] * A_BP + (float)y0v[5] * A_HP) * B;
+    }
+
+    for (k = 0; k < 3; k++) {
+        _mm_storeu_pd(&z[0][2*k], x1[k]);
+        _mm_storeu_pd(&z[1][2*k], x2[k]);
+        _mm_storeu_pd(&z[2][2*k], y1[k]);
+        _mm_storeu_pd(&z[3][2*k], y2[k]);
+    }
+    _lanes_store_state(s, z);
+}
+
+
+/*-------------------------------------------------------------*/
+/* AVX: zwei Register mit je 4 Lanes (0..3 und 4..7)           */
+/*-------------------------------------------------------------*/
+__attribute__((target("avx")))
+void EQ_filter_block_avx(EQ_state_t *s, const IIR_2_coeff_t *p_TP, const IIR_2_coeff_t *p_BP,
+                         const IIR_2_coeff_t *p_HP, float A_TP, float A_BP, float A_HP, float B,
+                         const short *x, float *y, int nFrames)
+{
+    double c[5][8], z[4][8];
+    double y0v[8] __attribute__((aligned(32)));
+    __m256d b0a, b1a, b2a, a1a, a2a, b0b, b1b, b2b, a1b, a2b;
+    __m256d x1a, x2a, y1a, y2a, x1b, x2b, y1b, y2b;
+    __m256d xa, xb, ya, yb;
+    float xl, xr;
+    int i;
+
+    _lanes_coeff(p_TP, p_BP, p_HP, c);
+    _lanes_load_state(s, z);
+
+    b0a = _mm256_loadu_pd(&c[0][0]); b0b = _mm256_loadu_pd(&c[0][4]);
+    b1a = _mm256_loadu_pd(&c[1][0]); b1b = _mm256_loadu_pd(&c[1][4]);
+    b2a = _mm256_loadu_pd(&c[2][0]); b2b = _mm256_loadu_pd(&c[2][4]);
+    a1a = _mm256_loadu_pd(&c[3][0]); a1b = _mm256_loadu_pd(&c[3][4]);
+    a2a = _mm256_loadu_pd(&c[4][0]); a2b = _mm256_loadu_pd(&c[4][4]);
+    x1a = _mm256_loadu_pd(&z[0][0]); x1b = _mm256_loadu_pd(&z[0][4]);
+    x2a = _mm256_loadu_pd(&z[1][0]); x2b = _mm256_loadu_pd(&z[1][4]);
+    y1a = _mm256_loadu_pd(&z[2][0]); y1b = _mm256_loadu_pd(&z[2][4]);
+    y2a = _mm256_loadu_pd(&z[3][0]); y2b = _mm256_loadu_pd(&z[3][4]);
+
+    for (i = 0; i < nFrames; i++) {
+        xl = x[2*i];
+        xr = x[2*i+1];
+        xa = _mm256_setr_pd(xl, xr, xl, xr);
+        xb = _mm256_setr_pd(xl, xr, 0, 0);
+
+        /* y0 = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2, alle Lanes zugleich */
+        ya = _mm256_sub_pd(_mm256_sub_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(b0a, xa), _mm256_mul_pd(b1a, x1a)),
+                                                       _mm256_mul_pd(b2a, x2a)),
+                                         _mm256_mul_pd(a1a, y1a)),
+                           _mm256_mul_pd(a2a, y2a));
+        yb = _mm256_sub_pd(_mm256_sub_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(b0b, xb), _mm256_mul_pd(b1b, x1b)),
+                                                       _mm256_mul_pd(b2b, x2b)),
+                                         _mm256_mul_pd(a1b, y1b)),
+                           _mm256_mul_pd(a2b, y2b));
+        x2a = x1a; x1a = xa; y2a = y1a; y1a = ya;
+        x2b = x1b; x1b = xb; y2b = y1b; y1b = yb;
+
+        _mm256_store_pd(&y0v[0], ya);
+        _mm256_store_pd(&y0v[4], yb);
+        y[2*i]   = (xl + (float)y0v[0] * A_TP + (float)y0v[2] * A_BP + (float)y0v[4] * A_HP) * B;
+        y[2*i+1] = (xr + (float)y0v[1] * A_TP + (float)y0v[3] * A_BP + (float)y0v[5] * A_HP) * B;
+    }
+
+    _mm256_storeu_pd(&z[0][0], x1a); _mm256_storeu_pd(&z[0][4], x1b);
+    _mm256_storeu_pd(&z[1][0], x2a); _mm256_storeu_pd(&z[1][4], x2b);
+    _mm256_storeu_pd(&z[2][0], y1a); _mm256_storeu_pd(&z[2][4], y1b);
+    _mm256_storeu_pd(&z[3][0], y2a); _mm256_storeu_pd(&z[3][4], y2b);
+    _lanes_store_state(s, z);
+}
+
+#endif /* x86 und gcc/clang */
@@ -0,0 +1,402 @@
+/* dsp_chain.c
+
+   Die Kette aus dsp_chain.h, bisher process_block() im Player.
+   Das Signal bleibt zwischen den Stufen float und wird erst am Ende
+   einmal von DSP_float_to_s16() gerundet; DSP_chain_process_float()
+   ueberlaesst das dem Aufrufer.
+*/
+
+#include <math.h>
+#include <string.h>
+#include "dsp_chain.h"
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+/*---------------------------------------------*/
+void DSP_chain_reset(dsp_chain_t *c)
+{
+    EQ_reset(&c->eq);
+    CONV_reset(&c->fir);
+    PEQ_reset(&c->peq);
+    echo_reset(&c->echo);
+    CONV_reset(&c->conv);
+    c->seed = 0x12345678u;    /* gleiches Rauschen bei jedem Durchlauf */
+    c->cur_valid = 0;
+    c->alpha = (float)(1.0 - exp(-DSP_SMOOTH_FRAMES / (DSP_SMOOTH_MS * 1e-3 * F_S)));
+}
+
+/*---------------------------------------------*/
+/* n Werte TPDF-Rauschen, Differenz zweier gleichverteilter Zufallszahlen,
+   -1...+1 LSB, Zufallsgenerator xorshift32 */
+static void make_dither(dsp_chain_t *c, int n)
+{   unsigned int r = c->seed, u1;
+    int i;
+
+    for (i=0; i<n; i++) {
+        r ^= r << 13;  r ^= r >> 17;  r ^= r << 5;
+        u1 = r;
+        r ^= r << 13;  r ^= r >> 17;  r ^= r << 5;
+        c->dither[i] = (float)(int)((u1 >> 8) - (r >> 8)) * (1.0f / 16777216.0f);
+    }
+    c->seed = r;
+}
+
+/*---------------------------------------------*/
+void DSP_float_to_s16(const float *x, short *y, int n, float gain, const float *dither)
+{   float v;
+    int i = 0;
+
+#if defined(__SSE2__)
+    /* cvtps2dq rundet wie lrintf(), packs begrenzt auf 16 Bit; vorher auf
+       +-32768 begrenzen, damit die int32-Wandlung nicht ueberlaeuft */
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 hi = _mm_set1_ps(32768.0f), lo = _mm_set1_ps(-32768.0f);
+    __m128 a, b;
+
+    for (; i+8 <= n; i += 8) {
+        a = _mm_mul_ps(_mm_loadu_ps(x+i), g);
+        b = _mm_mul_ps(_mm_loadu_ps(x+i+4), g);
+        if (dither) {
+            a = _mm_add_ps(a, _mm_loadu_ps(dither+i));
+            b = _mm_add_ps(b, _mm_loadu_ps(dither+i+4));
+        }
+        a = _mm_max_ps(_mm_min_ps(a, hi), lo);
+        b = _mm_max_ps(_mm_min_ps(b, hi), lo);
+        _mm_storeu_si128((__m128i *)(y+i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+#endif
+    for (; i < n; i++) {
+        v = x[i] * gain;
+        if (dither) v += dither[i];
+        if (v > 32767.0f) v = 32767.0f;
+        if (v < -32768.0f) v = -32768.0f;
+        y[i] = (short)lrintf(v);
+    }
+}
+
+/*---------------------------------------------*/
+/* Vorgabe aus dem shared RAM; ausgeschaltete Stufen als durchlaessige
+   Einstellung, damit sie ausgeblendet werden koennen. fir: neuester
+   Entwurf des FIR-Equalizers oder NULL, bis dahin rechnet TP/BP/HP */
+static void make_target(const dsp_chain_t *c, const sRam_t *parameter,
+                        const conv_ir_t *fir, dsp_params_t *t)
+{   int k, n;
+
+    t->fir_on  = parameter->flag_EQ_is_active && parameter->flag_EQ_linear_phase && (NULL != fir);
+    t->eq_on   = parameter->flag_EQ_is_active && !t->fir_on;
+    t->peq_on  = parameter->flag_PEQ_is_active;
+    t->echo_on = parameter->flag_Echo_is_active;
+    t->conv_on = parameter->flag_Conv_is_active && (NULL != parameter->Conv_IR);
+    t->dither  = parameter->flag_dither;
+    t->TP = parameter->TP;
+    t->BP = parameter->BP;
+    t->HP = parameter->HP;
+    t->A_TP = t->eq_on ? parameter->A_TP : 0.0f;
+    t->A_BP = t->eq_on ? parameter->A_BP : 0.0f;
+    t->A_HP = t->eq_on ? parameter->A_HP : 0.0f;
+    t->B_eq = t->eq_on ? parameter->B : 1.0f;
+    t->Fir_IR = fir;
+    t->Fir_g  = t->fir_on ? 1.0f : 0.0f;
+
+    if (t->peq_on) t->PEQ = parameter->PEQ;
+    else {
+        t->PEQ.nBands = c->cur_valid ? c->cur.PEQ.nBands : parameter->PEQ.nBands;
+        for (k=0; k<t->PEQ.nBands; k++) {
+            t->PEQ.b0[k] = 1.0f;
+            t->PEQ.b1[k] = t->PEQ.b2[k] = t->PEQ.a1[k] = t->PEQ.a2[k] = 0.0f;
+        }
+    }
+
+    /* Taps, die wegfallen, mit gain 0 stehen lassen, bis sie ausgeblendet sind */
+    t->Echo = parameter->Echo;
+    n = (c->cur_valid && (c->cur.Echo.nTaps > t->Echo.nTaps)) ? c->cur.Echo.nTaps : t->Echo.nTaps;
+    for (k=t->Echo.nTaps; k<n; k++) {
+        t->Echo.tap[k] = c->cur.Echo.tap[k];
+        t->Echo.tap[k].gain = 0.0f;
+    }
+    t->Echo.nTaps = n;
+    if (!t->echo_on)
+        for (k=0; k<n; k++) t->Echo.tap[k].gain = 0.0f;
+
+    t->Conv_IR  = parameter->Conv_IR;
+    t->Conv_wet = t->conv_on ? parameter->Conv_wet : 0.0f;
+
+    t->B = parameter->B;
+}
+
+/*---------------------------------------------*/
+/* n Werte c einen Schritt alpha an t heranfuehren, kleine Reste direkt.
+   Rueckgabe: 1 solange noch ein Wert abweicht */
+static int glide(float *c, const float *t, int n, float alpha)
+{   float d;
+    int i, moving = 0;
+
+    for (i=0; i<n; i++) {
+        d = t[i] - c[i];
+        if (fabsf(d) < 1e-6f) c[i] = t[i];
+        else {
+            c[i] += alpha * d;
+            moving = 1;
+        }
+    }
+    return moving;
+}
+
+/*---------------------------------------------*/
+/* die fuenf Koeffizienten eines Filters 2. Ordnung, wie glide() */
+static int glide_coeff(IIR_2_coeff_t *c, const IIR_2_coeff_t *t, float alpha)
+{   int m = 0;
+
+    m |= glide(&c->a1, &t->a1, 1, alpha);
+    m |= glide(&c->a2, &t->a2, 1, alpha);
+    m |= glide(&c->b0, &t->b0, 1, alpha);
+    m |= glide(&c->b1, &t->b1, 1, alpha);
+    m |= glide(&c->b2, &t->b2, 1, alpha);
+    return m;
+}
+
+/*---------------------------------------------*/
+/* cur einen Teilblock weiter an t heran. Zwischen zwei stabilen
+   Filtern 2. Ordnung bleibt die lineare Mischung stabil (das
+   Stabilitaetsdreieck fuer a1, a2 ist konvex).
+   Rueckgabe: 1 solange cur noch nicht t entspricht */
+static int glide_params(dsp_params_t *p, const dsp_params_t *t, float alpha)
+{   int k, m = 0;
+
+    m |= glide_coeff(&p->TP, &t->TP, alpha);
+    m |= glide_coeff(&p->BP, &t->BP, alpha);
+    m |= glide_coeff(&p->HP, &t->HP, alpha);
+    m |= glide(&p->A_TP, &t->A_TP, 1, alpha);
+    m |= glide(&p->A_BP, &t->A_BP, 1, alpha);
+    m |= glide(&p->A_HP, &t->A_HP, 1, alpha);
+    m |= glide(&p->B_eq, &t->B_eq, 1, alpha);
+    m |= glide(&p->Fir_g, &t->Fir_g, 1, alpha);
+    m |= glide(p->PEQ.b0, t->PEQ.b0, p->PEQ.nBands, alpha);
+    m |= glide(p->PEQ.b1, t->PEQ.b1, p->PEQ.nBands, alpha);
+    m |= glide(p->PEQ.b2, t->PEQ.b2, p->PEQ.nBands, alpha);
+    m |= glide(p->PEQ.a1, t->PEQ.a1, p->PEQ.nBands, alpha);
+    m |= glide(p->PEQ.a2, t->PEQ.a2, p->PEQ.nBands, alpha);
+    for (k=0; k<p->Echo.nTaps; k++) {
+        m |= glide(&p->Echo.tap[k].gain, &t->Echo.tap[k].gain, 1, alpha);
+        m |= glide(&p->Echo.tap[k].pan, &t->Echo.tap[k].pan, 1, alpha);
+    }
+    m |= glide(&p->Echo.feedback, &t->Echo.feedback, 1, alpha);
+    m |= glide(&p->Conv_wet, &t->Conv_wet, 1, alpha);
+    m |= glide(&p->B, &t->B, 1, alpha);
+    return m;
+}
+
+/*---------------------------------------------*/
+/* y von y0 nach y ueberblenden, je Wertepaar ein Schritt */
+static void xfade(float *y, const float *y0, int n)
+{   float g, dg = 1.0f / n;
+    int i;
+
+    for (i=0; i<n; i++) {
+        g = dg * (i+1);
+        y[2*i]   = y0[2*i]   + (y[2*i]   - y0[2*i])   * g;
+        y[2*i+1] = y0[2*i+1] + (y[2*i+1] - y0[2*i+1]) * g;
+    }
+}
+
+/*---------------------------------------------*/
+/* n Wertepaare mit der Einstellung p rechnen. p0 != NULL: Teilblock
+   beim Nachfuehren (n <= DSP_SMOOTH_FRAMES), jede Stufe rechnet dann
+   einmal mit p0 und vom selben Zustand aus nochmal mit p und blendet
+   innerhalb des Teilblocks von p0 nach p ueber; B als Rampe */
+static void run_stages(dsp_chain_t *c, const dsp_params_t *p0, const dsp_params_t *p,
+                       const short *x, float *y, int n)
+{   float y0[2*DSP_SMOOTH_FRAMES];
+    float g, dg, B0 = p0 ? p0->B : p->B;
+    EQ_state_t eq;
+    peq_state_t peq;
+    unsigned pos;
+    int i;
+
+    if (!p->eq_on && !p->fir_on && !p->peq_on && !p->echo_on && !p->conv_on && !p->dither
+        && (B0 == 1.0f) && (p->B == 1.0f)) {
+        for (i=0; i<2*n; i++) y[i] = x[i];
+        return;     /* nichts zu tun, Block bleibt wie er ist */
+    }
+
+    // X filtern, ganzer Block, ab hier float in y
+    if (p->eq_on) {
+        if (p0) {
+            eq = c->eq;
+            EQ_filter_block(&c->eq, &p0->TP, &p0->BP, &p0->HP,
+                            p0->A_TP, p0->A_BP, p0->A_HP, p0->B_eq, x, y0, n);
+            c->eq = eq;
+        }
+        EQ_filter_block(&c->eq, &p->TP, &p->BP, &p->HP,
+                        p->A_TP, p->A_BP, p->A_HP, p->B_eq, x, y, n);
+        if (p0) xfade(y, y0, n);
+    }
+    else {
+        for (i=0; i<2*n; i++) y[i] = x[i];
+    }
+    // FIR-Equalizer, in y. Ueberblenden ueber den Anteil, als Rampe
+    if (p->fir_on) {
+        CONV_mix_block(&c->fir, p->Fir_IR, p0 ? p0->Fir_g : p->Fir_g, p->Fir_g, y, n);
+    }
+    // parametrischer EQ dahinter, in y
+    if (p->peq_on) {
+        if (p0) {
+            peq = c->peq;
+            memcpy(y0, y, 2*n*sizeof(float));
+            PEQ_filter_block(&c->peq, &p0->PEQ, y0, n);
+            c->peq = peq;
+        }
+        PEQ_filter_block(&c->peq, &p->PEQ, y, n);
+        if (p0) xfade(y, y0, n);
+    }
+    // Echo, in y. Der zweite Lauf ueberschreibt die Leitung genau dort,
+    // wo der erste geschrieben hat, zurueckgesetzt wird nur pos
+    if (p->echo_on) {
+        if (p0) {
+            pos = c->echo.pos;
+            memcpy(y0, y, 2*n*sizeof(float));
+            echo_process_block(&c->echo, &p0->Echo, y0, n);
+            c->echo.pos = pos;
+        }
+        echo_process_block(&c->echo, &p->Echo, y, n);
+        if (p0) xfade(y, y0, n);
+    }
+    // Faltungshall, in y. Nur der Anteil wet aendert sich, als Rampe
+    if (p->conv_on) {
+        CONV_process_block(&c->conv, p->Conv_IR, p0 ? p0->Conv_wet : p->Conv_wet,
+                           p->Conv_wet, y, n);
+    }
+
+    // B als Rampe, falls es sich im Teilblock aendert
+    g = p->B;
+    if (B0 != p->B) {
+        dg = (p->B - B0) / n;
+        for (i=0; i<n; i++) {
+            y[2*i]   *= B0 + dg * (i+1);
+            y[2*i+1] *= B0 + dg * (i+1);
+        }
+        g = 1.0f;
+    }
+
+    // fertig fuer die einzige Wandlung nach 16 Bit: Gewichtung und Dither
+    // wie in DSP_float_to_s16(), die Wandlung rechnet dann mit gain 1
+    if (p->dither) {
+        make_dither(c, 2*n);
+        for (i=0; i<2*n; i++) y[i] = y[i] * g + c->dither[i];
+    }
+    else if (g != 1.0f) {
+        for (i=0; i<2*n; i++) y[i] *= g;
+    }
+}
+
+/*---------------------------------------------*/
+/* hoechstens DSP_CHAIN_MAX_FRAMES Wertepaare */
+static void process_part(dsp_chain_t *c, const sRam_t *parameter, const short *x, float *y, int n)
+{   dsp_params_t *p = &c->cur;
+    dsp_params_t t, p0;
+    const conv_ir_t *fir = (NULL != parameter->FirEq) ? FIR_EQ_current(parameter->FirEq) : NULL;
+    int moving = 1, m, k;
+
+    make_target(c, parameter, fir, &t);
+    if (!c->cur_valid) {
+        *p = t;     /* Anfang des Stroms: sofort */
+        c->cur_valid = 1;
+    }
+    else {
+        /* Stufe kommt dazu: Zustand von frueher vergessen, einblenden */
+        if (t.eq_on && !p->eq_on)     EQ_reset(&c->eq);
+        if (t.fir_on && !p->fir_on)   CONV_reset(&c->fir);
+        if (t.peq_on && !p->peq_on)   PEQ_reset(&c->peq);
+        if (t.echo_on && !p->echo_on) echo_reset(&c->echo);
+        if (t.conv_on && !p->conv_on) CONV_reset(&c->conv);
+        p->eq_on   |= t.eq_on;
+        p->fir_on  |= t.fir_on;
+        p->peq_on  |= t.peq_on;
+        p->echo_on |= t.echo_on;
+        p->conv_on |= t.conv_on;
+        p->dither   = t.dither;
+        /* was sich nicht ueberblenden laesst, springt */
+        if (p->PEQ.nBands != t.PEQ.nBands) p->PEQ = t.PEQ;
+        if (t.fir_on)  p->Fir_IR  = t.Fir_IR;
+        if (t.conv_on) p->Conv_IR = t.Conv_IR;
+        for (k=p->Echo.nTaps; k<t.Echo.nTaps; k++) {
+            p->Echo.tap[k] = t.Echo.tap[k];
+            p->Echo.tap[k].gain = 0.0f;     /* neuer Tap: einblenden */
+        }
+        p->Echo.nTaps = t.Echo.nTaps;
+        for (k=0; k<t.Echo.nTaps; k++) {
+            p->Echo.tap[k].delay_n[0] = t.Echo.tap[k].delay_n[0];
+            p->Echo.tap[k].delay_n[1] = t.Echo.tap[k].delay_n[1];
+        }
+    }
+
+    /* eingeschwungen: ganzer Block am Stueck, sonst in Teilbloecken */
+    while (n > 0) {
+        if (moving) {
+            p0 = *p;
+            moving = glide_params(p, &t, c->alpha);
+        }
+        if (moving) {
+            m = (n < DSP_SMOOTH_FRAMES) ? n : DSP_SMOOTH_FRAMES;
+            run_stages(c, &p0, p, x, y, m);
+        }
+        else {
+            m = n;
+            run_stages(c, NULL, p, x, y, m);
+        }
+        x += 2*m;
+        y += 2*m;
+        n -= m;
+    }
+
+    /* ausgeblendete Stufen abschalten, ueberzaehlige Taps entfernen */
+    if (!moving) {
+        if (!t.eq_on)                        p->eq_on = 0;
+        if (!t.fir_on)                       p->fir_on = 0;
+        if (!parameter->flag_PEQ_is_active)  p->peq_on = 0;
+        if (!parameter->flag_Echo_is_active) p->echo_on = 0;
+        if (!t.conv_on) p->conv_on = 0;
+        if (parameter->Echo.nTaps < p->Echo.nTaps) p->Echo.nTaps = parameter->Echo.nTaps;
+    }
+
+    /* dem Entwerfer melden, welcher Entwurf noch gebraucht wird: der, mit
+       dem die Faltung rechnet (bis zur Blockgrenze der alte), sonst keiner
+       ausser dem neuesten */
+    if (NULL != parameter->FirEq)
+        FIR_EQ_ack(parameter->FirEq, (p->fir_on && (NULL != c->fir.ir)) ? c->fir.ir : fir);
+}
+
+/*---------------------------------------------*/
+int DSP_chain_latency(const dsp_chain_t *c)
+{
+    return (c->cur_valid && c->cur.fir_on) ? FIR_EQ_LATENCY : 0;
+}
+
+/*---------------------------------------------*/
+void DSP_chain_process(dsp_chain_t *c, const sRam_t *parameter, short *xy, int nFrames)
+{   int n;
+
+    while (nFrames > 0)
+    {   n = (nFrames > DSP_CHAIN_MAX_FRAMES) ? DSP_CHAIN_MAX_FRAMES : nFrames;
+        process_part(c, parameter, xy, c->yf, n);
+        DSP_float_to_s16(c->yf, xy, 2*n, 1.0f, NULL);
+        xy += 2*n;
+        nFrames -= n;
+    }
+}
+
+/*---------------------------------------------*/
+void DSP_chain_process_float(dsp_chain_t *c, const sRam_t *parameter,
+                             const short *x, float *y, int nFrames)
+{   int n;
+
+    while (nFrames > 0)
+    {   n = (nFrames > DSP_CHAIN_MAX_FRAMES) ? DSP_CHAIN_MAX_FRAMES : nFrames;
+        process_part(c, parameter, x, y, n);
+        x += 2*n;
+        y += 2*n;
+        nFrames -= n;
+    }
+}
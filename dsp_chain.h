@@ -0,0 +1,96 @@
+/* dsp_chain.h :
+   Signalverarbeitung eines Stereo-Stroms, wie sie der Player und das
+   Offline-Rendern gemeinsam nutzen:
+
+     Equalizer (TP/BP/HP) -> parametrischer EQ -> Echo -> Faltungshall
+     -> Gewichtung B
+
+   Statt TP/BP/HP kann der Equalizer linearphasig als FIR-Filter laufen
+   (fir_eq.h); die Kette verzoegert dann um FIR_EQ_LATENCY Wertepaare,
+   siehe DSP_chain_latency().
+
+   Zwischen den Stufen laufen die Werte als float, nach 16 Bit gewandelt
+   wird nur einmal am Ende (gerundet, begrenzt, auf Wunsch mit TPDF-
+   Dither, siehe DSP_float_to_s16()). DSP_chain_process_float() liefert
+   die Werte direkt vor dieser Wandlung, z.B. fuer den Player, der erst
+   im Puffer der Soundkarte wandelt.
+
+   Welche Stufen aktiv sind und wie sie eingestellt sind, steht in einer
+   Kopie des shared RAM. Der Filterzustand gehoert zum Strom, fuer jede
+   neue Datei DSP_chain_reset() aufrufen. Mehrere Ketten koennen
+   unabhaengig voneinander in verschiedenen Threads laufen.
+
+   Neue Einstellungen werden nicht sprunghaft uebernommen: die Kette
+   fuehrt ihre eigene Kopie (cur) alle DSP_SMOOTH_FRAMES Wertepaare mit
+   der Zeitkonstante DSP_SMOOTH_MS an die Vorgabe heran (Koeffizienten
+   der Filter, Gewichte, B). Innerhalb eines Teilblocks wird von der
+   alten zur neuen Einstellung uebergeblendet, so dass kein Sprung im
+   Signal entsteht. Stufen werden ein- und ausgeblendet statt geschaltet.
+   Die GUI darf die Parameter also beliebig oft aendern, ohne Sperre.
+   Nur die Verzoegerungen des Echos und die Anzahl der PEQ-Baender
+   springen; eine neue Impulsantwort (Hall, FIR-Equalizer) blendet die
+   Faltung an ihrer naechsten Blockgrenze ueber. Nach DSP_chain_reset()
+   gilt die erste Vorgabe sofort.
+*/
+
+#ifndef _dsp_chain_h_
+#define _dsp_chain_h_
+
+#include "globals.h"
+
+#define DSP_CHAIN_MAX_FRAMES 4096   /* Wertepaare, die am Stueck gerechnet werden */
+#define DSP_SMOOTH_FRAMES    32     /* Teilblock beim Nachfuehren der Parameter */
+#define DSP_SMOOTH_MS        5.0    /* Zeitkonstante des Nachfuehrens */
+
+/* Einstellung, mit der die Kette gerade rechnet */
+typedef struct
+{   int eq_on, fir_on, peq_on, echo_on, conv_on; /* Stufe wird gerechnet, auch beim Ausblenden */
+    int dither;
+    IIR_2_coeff_t TP, BP, HP;
+    float A_TP, A_BP, A_HP;
+    float B_eq;                         /* B im Equalizer, ausgeblendet 1 */
+    float Fir_g;                        /* Anteil FIR-Equalizer, ausgeblendet 0 */
+    const conv_ir_t *Fir_IR;
+    peq_coeff_t PEQ;                    /* ausgeblendet: alle Baender durchlaessig */
+    echo_params_t Echo;                 /* ausgeblendet: alle Taps gain 0 */
+    float Conv_wet;                     /* ausgeblendet 0 */
+    const conv_ir_t *Conv_IR;
+    float B;
+} dsp_params_t;
+
+typedef struct
+{   EQ_state_t  eq;                     /* Zustand des Equalizers */
+    conv_state_t fir;                   /* Zustand des FIR-Equalizers */
+    peq_state_t peq;                    /* Zustand des parametrischen EQ */
+    echo_state_t echo;                  /* Ringbuffer des Echos */
+    conv_state_t conv;                  /* Bloecke und Spektren des Halls */
+    float yf[2*DSP_CHAIN_MAX_FRAMES];   /* Signal fuer DSP_chain_process() */
+    float dither[2*DSP_CHAIN_MAX_FRAMES]; /* Rauschen fuer die Wandlung */
+    unsigned int seed;                  /* Zufallsgenerator des Dithers */
+    dsp_params_t cur;                   /* nachgefuehrte Einstellung */
+    int cur_valid;                      /* 0: naechste Vorgabe sofort uebernehmen */
+    float alpha;                        /* Schritt je DSP_SMOOTH_FRAMES */
+} dsp_chain_t;
+
+/* Filterzustand loeschen, vor jedem neuen Strom */
+void DSP_chain_reset(dsp_chain_t *c);
+
+/* nFrames Wertepaare (Links,Rechts abwechselnd) an Ort und Stelle
+   bearbeiten, nFrames darf groesser als DSP_CHAIN_MAX_FRAMES sein */
+void DSP_chain_process(dsp_chain_t *c, const sRam_t *parameter, short *xy, int nFrames);
+
+/* wie DSP_chain_process(), aber von x nach y, ohne die Wandlung nach
+   16 Bit: y enthaelt die Werte mit Gewichtung und Dither, so dass
+   DSP_float_to_s16(y, ..., 1.0f, NULL) dasselbe ergibt wie
+   DSP_chain_process() */
+void DSP_chain_process_float(dsp_chain_t *c, const sRam_t *parameter,
+                             const short *x, float *y, int nFrames);
+
+/* Verzoegerung in Wertepaaren, die die Kette gerade hinzufuegt */
+int DSP_chain_latency(const dsp_chain_t *c);
+
+/* n Werte x*gain (+ dither, darf NULL sein) auf 16 Bit runden und
+   begrenzen, auf x86 mit SSE2 vier Werte je Befehl */
+void DSP_float_to_s16(const float *x, short *y, int n, float gain, const float *dither);
+
+#endif
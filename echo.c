@@ -1,34 +1,29 @@
 /*****************************************************************
-  Projekt-Name    : ringbuffer
-  File-Name         : ringbuffer.c
-  Programm-Zweck  :  Implementierung eines Ringbuffers fuer short-Werte.
-
-  Der Einfachheit halber wird hier auf Pruefungen wie "rungbuffer voll"
-  oder "leer" verzichtet. Der Ringbuffer hat eine feste Länge, die einer
-  maximalen Verzögerung von 1sec entspricht.
-  Ringbuffer gefuellt mit Nullen, maximales Delay:
-    0   1                                                         len-1
-  ---------------------------------------------------------------------
-  | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 |
-  ---------------------------------------------------------------------
-    |                        ------->                               |
-   rd                     Arbeitsrichtung                          wr
-  nach einem Lesezugriff:
+  Projekt-Name    : Echo
+  File-Name         : echo.c
+  Programm-Zweck  :  Stereo-Verzoegerung mit mehreren Abgriffen (Taps).
+
+  Je Kanal eine Verzoegerungsleitung w als Ringbuffer in float, Laenge
+  ECHO_BUF_LEN ist eine Zweierpotenz, Indizes werden mit ECHO_BUF_MASK
+  statt Modulo umgebrochen:
+
+    w[n] = x[n] + feedback * w[n - d0]        d0: Verzoegerung von Tap 0
+    y[n] = x[n] + Summe_k g_k * w[n - d_k]    g_k: gain mit Panorama
+
+  pos zaehlt die geschriebenen Werte, der Wert von vor d Takten steht
+  bei (pos - d) & ECHO_BUF_MASK.
     0   1                                                         len-1
   ---------------------------------------------------------------------
   | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 |
   ---------------------------------------------------------------------
-        |                    ------->                               |
-       rd                 Arbeitsrichtung                          wr
-  nach einem Schreibzugriff:
-    0   1                                                         len-1
-  ---------------------------------------------------------------------
-  | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | 0 | x |
-  ---------------------------------------------------------------------
-    |   |                    ------->
-   wr  rd                 Arbeitsrichtung
-Die beiden Indizes laufen zirkular durch das Feld, was durch
-inkrementieren und anschliessendes Modulo len erreicht wird.
+            |                  ------->              |
+        pos - d_k           Arbeitsrichtung         pos
+
+  Gerechnet wird blockweise. Ein Teilblock ist hoechstens ECHO_BLOCK
+  und hoechstens d0 lang, dann haengt w im Teilblock nur von frueher
+  geschriebenen Werten ab und alle inneren Schleifen laufen ohne
+  Abhaengigkeit von Element zu Element ueber zusammenhaengende Stuecke
+  des Ringbuffers (vektorisierbar).
 
   Erstellt durch  : Fgb
   Erstellt am     : 20.03.2007
@@ -37,65 +32,102 @@ inkrementieren und anschliessendes Modulo len erreicht wird.
  *****************************************************************/
 
 
-#include <stdio.h>
-#include <stdlib.h>
-
-
+#include <string.h>
 #include "echo.h"
-#include "globals.h"
-
-#define N_BUF F_S     /* F_S ist die Abtastfrequenz in Hz, d.h. 1 Sekunde max Delay */
 
-typedef struct {
-    short buf[N_BUF];  /* max 1sec Delay */
-    int wr;	/* next write at this index */
-    int rd;     /* next read at this index */
-}RingBufferShort_t;
 
-static RingBufferShort_t rb={0};
-
-static void WriteToRingBufferShort(short x)
+void echo_reset(echo_state_t *s)
 {
-  rb.buf[rb.wr] = x;
+  memset(s->buf, 0, sizeof(s->buf));
+  s->pos = 0;
 }
 
-static short ReadFromRingBufferShort(void)
+/* acc[i] += g * line[(pos+i) & MASK], i = 0...n-1, stueckweise ohne Umbruch */
+static void add_delayed(float *acc, const float *line, unsigned int pos, int n, float g)
 {
-  short buf;
-  buf = rb.buf[rb.rd];
-  rb.rd++;
-  rb.rd = rb.rd % N_BUF;
-  return buf;
+  int i, run;
+  const float *src;
+
+  while (n > 0) {
+    pos &= ECHO_BUF_MASK;
+    run = ECHO_BUF_LEN - pos;
+    if (run > n) run = n;
+    src = line + pos;
+    for (i = 0; i < run; i++)
+      acc[i] += g * src[i];
+    acc += run;
+    pos += run;
+    n   -= run;
+  }
 }
 
+/* line[(pos+i) & MASK] = w[i] */
+static void write_line(float *line, unsigned int pos, const float *w, int n)
+{
+  int run;
+
+  while (n > 0) {
+    pos &= ECHO_BUF_MASK;
+    run = ECHO_BUF_LEN - pos;
+    if (run > n) run = n;
+    memcpy(line + pos, w, run * sizeof(float));
+    w   += run;
+    pos += run;
+    n   -= run;
+  }
+}
 
+/* Verstaerkung eines Taps fuer Kanal c (0 links, 1 rechts) */
+static float tap_gain(const echo_tap_t *t, int c)
+{
+  if ((c == 0) && (t->pan > 0)) return t->gain * (1 - t->pan);
+  if ((c == 1) && (t->pan < 0)) return t->gain * (1 + t->pan);
+  return t->gain;
+}
 
-
-
-/***********************************************************************/
-/* TODO: Echo implementieren                                           */
-/***********************************************************************/
-
-sndStereo16_t echo_effect(sndStereo16_t x, echo_params_t p)
+void echo_process_block(echo_state_t *s, const echo_params_t *p, float *y, int nFrames)
 {
-      sndStereo16_t y;
-      float mono_buffer;
-      float gain_buffer;
-      float feedback_buffer;
-      short bufferIn;
-      static short bufferOut = 0;
-
-      mono_buffer = x.val_li + x.val_re;
-      gain_buffer = mono_buffer * p.gain;
-      feedback_buffer = bufferOut * p.feedback;
-      bufferIn = (short)(feedback_buffer + gain_buffer);
-
-      rb.wr = (rb.rd + p.delay_n0) % N_BUF;
-      WriteToRingBufferShort(bufferIn);
-      bufferOut = ReadFromRingBufferShort();
-
-      y.val_re = (short)(bufferOut + x.val_re);
-      y.val_li = (short)(bufferOut + x.val_li);
-
-      return y;
+  float x[2][ECHO_BLOCK], w[2][ECHO_BLOCK];
+  int d_fb[2], nTaps, c, i, k, m;
+
+  nTaps = (p->nTaps < ECHO_MAX_TAPS) ? p->nTaps : ECHO_MAX_TAPS;
+  if (nTaps <= 0) return;
+  /* Rueckkopplung ueber Tap 0, mindestens ein Takt */
+  for (c = 0; c < 2; c++) {
+    d_fb[c] = p->tap[0].delay_n[c];
+    if (d_fb[c] < 1) d_fb[c] = 1;
+    if (d_fb[c] > ECHO_MAX_DELAY) d_fb[c] = ECHO_MAX_DELAY;
+  }
+
+  while (nFrames > 0) {
+    m = (nFrames < ECHO_BLOCK) ? nFrames : ECHO_BLOCK;
+    if ((p->feedback != 0) && (m > d_fb[0])) m = d_fb[0];
+    if ((p->feedback != 0) && (m > d_fb[1])) m = d_fb[1];
+
+    for (i = 0; i < m; i++) {
+      x[0][i] = y[2*i];
+      x[1][i] = y[2*i+1];
+    }
+    for (c = 0; c < 2; c++) {
+      /* in die Leitung: w = x + feedback * w(-d0) */
+      memcpy(w[c], x[c], m * sizeof(float));
+      if (p->feedback != 0)
+        add_delayed(w[c], s->buf[c], s->pos - d_fb[c], m, p->feedback);
+      write_line(s->buf[c], s->pos, w[c], m);
+
+      /* Ausgang: x + alle Taps */
+      for (k = 0; k < nTaps; k++) {
+        int d = p->tap[k].delay_n[c];
+        if ((d < 0) || (d > ECHO_MAX_DELAY)) continue;
+        add_delayed(x[c], s->buf[c], s->pos - d, m, tap_gain(&p->tap[k], c));
+      }
+    }
+    for (i = 0; i < m; i++) {
+      y[2*i]   = x[0][i];
+      y[2*i+1] = x[1][i];
+    }
+    s->pos += m;
+    y += 2*m;
+    nFrames -= m;
+  }
 }
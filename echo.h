@@ -1,7 +1,7 @@
 /*****************************************************************
   Projekt-Name    : Echo
   File-Name         : echo.h
-  Programm-Zweck  :  Implementierung eines Ringbuffers fuer short-Werte.
+  Programm-Zweck  :  Stereo-Verzoegerung mit mehreren Abgriffen, siehe echo.c
 
 
   Erstellt durch  : Fgb
@@ -15,14 +15,37 @@
 #include "snd_lib.h"
 
 
+#define ECHO_MAX_TAPS  8                      /* Abgriffe je Verzoegerung */
+#define ECHO_BUF_BITS  17
+#define ECHO_BUF_LEN   (1 << ECHO_BUF_BITS)  /* Wertepaare, Zweierpotenz */
+#define ECHO_BUF_MASK  (ECHO_BUF_LEN - 1)
+#define ECHO_BLOCK     256                   /* Teilblock in echo_process_block() */
+#define ECHO_MAX_DELAY (ECHO_BUF_LEN - ECHO_BLOCK)  /* knapp 3 s bei 44,1kHz */
+
+/* ein Abgriff der Verzoegerungsleitung */
 typedef struct
-{   int delay_n0;      /* 0...F_S-1 */
+{   int delay_n[2];    /* Verzoegerung links, rechts: 0...ECHO_MAX_DELAY */
     float gain;        /* 0...1 */
-    float feedback;    /* 0...1 */
+    float pan;         /* -1: nur links, 0: beide Kanaele, +1: nur rechts */
+}echo_tap_t;
+
+typedef struct
+{   int nTaps;                     /* benutzte Abgriffe, 0...ECHO_MAX_TAPS */
+    echo_tap_t tap[ECHO_MAX_TAPS]; /* Tap 0 stellt die GUI ein */
+    float feedback;                /* 0...1, ueber die Verzoegerung von Tap 0 */
 }echo_params_t;
 
+/* Zustand eines Echos, gehoert zum Strom (Player, Render-Job, ...) */
+typedef struct {
+    float buf[2][ECHO_BUF_LEN];  /* Verzoegerungsleitung links, rechts */
+    unsigned int pos;            /* geschriebene Werte, Index mit ECHO_BUF_MASK */
+}echo_state_t;
+
+void echo_reset(echo_state_t *s);
 
-sndStereo16_t echo_effect(sndStereo16_t x, echo_params_t p);
+/* nFrames Wertepaare y (Links,Rechts abwechselnd) an Ort und Stelle mit
+   dem Echo versehen */
+void echo_process_block(echo_state_t *s, const echo_params_t *p, float *y, int nFrames);
 
 #endif
 
@@ -0,0 +1,314 @@
+/* fft.c :
+   Radix-2-FFT, siehe fft.h. Erst Umsortieren nach bitumgekehrten
+   Indizes, dann log2(N) Stufen von Butterflies an Ort und Stelle.
+
+   Drehfaktoren: die Stufe mit Butterflies der halben Laenge h braucht
+   exp(-j*pi*i/h), i = 0 ... h-1. Sie liegen fuer h = 1, 2, 4 ... N/2
+   hintereinander ab Index h-1, zusammen N-1 Werte. Die Tabelle haengt
+   nur von h ab, deshalb kann die Transformation der Laenge N/2 (fuer
+   reelle Folgen) denselben Plan benutzen.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ptl_lib.h"
+#include "cplx.h"
+#include "fft.h"
+
+#if defined(__SSE__)
+  #include <xmmintrin.h>
+#endif
+
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
+
+/*---------------------------------------------*/
+int FFT_size_ok(int n)
+{
+    return (n >= FFT_MIN_SIZE) && (n <= FFT_MAX_SIZE) && (0 == (n & (n - 1)));
+}
+
+/*---------------------------------------------*/
+int FFT_plan_create(fft_plan_t *p, int n)
+{   int h, i, j, k;
+
+    memset(p, 0, sizeof(fft_plan_t));
+    if (!FFT_size_ok(n)) return -1;
+
+    p->tw_re  = malloc(n * sizeof(float));
+    p->tw_im  = malloc(n * sizeof(float));
+    p->bitrev = malloc(n * sizeof(int));
+    if ((NULL == p->tw_re) || (NULL == p->tw_im) || (NULL == p->bitrev))
+    {   FFT_plan_destroy(p);
+        return -1;
+    }
+    p->n = n;
+    for (p->log2n = 0; (1 << p->log2n) < n; p->log2n++) ;
+
+    /* in double gerechnet, nicht durch fortgesetzte Multiplikation */
+    for (h = 1; h < n; h <<= 1)
+        for (i = 0; i < h; i++)
+        {   p->tw_re[h-1+i] = (float)cos(M_PI * i / h);
+            p->tw_im[h-1+i] = (float)-sin(M_PI * i / h);
+        }
+    p->tw_re[n-1] = p->tw_im[n-1] = 0;   /* unbenutzt */
+
+    for (i = 0; i < n; i++)
+    {   for (j = 0, k = 0; k < p->log2n; k++) j |= ((i >> k) & 1) << (p->log2n - 1 - k);
+        p->bitrev[i] = j;
+    }
+    return 0;
+}
+
+/*---------------------------------------------*/
+void FFT_plan_destroy(fft_plan_t *p)
+{
+    free(p->tw_re);
+    free(p->tw_im);
+    free(p->bitrev);
+    memset(p, 0, sizeof(fft_plan_t));
+}
+
+/*---------------------------------------------*/
+/* Vorwaertstransformation der Laenge p->n >> shift, ohne Skalierung */
+static void fft_core(const fft_plan_t *p, float *re, float *im, int shift)
+{   const int n = p->n >> shift;
+    const float *wr, *wi;
+    float tr, ti, t;
+    int h, g, i, j, a, b;
+
+    for (i = 0; i < n; i++)
+    {   j = p->bitrev[i] >> shift;
+        if (i < j)
+        {   t = re[i];  re[i] = re[j];  re[j] = t;
+            t = im[i];  im[i] = im[j];  im[j] = t;
+        }
+    }
+
+    /* h = 1: Drehfaktor 1 */
+    for (a = 0; a < n; a += 2)
+    {   tr = re[a+1];  ti = im[a+1];
+        re[a+1] = re[a] - tr;  im[a+1] = im[a] - ti;
+        re[a] += tr;           im[a] += ti;
+    }
+
+    for (h = 2; h < n; h <<= 1)
+    {   wr = p->tw_re + h - 1;
+        wi = p->tw_im + h - 1;
+        for (g = 0; g < n; g += 2*h)
+        {   i = 0;
+#if defined(__SSE__)
+            for (; i + 4 <= h; i += 4)
+            {   a = g + i;
+                b = a + h;
+                {   __m128 xr = _mm_loadu_ps(re + b), xi = _mm_loadu_ps(im + b);
+                    __m128 cr = _mm_loadu_ps(wr + i), ci = _mm_loadu_ps(wi + i);
+                    __m128 vr = _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci));
+                    __m128 vi = _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr));
+                    __m128 ur = _mm_loadu_ps(re + a), ui = _mm_loadu_ps(im + a);
+                    _mm_storeu_ps(re + b, _mm_sub_ps(ur, vr));
+                    _mm_storeu_ps(im + b, _mm_sub_ps(ui, vi));
+                    _mm_storeu_ps(re + a, _mm_add_ps(ur, vr));
+                    _mm_storeu_ps(im + a, _mm_add_ps(ui, vi));
+                }
+            }
+#endif
+            for (; i < h; i++)
+            {   a = g + i;
+                b = a + h;
+                tr = re[b] * wr[i] - im[b] * wi[i];
+                ti = re[b] * wi[i] + im[b] * wr[i];
+                re[b] = re[a] - tr;  im[b] = im[a] - ti;
+                re[a] += tr;         im[a] += ti;
+            }
+        }
+    }
+}
+
+/*---------------------------------------------*/
+void FFT_complex(const fft_plan_t *p, float *re, float *im, int inverse)
+{   float s;
+    int i;
+
+    if (!inverse)
+    {   fft_core(p, re, im, 0);
+        return;
+    }
+    /* IDFT(x) = tausche(DFT(tausche(x))) / N, tausche: Real- und Imaginaerteil */
+    fft_core(p, im, re, 0);
+    s = 1.0f / p->n;
+    for (i = 0; i < p->n; i++)
+    {   re[i] *= s;
+        im[i] *= s;
+    }
+}
+
+/*---------------------------------------------*/
+/* z[i] = x[2i] + j*x[2i+1], Z = DFT_N/2(z), dann fuer k = 0 ... N/4:
+     Fe = (Z[k] + Z*[N/2-k]) / 2,  Fo = (Z[k] - Z*[N/2-k]) / 2j
+     X[k] = Fe + W^k*Fo,  X[N/2-k] = (Fe - W^k*Fo)*,  W = exp(-j*2*pi/N) */
+void FFT_real_forward(const fft_plan_t *p, const float *x, float *re, float *im)
+{   const int h = p->n / 2;
+    const float *wr = p->tw_re + h - 1, *wi = p->tw_im + h - 1;
+    float ar, ai, br, bi, er, ei, or_, oi, tr, ti;
+    int i, k;
+
+    for (i = 0; i < h; i++)     /* aufsteigend, damit re == x geht */
+    {   ar = x[2*i];
+        im[i] = x[2*i+1];
+        re[i] = ar;
+    }
+    fft_core(p, re, im, 1);
+
+    ar = re[0];
+    ai = im[0];
+    re[0] = ar + ai;  im[0] = 0;
+    re[h] = ar - ai;  im[h] = 0;
+    for (k = 1; k <= h/2; k++)
+    {   ar = re[k];    ai = im[k];
+        br = re[h-k];  bi = -im[h-k];        /* Z*[N/2-k] */
+        er  = 0.5f * (ar + br);  ei = 0.5f * (ai + bi);
+        or_ = 0.5f * (ai - bi);  oi = -0.5f * (ar - br);
+        tr = wr[k] * or_ - wi[k] * oi;
+        ti = wr[k] * oi  + wi[k] * or_;
+        re[k]   = er + tr;  im[k]   = ei + ti;
+        re[h-k] = er - tr;  im[h-k] = -(ei - ti);
+    }
+}
+
+/*---------------------------------------------*/
+/* umgekehrt: Fe = (X[k] + X*[N/2-k]) / 2,  Fo = (X[k] - X*[N/2-k]) * W^-k / 2,
+   Z[k] = Fe + j*Fo,  Z[N/2-k] = Fe* + j*Fo*,  z = IDFT_N/2(Z) */
+void FFT_real_inverse(const fft_plan_t *p, float *re, float *im, float *x)
+{   const int h = p->n / 2;
+    const float *wr = p->tw_re + h - 1, *wi = p->tw_im + h - 1;
+    float ar, ai, br, bi, er, ei, dr, di, or_, oi, s;
+    int i, k;
+
+    ar = re[0];
+    br = re[h];
+    re[0] = 0.5f * (ar + br);
+    im[0] = 0.5f * (ar - br);
+    for (k = 1; k <= h/2; k++)
+    {   ar = re[k];    ai = im[k];
+        br = re[h-k];  bi = -im[h-k];        /* X*[N/2-k] */
+        er = 0.5f * (ar + br);  ei = 0.5f * (ai + bi);
+        dr = 0.5f * (ar - br);  di = 0.5f * (ai - bi);
+        or_ = dr * wr[k] + di * wi[k];       /* mal W^-k = konjugiert */
+        oi  = di * wr[k] - dr * wi[k];
+        re[k]   = er - oi;   im[k]   = ei + or_;
+        re[h-k] = er + oi;   im[h-k] = or_ - ei;
+    }
+
+    /* Ruecktransformation N/2 durch Tauschen, 1/(N/2) */
+    fft_core(p, im, re, 1);
+    s = 1.0f / h;
+    for (i = h - 1; i >= 0; i--)   /* absteigend, damit x == re geht */
+    {   ar = re[i] * s;
+        x[2*i+1] = im[i] * s;
+        x[2*i]   = ar;
+    }
+}
+
+/*---------------------------------------------*/
+double FFT_hann_window(float *w, int n)
+{   double s = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        w[i] = (float)(0.5 - 0.5 * cos(2 * M_PI * i / n));
+        s += (double)w[i] * w[i];
+    }
+    return s;
+}
+
+/*---------------------------------------------*/
+double FFT_check_accuracy(int n, int real, int nCheck)
+{   fft_plan_t p;
+    float *re, *im;
+    cplx *x, X, w;
+    double err = 0, max = 0, e;
+    int i, k, c, nBins = real ? n/2 + 1 : n;
+
+    if (0 != FFT_plan_create(&p, n)) return -1;
+    re = malloc((n + 2) * sizeof(float));
+    im = malloc((n + 2) * sizeof(float));
+    x  = malloc(n * sizeof(cplx));
+    if ((NULL == re) || (NULL == im) || (NULL == x))
+    {   free(re);  free(im);  free(x);
+        FFT_plan_destroy(&p);
+        return -1;
+    }
+
+    srand(n);
+    for (i = 0; i < n; i++)
+    {   re[i] = (float)rand() / RAND_MAX - 0.5f;
+        im[i] = real ? 0 : (float)rand() / RAND_MAX - 0.5f;
+        x[i] = make_cplx(re[i], im[i]);
+    }
+    if (real) FFT_real_forward(&p, re, re, im);
+    else      FFT_complex(&p, re, im, 0);
+
+    if ((nCheck <= 0) || (nCheck > nBins)) nCheck = nBins;
+    for (c = 0; c < nCheck; c++)
+    {   /* Stichprobe gleichmaessig verteilt, Bin 0 und N/2 immer dabei */
+        k = (nCheck == nBins) ? c : (int)((double)c * (nBins - 1) / (nCheck - 1));
+        X = make_cplx(0, 0);
+        for (i = 0; i < n; i++)
+        {   /* Winkel modulo N, damit er auch bei grossem i*k genau bleibt */
+            w = c_exp(make_cplx(0, -2 * M_PI * (double)(((long long)i * k) % n) / n));
+            X = c_add(X, c_mult(x[i], w));
+        }
+        e = betrag(c_sub(X, make_cplx(re[k], im[k])));
+        if (e > err) err = e;
+        if (betrag(X) > max) max = betrag(X);
+    }
+
+    free(re);  free(im);  free(x);
+    FFT_plan_destroy(&p);
+    return (max > 0) ? err / max : err;
+}
+
+/*---------------------------------------------*/
+double FFT_benchmark(int n, int real, double seconds)
+{   fft_plan_t p;
+    float *re, *im;
+    double t0, t;
+    long count = 0;
+    int i;
+
+    if (0 != FFT_plan_create(&p, n)) return -1;
+    re = malloc((n + 2) * sizeof(float));
+    im = malloc((n + 2) * sizeof(float));
+    if ((NULL == re) || (NULL == im))
+    {   free(re);  free(im);
+        FFT_plan_destroy(&p);
+        return -1;
+    }
+    for (i = 0; i < n; i++)
+    {   re[i] = (float)rand() / RAND_MAX - 0.5f;
+        im[i] = real ? 0 : (float)rand() / RAND_MAX - 0.5f;
+    }
+
+    t0 = PTL_GetTime();
+    do
+    {   /* hin und zurueck, damit die Werte nicht anwachsen */
+        if (real)
+        {   FFT_real_forward(&p, re, re, im);
+            FFT_real_inverse(&p, re, im, re);
+        }
+        else
+        {   FFT_complex(&p, re, im, 0);
+            FFT_complex(&p, re, im, 1);
+        }
+        count += 2;
+        t = PTL_GetTime() - t0;
+    } while (t < seconds);
+
+    free(re);  free(im);
+    FFT_plan_destroy(&p);
+    return 1e6 * t / count;
+}
@@ -0,0 +1,74 @@
+/* fft.h :
+   Schnelle Fouriertransformation, Radix 2, fuer Spektrum-Analyzer,
+   Faltung und FIR-Entwurf.
+
+     X[k] = sum_n x[n] * exp(-j*2*pi*n*k/N),   k = 0 ... N-1
+
+   Die inverse Transformation rechnet mit +j und teilt durch N.
+   N ist eine Zweierpotenz FFT_MIN_SIZE ... FFT_MAX_SIZE.
+
+   Die Daten liegen als Struktur von Feldern vor: alle Realteile in re[],
+   alle Imaginaerteile in im[]. Die Drehfaktoren werden einmal pro Laenge
+   in einem Plan berechnet, je Stufe hintereinander, so dass die innere
+   Schleife einer Stufe Daten und Drehfaktoren fortlaufend liest (auf
+   x86 vier Butterflies je SSE-Befehl).
+
+   Reelle Eingangsfolgen der Laenge N werden als komplexe Folge der
+   Laenge N/2 transformiert (gerade Werte Realteil, ungerade Imaginaerteil)
+   und danach getrennt; das halbiert den Aufwand. Ergebnis sind die
+   Bins 0 ... N/2, der Rest ist konjugiert symmetrisch.
+
+   Ein Plan wird nur gelesen, mehrere Threads koennen ihn gleichzeitig
+   benutzen.
+*/
+
+#ifndef _fft_h_
+#define _fft_h_
+
+#define FFT_MIN_SIZE 64
+#define FFT_MAX_SIZE 65536
+
+typedef struct
+{   int n;              /* Laenge */
+    int log2n;
+    float *tw_re;       /* Drehfaktoren exp(-j*pi*i/h), Stufe h ab tw[h-1] */
+    float *tw_im;
+    int *bitrev;        /* bitumgekehrte Indizes fuer Laenge n */
+} fft_plan_t;
+
+/* 1 wenn n eine Zweierpotenz FFT_MIN_SIZE ... FFT_MAX_SIZE ist */
+int FFT_size_ok(int n);
+
+/* Plan fuer die Laenge n anlegen. Rueckgabe: 0 fuer ok, -1 bei Fehler */
+int FFT_plan_create(fft_plan_t *p, int n);
+void FFT_plan_destroy(fft_plan_t *p);
+
+/* komplexe Transformation der Laenge p->n an Ort und Stelle,
+   inverse != 0: Ruecktransformation (mit 1/N) */
+void FFT_complex(const fft_plan_t *p, float *re, float *im, int inverse);
+
+/* reelle Folge x[0...n-1] -> Bins re[0...n/2], im[0...n/2].
+   re darf x sein, x wird dann ueberschrieben */
+void FFT_real_forward(const fft_plan_t *p, const float *x, float *re, float *im);
+
+/* Bins re[0...n/2], im[0...n/2] -> reelle Folge x[0...n-1] (mit 1/N).
+   Die Bins werden dabei ueberschrieben, x darf re sein */
+void FFT_real_inverse(const fft_plan_t *p, float *re, float *im, float *x);
+
+/* Fenster nach Hann, w[i] = 0.5 - 0.5*cos(2*pi*i/n), periodisch wie fuer
+   ueberlappende Bloecke. Rueckgabe: Summe der w[i]^2 */
+double FFT_hann_window(float *w, int n);
+
+/* groesste Abweichung von der direkt gerechneten DFT (double), bezogen
+   auf den groessten Betrag des Spektrums, fuer Zufallsdaten der Laenge n.
+   real != 0: FFT_real_forward(), sonst FFT_complex().
+   Bei grossem n werden nur nCheck Bins direkt gerechnet (0: alle).
+   Rueckgabe: -1 bei Fehler */
+double FFT_check_accuracy(int n, int real, int nCheck);
+
+/* Rechenzeit einer Transformation der Laenge n in Mikrosekunden, Mittel
+   ueber mindestens seconds Sekunden. real != 0: reelle Transformation.
+   Rueckgabe: -1 bei Fehler */
+double FFT_benchmark(int n, int real, double seconds);
+
+#endif
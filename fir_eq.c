@@ -0,0 +1,203 @@
+/* fir_eq.c :
+   Equalizer linearphasig, siehe fir_eq.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cplx.h"
+#include "fir_eq.h"
+#include "globals.h"
+#include "sram_snapshot.h"
+
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
+
+/*---------------------------------------------*/
+void FIR_EQ_init(fir_eq_t *fe)
+{
+    memset(fe, 0, sizeof(fir_eq_t));
+    PTL_AtomicStore(&fe->pub, -1);
+    PTL_AtomicStore(&fe->ack, -1);
+}
+
+/*---------------------------------------------*/
+void FIR_EQ_set_target(fir_eq_target_t *t, const IIR_2_coeff_t *p_TP,
+                       const IIR_2_coeff_t *p_BP, const IIR_2_coeff_t *p_HP,
+                       float A_TP, float A_BP, float A_HP, float B)
+{
+    memset(t, 0, sizeof(fir_eq_target_t));
+    t->TP = *p_TP;
+    t->BP = *p_BP;
+    t->HP = *p_HP;
+    t->A_TP = A_TP;
+    t->A_BP = A_BP;
+    t->A_HP = A_HP;
+    t->B = B;
+}
+
+/*---------------------------------------------*/
+/* Frequenzgang eines Filters 2. Ordnung, wie IIR_2_H() in dig_filter.c */
+static cplx biquad_H(const IIR_2_coeff_t *p, cplx z1, cplx z2)
+{   cplx num, den;
+
+    num = c_add(make_cplx(p->b0, 0),
+                c_add(c_mult(make_cplx(p->b1, 0), z1), c_mult(make_cplx(p->b2, 0), z2)));
+    den = c_add(make_cplx(1, 0),
+                c_add(c_mult(make_cplx(p->a1, 0), z1), c_mult(make_cplx(p->a2, 0), z2)));
+    return c_div(num, den);
+}
+
+/* |H_ges| bei der Kreisfrequenz w (0...pi) */
+static double target_mag(const fir_eq_target_t *t, double w)
+{   cplx z1 = c_exp(make_cplx(0, -w)), z2 = c_exp(make_cplx(0, -2 * w));
+    cplx H = make_cplx(1, 0);
+
+    H = c_add(H, c_mult(make_cplx(t->A_TP, 0), biquad_H(&t->TP, z1, z2)));
+    H = c_add(H, c_mult(make_cplx(t->A_BP, 0), biquad_H(&t->BP, z1, z2)));
+    H = c_add(H, c_mult(make_cplx(t->A_HP, 0), biquad_H(&t->HP, z1, z2)));
+    return betrag(H) * t->B;
+}
+
+/*---------------------------------------------*/
+/* FIR_EQ_TAPS Werte nach h: |H_ges| mit Phase 0 zurueck, zyklisch um
+   FIR_EQ_DELAY verschoben, Hann-Fenster. Rueckgabe: 0 fuer ok, -1 bei Fehler */
+static int design_taps(const fir_eq_target_t *t, float *h)
+{   fft_plan_t plan;
+    float *re, *im;
+    int i, k;
+
+    if (0 != FFT_plan_create(&plan, FIR_EQ_GRID)) return -1;
+    re = malloc(FIR_EQ_GRID * sizeof(float));
+    im = malloc((FIR_EQ_GRID/2 + 1) * sizeof(float));
+    if ((NULL == re) || (NULL == im))
+    {   free(re);  free(im);
+        FFT_plan_destroy(&plan);
+        return -1;
+    }
+
+    for (k = 0; k <= FIR_EQ_GRID/2; k++)
+    {   re[k] = (float)target_mag(t, 2 * M_PI * k / FIR_EQ_GRID);
+        im[k] = 0;
+    }
+    FFT_real_inverse(&plan, re, im, re);
+
+    for (i = 0; i < FIR_EQ_TAPS; i++)
+    {   k = (i - FIR_EQ_DELAY + FIR_EQ_GRID) % FIR_EQ_GRID;
+        h[i] = re[k] * (float)(0.5 - 0.5 * cos(2 * M_PI * (i + 1) / (FIR_EQ_TAPS + 1)));
+    }
+
+    free(re);  free(im);
+    FFT_plan_destroy(&plan);
+    return 0;
+}
+
+/*---------------------------------------------*/
+int FIR_EQ_design(conv_ir_t *ir, const fir_eq_target_t *t)
+{   float *h = malloc(FIR_EQ_TAPS * sizeof(float));
+    int ret = -1;
+
+    memset(ir, 0, sizeof(conv_ir_t));
+    if ((NULL != h) && (0 == design_taps(t, h)))
+        ret = CONV_make_ir(ir, h, NULL, FIR_EQ_TAPS);
+    free(h);
+    return ret;
+}
+
+/*---------------------------------------------*/
+int FIR_EQ_update(fir_eq_t *fe, const fir_eq_target_t *t)
+{   long pub = PTL_AtomicLoad(&fe->pub);
+    int s;
+
+    if ((pub >= 0) && (0 == memcmp(t, &fe->target, sizeof(fir_eq_target_t))))
+        return 0;                                   /* unveraendert */
+    if ((pub >= 0) && (PTL_AtomicLoad(&fe->ack) != pub))
+        return 0;                                   /* anderer Slot evtl. noch in Benutzung */
+
+    s = (pub == 0) ? 1 : 0;
+    if (fe->slot[s].nFrames > 0) CONV_free_ir(&fe->slot[s]);
+    if (0 != FIR_EQ_design(&fe->slot[s], t)) return -1;
+    fe->target = *t;
+    PTL_AtomicStore(&fe->pub, s);
+    return 1;
+}
+
+/*---------------------------------------------*/
+const conv_ir_t *FIR_EQ_current(fir_eq_t *fe)
+{   long pub = PTL_AtomicLoad(&fe->pub);
+
+    return (pub >= 0) ? &fe->slot[pub] : NULL;
+}
+
+/*---------------------------------------------*/
+void FIR_EQ_ack(fir_eq_t *fe, const conv_ir_t *ir)
+{
+    PTL_AtomicStore(&fe->ack, (NULL == ir) ? -1 : (long)(ir - fe->slot));
+}
+
+/*---------------------------------------------*/
+double FIR_EQ_error_dB(const fir_eq_target_t *t, double f_lo_Hz, double f_hi_Hz)
+{   const int n = FFT_MAX_SIZE;      /* fein genug, um zwischen die Stuetzstellen zu sehen */
+    fft_plan_t plan;
+    float *re, *im;
+    double m, ref, err = 0;
+    int i, k;
+
+    if (0 != FFT_plan_create(&plan, n)) return -1;
+    re = malloc(n * sizeof(float));
+    im = malloc((n/2 + 1) * sizeof(float));
+    if ((NULL == re) || (NULL == im) || (0 != design_taps(t, re)))
+    {   free(re);  free(im);
+        FFT_plan_destroy(&plan);
+        return -1;
+    }
+    for (i = FIR_EQ_TAPS; i < n; i++) re[i] = 0;
+    FFT_real_forward(&plan, re, re, im);
+
+    for (k = (int)ceil(f_lo_Hz * n / F_S); (k <= n/2) && (k <= f_hi_Hz * n / F_S); k++)
+    {   ref = target_mag(t, 2 * M_PI * k / n);
+        if (ref < 1e-3) continue;                   /* unter -60 dB zaehlt nicht */
+        m = sqrt((double)re[k] * re[k] + (double)im[k] * im[k]);
+        if (m < 1e-10) m = 1e-10;
+        if (fabs(20 * log10(m / ref)) > err) err = fabs(20 * log10(m / ref));
+    }
+
+    free(re);  free(im);
+    FFT_plan_destroy(&plan);
+    return err;
+}
+
+
+/****************** Threadfunktion *****************************************/
+PTL_THREAD_RET_TYPE FirEqThreadFunc(void* pt)
+{   sRam_t parameter;  // fuer lokale Kopie des shared RAM
+    long generation = -1;
+    fir_eq_target_t t;
+
+    printf("FirEqThreadFunc ist gestartet...");
+
+    do
+    {   sRamReadSnapshot(&parameter, &generation);
+
+        /* jedes Mal versuchen: ein zurueckgestellter Entwurf kommt dran,
+           sobald die Kette den vorigen bestaetigt hat */
+        if (parameter.flag_EQ_is_active && parameter.flag_EQ_linear_phase
+            && (NULL != parameter.FirEq))
+        {   FIR_EQ_set_target(&t, &parameter.TP, &parameter.BP, &parameter.HP,
+                              parameter.A_TP, parameter.A_BP, parameter.A_HP, parameter.B);
+            if (0 > FIR_EQ_update(parameter.FirEq, &t))
+                puts("FirEqThreadFunc: Entwurf fehlgeschlagen");
+        }
+
+        PTL_Sleep(0.02);
+
+    } while(parameter.cmd_end == 0);
+
+    printf("FirEqThreadFunc terminiert...");
+    PTL_SemSignal(&endSema);
+
+    return 0;
+}
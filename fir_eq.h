@@ -0,0 +1,88 @@
+/* fir_eq.h :
+   Equalizer linearphasig: derselbe Amplitudengang wie der Equalizer
+   aus TP, BP und HP (H_ges, siehe dig_filter.h), aber als FIR-Filter
+   mit symmetrischer Impulsantwort, also ohne Phasenverzerrung.
+
+   Entwurf durch Frequenzabtastung: |H_ges| wird an FIR_EQ_GRID/2+1
+   gleichmaessig verteilten Frequenzen 0 ... F_S/2 berechnet, mit Phase 0
+   zurueck transformiert, um FIR_EQ_DELAY verschoben und mit einem
+   Hann-Fenster auf FIR_EQ_TAPS Werte begrenzt. Angewendet wird das Filter
+   mit der partitionierten Faltung aus conv.h.
+
+   Latenz: FIR_EQ_DELAY (Mitte der Impulsantwort) + CONV_BLOCK.
+
+   Neu entworfen wird im Hintergrund (FirEqThreadFunc), sobald sich die
+   Einstellung aendert. Entwurf und Kette tauschen die Impulsantwort ohne
+   Sperre ueber zwei Slots aus: der Entwerfer veroeffentlicht einen neuen
+   Slot (pub), die Kette meldet zurueck, welchen sie benutzt (ack). Der
+   andere Slot wird erst wieder beschrieben, wenn die Kette den
+   veroeffentlichten bestaetigt hat; vorher wartet der Entwurf. Die Kette
+   uebernimmt die neue Impulsantwort an der naechsten Blockgrenze der
+   Faltung und blendet dabei einen Block lang ueber.
+*/
+
+#ifndef _fir_eq_h_
+#define _fir_eq_h_
+
+#include "ptl_lib.h"
+#include "dig_filter.h"
+#include "conv.h"
+
+#define FIR_EQ_TAPS    8191                  /* ungerade: Verzoegerung ganzzahlig */
+#define FIR_EQ_DELAY   ((FIR_EQ_TAPS - 1) / 2)
+#define FIR_EQ_GRID    16384                 /* Stuetzstellen, Zweierpotenz > TAPS */
+#define FIR_EQ_LATENCY (FIR_EQ_DELAY + CONV_BLOCK)   /* ca. 99ms bei 44,1kHz */
+
+/* Einstellung, aus der entworfen wird */
+typedef struct
+{   IIR_2_coeff_t TP, BP, HP;
+    float A_TP, A_BP, A_HP, B;
+} fir_eq_target_t;
+
+/* Austausch Entwerfer -> Kette */
+typedef struct
+{   conv_ir_t slot[2];
+    PTL_atomic_t pub;          /* Slot des neuesten Entwurfs, -1: noch keiner */
+    PTL_atomic_t ack;          /* zuletzt von der Kette bestaetigt, -1: keiner */
+    fir_eq_target_t target;    /* Einstellung von pub, nur fuer den Entwerfer */
+} fir_eq_t;
+
+/* leerer Austausch, noch kein Entwurf */
+void FIR_EQ_init(fir_eq_t *fe);
+
+/* Einstellung zusammenstellen (mit memset, damit memcmp geht) */
+void FIR_EQ_set_target(fir_eq_target_t *t,
+                       const IIR_2_coeff_t *p_TP,
+                       const IIR_2_coeff_t *p_BP,
+                       const IIR_2_coeff_t *p_HP,
+                       float A_TP,
+                       float A_BP,
+                       float A_HP,
+                       float B);
+
+/* FIR-Filter fuer t entwerfen. Rueckgabe: 0 fuer ok, -1 bei Fehler */
+int FIR_EQ_design(conv_ir_t *ir, const fir_eq_target_t *t);
+
+/* Entwerfer: neu entwerfen und veroeffentlichen, wenn t sich geaendert hat
+   und die Kette den letzten Entwurf bestaetigt hat. Nur aus einem Thread.
+   Rueckgabe: 1 neu veroeffentlicht, 0 nichts zu tun oder Kette noch nicht
+   so weit, -1 bei Fehler */
+int FIR_EQ_update(fir_eq_t *fe, const fir_eq_target_t *t);
+
+/* Kette: neuester Entwurf, NULL: noch keiner */
+const conv_ir_t *FIR_EQ_current(fir_eq_t *fe);
+
+/* Kette: ab jetzt wird hoechstens ir benutzt, ein Wert von
+   FIR_EQ_current(); auch wenn die Stufe aus ist, damit der Entwerfer
+   weiter kann. Alle frueheren Zugriffe auf den anderen Slot muessen
+   abgeschlossen sein */
+void FIR_EQ_ack(fir_eq_t *fe, const conv_ir_t *ir);
+
+/* groesste Abweichung des Amplitudengangs des Entwurfs fuer t von |H_ges|
+   in dB, zwischen f_lo_Hz und f_hi_Hz. Rueckgabe: -1 bei Fehler */
+double FIR_EQ_error_dB(const fir_eq_target_t *t, double f_lo_Hz, double f_hi_Hz);
+
+/* Entwerfer im Hintergrund, beobachtet sRam.FirEq */
+PTL_THREAD_RET_TYPE FirEqThreadFunc(void* pt);
+
+#endif
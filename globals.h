@@ -5,11 +5,15 @@
 
 
 #define N_PLOT_POINTS 512    /* Punkte Amplitudengang */
+#define N_SPEC_BANDS  96     /* Baender Spektrum, logarithmisch 20Hz...20kHz */
 #define F_S           44100  /* Abtasfrequenz */
 
 #include "ptl_lib.h"
 #include "dig_filter.h"
+#include "peq.h"
 #include "echo.h"
+#include "conv.h"
+#include "fir_eq.h"
 
 /* struct shared RAM */
 typedef struct
@@ -21,7 +25,17 @@ typedef struct
    int flag_EQ_is_active;   /* ==0 bedeutet: ohne EQ */
    float A_TP,A_BP,A_HP; /* Gewichte Equalizer, Werte -1...10 */
    IIR_2_coeff_t TP,BP,HP;
+   int flag_EQ_linear_phase; /* !=0: Equalizer als linearphasiges FIR-Filter */
+   fir_eq_t *FirEq;         /* Entwuerfe dafuer, NULL: nicht verfuegbar */
    float B; /* Gewichtung nach Equ., Uebersteuerung vermeiden, 0<B<1 */
+   int flag_PEQ_is_active;  /* ==0 bedeutet: ohne parametrischen EQ */
+   peq_band_t PEQ_band[PEQ_MAX_BANDS]; /* Einstellung der Baender */
+   peq_coeff_t PEQ;         /* daraus berechnet, PEQ.nBands Baender */
+   int flag_dither;         /* !=0: TPDF-Dither bei der Wandlung nach 16 Bit */
+   int flag_Conv_is_active; /* ==0 bedeutet: ohne Faltungshall */
+   float Conv_wet;          /* Anteil des Halls, 0...1 */
+   const conv_ir_t *Conv_IR; /* Impulsantwort, NULL: keine geladen. Wird einmal
+                               geladen und bleibt bis Programmende gueltig */
 }sRam_t;
 
 /* struct shared RAM plot window */
@@ -30,12 +44,22 @@ typedef struct
    float H_dB[N_PLOT_POINTS];
 }plot_data_t;
 
+/* Spektrum des gespielten Signals, wie plot_data durch plotSema geschuetzt */
+typedef struct
+{  float f_Hz[N_SPEC_BANDS];     /* Mittenfrequenz der Baender */
+   float level_dB[N_SPEC_BANDS]; /* gemittelter Pegel in dBFS */
+   float peak_dB[N_SPEC_BANDS];  /* Spitzenwert, gehalten und abfallend */
+}spec_data_t;
+
 /* globale Daten */
 extern sRam_t sRam;
 extern plot_data_t plot_data;
+extern spec_data_t spec_data;
 extern PTL_sem_t sRamSema;
 extern PTL_sem_t endSema;
 extern PTL_sem_t plotSema;
+extern PTL_atomic_t plotDirty; /* !=0: plot_data oder spec_data neu, die GUI
+                                  zeichnet dann das Plot-Fenster neu */
 
 
 #endif
@@ -5,6 +5,7 @@
 #include "dig_filter.h"
 #include "echo.h"
 #include "globals.h"
+#include "sram_snapshot.h"
 
 #include "gui.h"
 #include "gui_plotter.h"
@@ -17,8 +18,8 @@ static Window *w, *w_plot;
 static Timer *T;
 
 /* Controls für die GUI */
-Control *cbParametricEQ, *cbHideBodeDisplay;
-Control *cbEcho;
+Control *cbParametricEQ, *cbHideBodeDisplay, *cbLinearPhase;
+Control *cbEcho, *cbReverb;
 Control *file_name, *volume;
 Control *f_u, *f_0, *q, *f_o, *a_tp, *a_bp, *a_hp, *b;
 Control *gain, *n_0, *feedback;
@@ -28,11 +29,13 @@ Control *gain, *n_0, *feedback;
 
 
 void use_cbParametricEQ(Control *b);
+void use_cbLinearPhase(Control *b);
 
 void hide_plot_win_CB(Control *c);
 
 
 void use_cbEcho(Control *b);
+void use_cbReverb(Control *b);
 
 
 void redraw_main_win(Window *w, Graphics *g);
@@ -54,7 +57,7 @@ void gui(int argc, char *argv[])
   w = new_window(app,rect(50,50,640,660),
                 "Wave-Player", STANDARD_WINDOW);
   w_plot = new_window(app,rect(400,200,N_X_PLOT_WIN,N_Y_PLOT_WIN),
-                "EQ-Amplitudengang", (TITLEBAR|MINIMIZE));
+                "EQ-Amplitudengang und Spektrum", (TITLEBAR|MINIMIZE));
 
   place_gui_elements_file();
   place_gui_elements_EQ();
@@ -71,7 +74,7 @@ void gui(int argc, char *argv[])
   show_window(w);
   show_window(w_plot);
 
-  T = new_timer(app, Timer_CB, 1000);
+  T = new_timer(app, Timer_CB, 100);   /* prueft plotDirty, hoechstens 10 Bilder/s */
   on_window_close (w_plot, close_plot_win);
   on_window_close (w, close_win_and_shutdown);
 
@@ -97,15 +100,28 @@ void use_cbParametricEQ(Control *b)
     }
     PTL_SemWait(&sRamSema);
     sRam.flag_EQ_is_active = flag_use_EQ;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
 }
 
 
+/*-----------------------------*/
+void use_cbLinearPhase(Control *b)
+{
+    PTL_SemWait(&sRamSema);
+    sRam.flag_EQ_linear_phase = is_checked(b) ? 1 : 0;
+    sRamPublish();
+    PTL_SemSignal(&sRamSema);
+    printf("Equalizer %s\n", is_checked(b) ? "linearphasig (FIR)" : "minimalphasig (IIR)");
+}
+
+
 /*-----------------------------*/
 void load_file(Control *c)
 {
     PTL_SemWait(&sRamSema);
     strcpy(sRam.Dateiname, get_control_text(file_name));
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("Dateiname: %s\n", get_control_text(file_name));
 }
@@ -114,6 +130,7 @@ void play_file(Control *c)
 {
     PTL_SemWait(&sRamSema);
     sRam.cmd_play = 1;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("Play");
 }
@@ -123,6 +140,7 @@ void stop_file(Control *c)
     PTL_SemWait(&sRamSema);
     sRam.cmd_play = 0;
     sRam.cmd_end = 0;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("Stop");
 }
@@ -131,6 +149,7 @@ void change_volume(Control *c)
 {
     PTL_SemWait(&sRamSema);
     sRam.B = (float)get_control_value(volume)/100;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("Volume: %f\n",(float)get_control_value(volume)/100);
 }
@@ -167,6 +186,19 @@ void use_cbEcho(Control *b)
     }
     PTL_SemWait(&sRamSema);
     sRam.flag_Echo_is_active = flag_use_Echo;
+    sRamPublish();
+    PTL_SemSignal(&sRamSema);
+}
+
+/*-----------------------------*/
+
+void use_cbReverb(Control *b)
+{
+    PTL_SemWait(&sRamSema);
+    sRam.flag_Conv_is_active = is_checked(b) ? 1 : 0;
+    if (sRam.flag_Conv_is_active && (NULL == sRam.Conv_IR))
+        puts("keine Impulsantwort geladen, Option -ir <wav>");
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
 }
 
@@ -175,7 +207,9 @@ void use_cbEcho(Control *b)
 void change_n0(Control *c)
 {
     PTL_SemWait(&sRamSema);
-    sRam.Echo.delay_n0 = get_control_value(n_0);
+    sRam.Echo.tap[0].delay_n[0] = get_control_value(n_0);
+    sRam.Echo.tap[0].delay_n[1] = get_control_value(n_0);
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("N_0: %d\n",get_control_value(n_0));
 }
@@ -183,7 +217,8 @@ void change_n0(Control *c)
 void change_gain(Control *c)
 {
     PTL_SemWait(&sRamSema);
-    sRam.Echo.gain = (float)get_control_value(gain)/100;
+    sRam.Echo.tap[0].gain = (float)get_control_value(gain)/100;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("Gain: %f\n",(float)get_control_value(gain)/100);
 }
@@ -192,6 +227,7 @@ void change_feedback(Control *c)
 {
     PTL_SemWait(&sRamSema);
     sRam.Echo.feedback = (float)get_control_value(feedback)/100;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("Feedback: %f\n",(float)get_control_value(feedback)/100);
 }
@@ -202,6 +238,7 @@ void change_f_u(Control *c)
     fu = (float)get_control_value(f_u);
     PTL_SemWait(&sRamSema);
     sRam.TP = compute_TP_Filter_Parameters(fu, F_S);
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
 }
 
@@ -212,6 +249,7 @@ void change_f_0(Control *c)
     q0 = (float)get_control_value(q) / 10;
     PTL_SemWait(&sRamSema);
     sRam.BP = compute_BP_Filter_Parameters(f0, q0, F_S);
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
 }
 
@@ -221,6 +259,7 @@ void change_f_o(Control *c)
     fo = (float)get_control_value(f_o);
     PTL_SemWait(&sRamSema);
     sRam.HP = compute_HP_Filter_Parameters(fo, F_S);
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
 }
 
@@ -228,6 +267,7 @@ void change_a_tp(Control *c)
 {
     PTL_SemWait(&sRamSema);
     sRam.A_TP = (float)(get_control_value(a_tp)-9)/10;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("A_TP: %f\n",(float)(get_control_value(a_tp)-9)/10);
 }
@@ -236,6 +276,7 @@ void change_a_bp(Control *c)
 {
     PTL_SemWait(&sRamSema);
     sRam.A_BP = (float)(get_control_value(a_bp)-9)/10;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("A_BP: %f\n",(float)(get_control_value(a_bp)-9)/10);
 }
@@ -244,6 +285,7 @@ void change_a_hp(Control *c)
 {
     PTL_SemWait(&sRamSema);
     sRam.A_HP = (float)(get_control_value(a_hp)-9)/10;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("A_HP: %f\n",(float)(get_control_value(a_hp)-9)/10);
 }
@@ -252,6 +294,7 @@ void change_b(Control *c)
 {
     PTL_SemWait(&sRamSema);
     sRam.B = (float)get_control_value(b)/100;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     printf("A_HP: %f\n",(float)get_control_value(b)/100);
 }
@@ -301,8 +344,12 @@ void redraw_main_win(Window *w, Graphics *g)
 }
 
 /*-----------------------------*/
+/* graphapp darf nur aus diesem Thread zeichnen: die Rechen-Threads setzen
+   plotDirty, hier wird nur neu gezeichnet, wenn sich etwas geaendert hat */
 void Timer_CB(Timer *t)
 {
+    if (0 == PTL_AtomicLoad(&plotDirty)) return;
+    PTL_AtomicStore(&plotDirty, 0);
     redraw_window(w_plot);
 }
 
@@ -320,11 +367,16 @@ void close_plot_win(Window *w)
     PTL_SemWait(&sRamSema);
     sRam.cmd_play = 0;
     sRam.cmd_end  = 1;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     puts("WAV-Player: main() wartet auf das Ende des Player-Threads...\n");
     PTL_SemWait(&endSema);
     puts("WAV-Player: main() wartet auf das Ende des Plotter-Threads...\n");
     PTL_SemWait(&endSema);
+    puts("WAV-Player: main() wartet auf das Ende des Spektrum-Threads...\n");
+    PTL_SemWait(&endSema);
+    puts("WAV-Player: main() wartet auf das Ende des FIR-Entwurfs...\n");
+    PTL_SemWait(&endSema);
     puts("threads beendet...");
     puts("WAV-Player: main() ist beendet...\n");
     exit(-1);
@@ -379,8 +431,12 @@ void place_gui_elements_EQ(void)
     cbParametricEQ = new_check_box(w, r, "use Parametric Filters",
                              use_cbParametricEQ);
     r.x += (10 + r.width);
+    r.width = 150;
     cbHideBodeDisplay = new_check_box(w,r, "hide Bode-Plot",
                         hide_plot_win_CB);
+    r.x += (10 + r.width);
+    cbLinearPhase = new_check_box(w,r, "linear phase",
+                        use_cbLinearPhase);
 
     /********************************************************/
     /* TODO: hier Ihre GUI-Elemente für die Filter erzeugen */
@@ -429,9 +485,13 @@ void place_gui_elements_Echo(void)
 {   Rect r;
     int space;
 
-    r = rect(30, 520, 450, 20);
+    r = rect(30, 520, 250, 20);
     cbEcho = new_check_box(w, r, "use Echo",
                                 use_cbEcho);
+    r.x = 290;
+    cbReverb = new_check_box(w, r, "use Reverb",
+                                use_cbReverb);
+    r.x = 30;
     /********************************************************/
     /* TODO: hier Ihre GUI-Elemente für Echo erzeugen       */
     /********************************************************/
@@ -447,7 +507,7 @@ void place_gui_elements_Echo(void)
     r.width = 450;
     gain = new_scroll_bar(w,r,50,1,change_gain);
     r.y += space;
-    n_0 = new_scroll_bar(w,r,(F_S-1),1,change_n0);
+    n_0 = new_scroll_bar(w,r,ECHO_MAX_DELAY,1,change_n0);
     r.y += space;
     feedback = new_scroll_bar(w,r,100,1,change_feedback);
 }
@@ -456,9 +516,11 @@ void init_gui_elements(void)
 {
     uncheck(cbParametricEQ);
     uncheck(cbHideBodeDisplay);
+    uncheck(cbLinearPhase);
 
 
     uncheck(cbEcho);
+    uncheck(cbReverb);
 
 }
 /*-----------------------------*/
@@ -26,6 +26,8 @@ static int H_dB_to_pixel_y(float H_dB, Trafo_t t);
 static void plot_f_axis_and_scale(Window *w, Graphics *g, Trafo_t t);
 static void plot_H_dB_axis_and_scale(Window *w, Graphics *g, Trafo_t t);
 static void plot_H_db_over_frequency(Window *w, Graphics *g, Trafo_t t);
+static void plot_spectrum(Window *w, Graphics *g, Trafo_t t);
+static void plot_dBFS_scale(Window *w, Graphics *g, Trafo_t t);
 static float frequency_clipping(float f_Hz);
 static float H_dB_clipping(float H_dB);
 
@@ -159,6 +161,51 @@ static void plot_H_db_over_frequency(Window *w, Graphics *g, Trafo_t t)
 
 }
 
+/*-------------------------------------------------------------*/
+/* Spektrum als Balken, Spitzenwerte als Striche darueber.
+   dBFS -> Pixel wie |H| um 40 dB verschoben: 0 dBFS oben, -80 dBFS unten */
+static void plot_spectrum(Window *w, Graphics *g, Trafo_t t)
+{   static spec_data_t s;
+    int k, x0, x1, y, y0;
+    double r;
+
+    /* nur umkopieren, gezeichnet wird ohne plotSema */
+    PTL_SemWait(&plotSema);
+    s = spec_data;
+    PTL_SemSignal(&plotSema);
+
+    if (s.f_Hz[0] <= 0) return;     /* Spektrum-Thread laeuft noch nicht */
+    r  = sqrt(s.f_Hz[1] / s.f_Hz[0]);
+    y0 = H_dB_to_pixel_y(-40, t);
+    for (k = 0; k < N_SPEC_BANDS; k++)
+    {   x0 = frequ_to_pixel_x(frequency_clipping(s.f_Hz[k] / r), t);
+        x1 = frequ_to_pixel_x(frequency_clipping(s.f_Hz[k] * r), t);
+        y  = H_dB_to_pixel_y(H_dB_clipping(s.level_dB[k] + 40), t);
+        if (y < y0)
+        {   set_colour(g, rgb(0xA0,0xE0,0xA0));
+            fill_rect(g, rect(x0, y, x1 - x0, y0 - y));
+        }
+        y  = H_dB_to_pixel_y(H_dB_clipping(s.peak_dB[k] + 40), t);
+        if (y < y0)
+        {   set_colour(g, RED);
+            draw_line(g, pt(x0, y), pt(x1, y));
+        }
+    }
+}
+/*-------------------------------------------------------------*/
+/* rechte Achse fuer das Spektrum */
+static void plot_dBFS_scale(Window *w, Graphics *g, Trafo_t t)
+{   int i, py_H;
+    char strbuf[20];
+
+    draw_utf8(g, pt(t.r.width-t.border_x+5,t.border_y-30), "dBFS", strlen("dBFS"));
+    for(i=0; i>=-80; i-=20)
+    {   py_H = H_dB_to_pixel_y(i+40, t);
+        sprintf(strbuf,"%3d",i);
+        draw_utf8(g, pt(t.r.width-t.border_x+5,py_H-10), strbuf, strlen(strbuf));
+    }
+}
+
 /*-------------------------------------------------------------*/
 static float frequency_clipping(float f_Hz)
 {   if(f_Hz<1) return 1.0;
@@ -185,17 +232,17 @@ void redraw_plot_win(Window *w, Graphics *g)
     {   puts("Window too small to plot...");
         return;
     }
-    set_colour(g, BLACK);
     set_line_width(g, 1);
+    plot_spectrum(w, g, t);
+    set_colour(g, BLACK);
     plot_f_axis_and_scale(w, g, t);
     plot_H_dB_axis_and_scale(w, g, t);
+    plot_dBFS_scale(w, g, t);
 
     set_colour(g, BLUE);
     set_line_width(g, 3);
     plot_H_db_over_frequency(w, g, t);
 
-    puts("redraw_plot_win");
-
 }
 /*-----------------------------*/
 
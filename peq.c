@@ -0,0 +1,148 @@
+/* peq.c :
+   Parametrischer Equalizer mit N Baendern in Kaskade, siehe peq.h.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "peq.h"
+
+
+/*-------------------------------------------------------------*/
+/* Koeffizienten                                               */
+/*-------------------------------------------------------------*/
+int PEQ_design(peq_coeff_t *c, const peq_band_t *band, int nBands, double fa_Hz)
+{
+    peq_coeff_t tmp;
+    IIR_2_coeff_t p;
+    int k;
+
+    if ((nBands < 0) || (nBands > PEQ_MAX_BANDS)) return -1;
+
+    tmp.nBands = nBands;
+    for (k = 0; k < nBands; k++) {
+        if ((band[k].f0_Hz <= 0) || (band[k].f0_Hz >= fa_Hz / 2) || (band[k].Q <= 0))
+            return -1;
+
+        /* Glocke und Kuhschwanz mit 0 dB exakt durchreichen: in float
+           ist b == a nur ungefaehr, tiefe Baender verstaerken den Rest
+           zu hoerbarem Rundungsrauschen */
+        if ((band[k].gain_dB == 0) && ((band[k].type == PEQ_PEAK)
+            || (band[k].type == PEQ_LOWSHELF) || (band[k].type == PEQ_HIGHSHELF))) {
+            p.b0 = 1;
+            p.b1 = p.b2 = p.a1 = p.a2 = 0;
+        }
+        else switch (band[k].type) {
+            case PEQ_PEAK:
+                p = compute_Peak_Filter_Parameters(band[k].f0_Hz, band[k].Q, band[k].gain_dB, fa_Hz);
+                break;
+            case PEQ_LOWSHELF:
+                p = compute_LowShelf_Filter_Parameters(band[k].f0_Hz, band[k].Q, band[k].gain_dB, fa_Hz);
+                break;
+            case PEQ_HIGHSHELF:
+                p = compute_HighShelf_Filter_Parameters(band[k].f0_Hz, band[k].Q, band[k].gain_dB, fa_Hz);
+                break;
+            case PEQ_LOWPASS:
+                p = compute_TP_Filter_Parameters(band[k].f0_Hz, fa_Hz);
+                break;
+            case PEQ_HIGHPASS:
+                p = compute_HP_Filter_Parameters(band[k].f0_Hz, fa_Hz);
+                break;
+            case PEQ_NOTCH:
+                p = compute_Notch_Filter_Parameters(band[k].f0_Hz, band[k].Q, fa_Hz);
+                break;
+            default:
+                return -1;
+        }
+        tmp.b0[k] = p.b0;
+        tmp.b1[k] = p.b1;
+        tmp.b2[k] = p.b2;
+        tmp.a1[k] = p.a1;
+        tmp.a2[k] = p.a2;
+    }
+
+    *c = tmp;
+    return 0;
+}
+
+int PEQ_graphic_bands(peq_band_t *band, int nBands, double f_lo_Hz, double f_hi_Hz,
+                      const float *gain_dB)
+{
+    double r, bw2, Q;
+    int k;
+
+    if ((nBands < 1) || (nBands > PEQ_MAX_BANDS) || (f_lo_Hz <= 0) || (f_hi_Hz < f_lo_Hz))
+        return -1;
+
+    /* Frequenzverhaeltnis benachbarter Baender und daraus die Guete,
+       bei der sich benachbarte Glocken an der -3dB-Grenze beruehren */
+    r = (nBands > 1) ? pow(f_hi_Hz / f_lo_Hz, 1.0 / (nBands - 1)) : 2.0;
+    bw2 = r;                          /* 2^Bandbreite in Oktaven */
+    Q = sqrt(bw2) / (bw2 - 1);
+
+    for (k = 0; k < nBands; k++) {
+        band[k].type    = PEQ_PEAK;
+        band[k].f0_Hz   = (float)(f_lo_Hz * pow(r, k));
+        band[k].Q       = (float)Q;
+        band[k].gain_dB = (NULL != gain_dB) ? gain_dB[k] : 0;
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------*/
+/* Frequenzgang                                                */
+/*-------------------------------------------------------------*/
+void PEQ_mag2_sweep_mul(const H_sweep_t *sw, const peq_coeff_t *c, float *mag2)
+{
+    IIR_2_coeff_t p;
+    int k;
+
+    for (k = 0; k < c->nBands; k++) {
+        p.b0 = c->b0[k];
+        p.b1 = c->b1[k];
+        p.b2 = c->b2[k];
+        p.a1 = c->a1[k];
+        p.a2 = c->a2[k];
+        IIR_2_mag2_sweep_mul(sw, &p, mag2);
+    }
+}
+
+/*-------------------------------------------------------------*/
+/* Filtern                                                     */
+/*-------------------------------------------------------------*/
+void PEQ_reset(peq_state_t *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+void PEQ_filter_block(peq_state_t *s, const peq_coeff_t *c, float *xy, int nFrames)
+{
+    double b0, b1, b2, a1, a2, x1, x2, y1, y2, x0, y0;
+    int k, ch, i;
+
+    /* Band fuer Band ueber den ganzen Block: Koeffizienten und Zustand
+       des Bandes bleiben waehrend der inneren Schleife in Registern,
+       gerechnet wird in double */
+    for (k = 0; k < c->nBands; k++) {
+        b0 = c->b0[k]; b1 = c->b1[k]; b2 = c->b2[k];
+        a1 = c->a1[k]; a2 = c->a2[k];
+
+        for (ch = 0; ch < 2; ch++) {
+            x1 = s->x1[ch][k]; x2 = s->x2[ch][k];
+            y1 = s->y1[ch][k]; y2 = s->y2[ch][k];
+
+            for (i = ch; i < 2 * nFrames; i += 2) {
+                x0 = xy[i];
+                y0 = b0 * x0 + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+                x2 = x1;
+                x1 = x0;
+                y2 = y1;
+                y1 = y0;
+                xy[i] = (float)y0;
+            }
+
+            s->x1[ch][k] = x1; s->x2[ch][k] = x2;
+            s->y1[ch][k] = y1; s->y2[ch][k] = y2;
+        }
+    }
+}
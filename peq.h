@@ -0,0 +1,70 @@
+/* peq.h :
+   Parametrischer Equalizer mit N Baendern in Kaskade.
+
+   Jedes Band ist ein Filter 2. Ordnung (Glocke, Kuhschwanz, TP, HP
+   oder Kerbfilter), die Baender werden hintereinander geschaltet.
+   Die Koeffizienten liegen als Struktur von Feldern vor (alle b0
+   hintereinander, alle b1, ...), damit die Schleife ueber die Baender
+   ohne Umwege durch den Speicher laeuft. Der Rechenaufwand pro Block
+   waechst linear mit der Anzahl der Baender.
+*/
+
+#ifndef _peq_h_
+#define _peq_h_
+
+#include "dig_filter.h"
+
+#define PEQ_MAX_BANDS 31     /* genug fuer einen Terzband-EQ */
+
+/* Bandtypen */
+#define PEQ_PEAK       0     /* Glocke: gain_dB bei f0_Hz */
+#define PEQ_LOWSHELF   1     /* Kuhschwanz unterhalb f0_Hz */
+#define PEQ_HIGHSHELF  2     /* Kuhschwanz oberhalb f0_Hz */
+#define PEQ_LOWPASS    3     /* TP, Grenzfrequenz f0_Hz (Q, gain ohne Wirkung) */
+#define PEQ_HIGHPASS   4     /* HP, Grenzfrequenz f0_Hz (Q, gain ohne Wirkung) */
+#define PEQ_NOTCH      5     /* Kerbfilter bei f0_Hz (gain ohne Wirkung) */
+
+/* Einstellung eines Bandes, so wie der Benutzer sie sieht */
+typedef struct
+{   int   type;      /* PEQ_PEAK ... PEQ_NOTCH */
+    float f0_Hz;     /* Mitten- bzw. Grenzfrequenz, 0 < f0_Hz < fa/2 */
+    float Q;         /* Guete, > 0 */
+    float gain_dB;   /* Anhebung (>0) oder Absenkung (<0) */
+} peq_band_t;
+
+/* Koeffizienten aller Baender, Struktur von Feldern */
+typedef struct
+{   int   nBands;    /* 0 ... PEQ_MAX_BANDS */
+    float b0[PEQ_MAX_BANDS], b1[PEQ_MAX_BANDS], b2[PEQ_MAX_BANDS];
+    float a1[PEQ_MAX_BANDS], a2[PEQ_MAX_BANDS];
+} peq_coeff_t;
+
+/* Filterzustand fuer einen Stereo-Strom, erster Index: 0 links, 1 rechts.
+   double wie bei IIR_2_state_t: bei hoher Guete verstaerkt die Rueckkopplung
+   Rundungsfehler des Zustands, in float waeren das mehrere LSB */
+typedef struct
+{   double x1[2][PEQ_MAX_BANDS], x2[2][PEQ_MAX_BANDS];
+    double y1[2][PEQ_MAX_BANDS], y2[2][PEQ_MAX_BANDS];
+} peq_state_t;
+
+/* Koeffizienten fuer nBands Baender berechnen.
+   Rueckgabe: 0 fuer ok, -1 bei ungueltigen Parametern (c bleibt dann
+   unveraendert) */
+int  PEQ_design(peq_coeff_t *c, const peq_band_t *band, int nBands, double fa_Hz);
+
+/* grafischer EQ: nBands Glocken, logarithmisch verteilt von f_lo_Hz bis
+   f_hi_Hz, Q passend zum Bandabstand; gain_dB darf NULL sein (0 dB).
+   Rueckgabe: 0 fuer ok, -1 bei ungueltigen Parametern */
+int  PEQ_graphic_bands(peq_band_t *band, int nBands, double f_lo_Hz, double f_hi_Hz,
+                       const float *gain_dB);
+
+void PEQ_reset(peq_state_t *s);
+
+/* Block von nFrames Stereo-Wertepaaren filtern, xy liegt abwechselnd
+   Links,Rechts und wird ueberschrieben */
+void PEQ_filter_block(peq_state_t *s, const peq_coeff_t *c, float *xy, int nFrames);
+
+/* |H|^2 der ganzen Kaskade an allen Punkten des Sweeps mit mag2 multiplizieren */
+void PEQ_mag2_sweep_mul(const H_sweep_t *sw, const peq_coeff_t *c, float *mag2);
+
+#endif
@@ -1,137 +1,728 @@
-/* player_thread.c */
+/* player_thread.c
+
+   Der Player ist eine Pipeline aus drei Threads, verbunden durch PTL-Ringe
+   mit Bloecken fester Groesse:
+
+     Leser (WavPlayerThreadFunc) --qDsp--> DSP --qOut--> Ausgabe (sndWrite)
+
+   Eine langsame Platte haelt so nur den Leser auf; solange noch Bloecke in
+   den Queues stehen, laeuft die Soundkarte weiter. Die Tiefe der Queues
+   (PlayerSetQueueDepth) tauscht Reserve gegen Latenz: jeder Slot sind
+   N_FRAMES Wertepaare, bei 44,1kHz also knapp 93ms.
+
+   Die Bloecke werden an Ort und Stelle im Ring gefuellt und gelesen
+   (PTL_RingWriteReserve/-Commit), nichts wird beim Weiterreichen kopiert.
+   Solange die Reservierung einen Slot liefert, laeuft das ohne Semaphore;
+   erst ein voller oder leerer Ring legt die Seite auf einer Semaphore
+   schlafen, die andere weckt sie beim naechsten Commit (player_pipe_t).
+   Ein Slot in qDsp
+   verweist bei abgebildeten Dateien in die Abbildung, sonst wird in seinen
+   eigenen Puffer gelesen. Die DSP-Stufe rechnet von dort in den Slot von
+   qOut, als float direkt vor der Wandlung nach 16 Bit. Die Ausgabe wandelt
+   im mmap-Modus gleich in den Ringpuffer der Soundkarte, sonst in einen
+   Puffer fuer sndWrite().
+*/
 
 
 #include "player_thread.h"
-#include "dig_filter.h"
-#include "echo.h"
+#include "dsp_chain.h"
+#include "sram_snapshot.h"
+#include "spectrum_thread.h"
 
 #define N 8192             /* Anzahl der El. im soundcard Buffer */
+#define N_FRAMES (N/2)     /* Anzahl der Stereo-Wertepaare pro Block */
+
+/* ein Block, wie er in PlayerQueueBenchmark() laeuft */
+typedef struct
+{   int nFrames;           /* gueltige Wertepaare in data, 0...N_FRAMES */
+    int flags;             /* BLOCK_... */
+    short data[N];         /* Links,Rechts abwechselnd */
+} player_block_t;
+
+/* ein Slot von qOut */
+typedef struct
+{   int nFrames;           /* gueltige Wertepaare in data, 0...N_FRAMES */
+    int flags;             /* BLOCK_... */
+    float data[N];         /* fertig fuer DSP_float_to_s16() mit gain 1 */
+} player_out_t;
+
+/* ein Slot von qDsp */
+typedef struct
+{   int nFrames;           /* gueltige Wertepaare ab data, 0...N_FRAMES */
+    int flags;             /* BLOCK_... */
+    const short *data;     /* in die Abbildung oder auf buf */
+    short buf[N];          /* Lesepuffer, wenn die Datei nicht abgebildet ist */
+} player_in_t;
+
+/* Ring, ein Schreiber, ein Leser; blockiert wird nur bei vollem oder
+   leerem Ring */
+typedef struct
+{   PTL_ring_t ring;       /* naechste Zweierpotenz >= depth Slots */
+    int depth;             /* davon benutzt */
+    PTL_atomic_t writerWaits; /* 1: Schreiber schlaeft auf freeSema */
+    PTL_atomic_t readerWaits; /* 1: Leser schlaeft auf fullSema */
+    PTL_sem_t freeSema;    /* weckt den Schreiber, anfangs 0 */
+    PTL_sem_t fullSema;    /* weckt den Leser, anfangs 0 */
+} player_pipe_t;
+
+#define BLOCK_NEW_STREAM 1 /* erster Block einer Datei: Filterzustand loeschen */
+#define BLOCK_END_STREAM 2 /* Dateiende oder stop, ohne Daten */
+#define BLOCK_TERMINATE  4 /* Programmende, Thread beenden */
+
+static player_pipe_t qDsp;     /* Leser -> DSP, player_in_t */
+static player_pipe_t qOut;     /* DSP -> Ausgabe, player_out_t */
+static PTL_sem_t drainSema;    /* Ausgabe -> Leser: END_STREAM ist durch */
+static PTL_sem_t stageEndSema; /* DSP, Ausgabe -> Leser: Thread beendet */
+static int queueDepth = PLAYER_QUEUE_DEPTH_DEFAULT;
+static PTL_atomic_t queuesReady = 0; /* 1: Ringe und statsSema bestehen */
+static sndConfig_t sndCfg;     /* Puffereinstellung der Soundkarte */
+static int sndCfgValid = 0;    /* 0: PLAYER_SOUND_PROFILE_DEFAULT */
+static sndStats_t outStats;    /* Kopie fuer PlayerGetSoundStats, unter statsSema */
+static int outStatsValid = 0;  /* 0: Soundkarte nicht offen */
+static PTL_sem_t statsSema;   /* auch fuer queuesReady und die Getter */
+static PTL_atomic_t statsUsers = 0; /* Getter zwischen stats_enter und stats_leave */
+static volatile int dspLatency = 0;  /* fuer PlayerGetDspLatency */
+
+/* Prototyp der Funktionen, die der Thread nutzt */
+static PTL_THREAD_RET_TYPE DspThreadFunc(void* pt);
+static PTL_THREAD_RET_TYPE OutputThreadFunc(void* pt);
+static void stop_playing(void);
+static void stop_pipeline(int nStages);
+static void publish_stats(SndDevice_t *psd);
+static int  stats_enter(void);
+static void stats_leave(void);
+static int   pipe_create(player_pipe_t *p, unsigned int slotSize, int depth);
+static void  pipe_destroy(player_pipe_t *p);
+static unsigned int pipe_write_try(player_pipe_t *p, void **slot);
+static void *pipe_write_begin(player_pipe_t *p);
+static void  pipe_write_end(player_pipe_t *p);
+static void *pipe_read_begin(player_pipe_t *p);
+static void  pipe_read_end(player_pipe_t *p);
+
+
+/*---------------------------------------------*/
+int PlayerSetQueueDepth(int nSlots)
+{
+    if (PTL_AtomicLoad(&queuesReady) || (nSlots < 1) || (nSlots > PLAYER_QUEUE_DEPTH_MAX)) return -1;
+    queueDepth = nSlots;
+    return 0;
+}
+
+/*---------------------------------------------*/
+int PlayerSetSoundProfile(const char *name)
+{   sndConfig_t cfg;
+
+    if (PTL_AtomicLoad(&queuesReady) || (0 != sndGetProfile(name, &cfg))) return -1;
+    sndCfg = cfg;
+    sndCfgValid = 1;
+    return 0;
+}
+
+/*---------------------------------------------*/
+int PlayerGetSoundStats(sndStats_t *st)
+{   int ret = -1;
+
+    /* die Soundkarte gehoert dem Ausgabe-Thread, hier nur seine Kopie */
+    if (0 != stats_enter()) return -1;
+    if (outStatsValid)
+    {   *st = outStats;
+        ret = 0;
+    }
+    stats_leave();
+    return ret;
+}
+
+/*---------------------------------------------*/
+int PlayerGetDspLatency(void)
+{
+    return dspLatency;
+}
+
+/*---------------------------------------------*/
+int PlayerGetQueueLevels(int *dspSlots, int *outSlots)
+{
+    if (0 != stats_enter()) return -1;
+    if (NULL != dspSlots) *dspSlots = PTL_RingGetUsedSlots(&qDsp.ring);
+    if (NULL != outSlots) *outSlots = PTL_RingGetUsedSlots(&qOut.ring);
+    stats_leave();
+    return queueDepth;
+}
 
 
 /****************** Threadfunktion und Funktionen, die der Thread nutzt *****/
+/* Leser: Datei oeffnen, Bloecke holen, in qDsp stellen */
 PTL_THREAD_RET_TYPE WavPlayerThreadFunc(void* pt)
 {   sRam_t parameter;  // fuer lokale Kopie des shared RAM
+    long generation = -1; // Generation der lokalen Kopie
     sndWaveHeader_t wh;
-    sndStereo16_t x, y;
-    short buf[N];
-    int i=0;
-    int err=0;
+    sndWAVChunkList_t chunks; /* Lage der Chunks in der Datei */
+    sndWAVMap_t map;          /* Speicherabbildung der Datei */
+    int is_mapped;
+    player_in_t *in;          /* Slot in qDsp, NULL: keiner reserviert */
+    int n, flags, nStages = 0;
+    unsigned long n_total, pos; /* Anzahl Wertepaare, Leseposition */
     FILE *fp_in;
-    SndDevice_t *psd;
+    PTL_thread_t DspThreadID, OutputThreadID;
 
 
     printf("WAV-Player Thread ist gestartet...");
-    // soundcard initialisieren ...
 
-    psd = sndOpen(SND_WRITE_ONLY , SND_STEREO );
-    if (NULL==psd) puts("cannot open dsp device");
+    // Pipeline aufbauen
+    if (0 != pipe_create(&qDsp, sizeof(player_in_t), queueDepth))
+    {   puts("cannot create player queues");
+        PTL_SemSignal(&endSema);
+        return 0;
+    }
+    if (0 != pipe_create(&qOut, sizeof(player_out_t), queueDepth))
+    {   puts("cannot create player queues");
+        pipe_destroy(&qDsp);
+        PTL_SemSignal(&endSema);
+        return 0;
+    }
+    PTL_SemCreate(&drainSema, 0);
+    PTL_SemCreate(&stageEndSema, 0);
+    PTL_SemCreate(&statsSema, 1);
+    PTL_AtomicStore(&queuesReady, 1);
+    if (0 == PTL_CreateThread(&DspThreadID, DspThreadFunc, NULL))
+    {   nStages++;
+        if (0 == PTL_CreateThread(&OutputThreadID, OutputThreadFunc, NULL)) nStages++;
+    }
+    if (nStages < 2)
+    {   /* ohne alle Stufen laeuft nichts: gestartete beenden, abbauen */
+        puts("cannot start player threads");
+        stop_pipeline(nStages);
+        PTL_SemSignal(&endSema);
+        return 0;
+    }
 
     do
     {   // neue parameter holen: Dateinamen, play, end, usw.
-        PTL_SemWait(&sRamSema);
-        parameter = sRam;
-        PTL_SemSignal(&sRamSema);
-
-        //Feld auf 0 setzen
-        for(i=0; i<N; i++){
-            buf[i]=0;
-        }
+        sRamReadSnapshot(&parameter, &generation);
 
     /* != 0 bedeutet: Datei abspielen */
     if (parameter.cmd_play!=0){
-        //Datei ffnen
-        fp_in  = fopen(parameter.Dateiname,"rb");
-        if (NULL==fp_in) puts("Fehler beim ffnen der Datei");
-
-        /* Dateikopf auslesen */
-        if(0!=sndWAVReadFileHeader(fp_in, &wh))
-        {   puts("error in sndWAVReadFileHeader");
+        /* Datei abbilden oder, falls das nicht geht, oeffnen */
+        fp_in = NULL;
+        is_mapped = (0 == sndWAVMapFile(parameter.Dateiname, &map));
+        if (is_mapped)
+        {   wh = map.wh;
+        }
+        else
+        {   fp_in  = fopen(parameter.Dateiname,"rb");
+            /* Dateikopf auslesen: Chunks durchlaufen, Lage der Daten merken */
+            if ((NULL==fp_in) || (0!=sndWAVScanChunks(fp_in, &wh, &chunks)))
+            {   puts("Fehler beim ffnen der Datei");
+                if (NULL!=fp_in) fclose(fp_in);
+                stop_playing();
+                PTL_Sleep(0.1);
+                continue;
+            }
         }
-        printf("Abtastfrequenz: %lu\n" , wh.nSamplesPerSec);
+        printf("Abtastfrequenz: %lu\n" , (unsigned long)wh.nSamplesPerSec);
         printf("Anzahl Kanaele: %d\n" , wh.nChannels);
         printf("Anzahl Abtastwertepaare: %lu\n" , sndWAVGetNumberOfSamples(wh));
 
         /* Hier: nur 16Bit Stereo Dateien */
         if((wh.nChannels != 2) || (wh.nBytesPerSample != 4))
         {   puts("sorry: nur 16Bit Stereo-Dateien bitte:");
-            return -1;//???
+            if (is_mapped) sndWAVUnmapFile(&map);
+            else           fclose(fp_in);
+            stop_playing();
+            continue;
         }
-        i = 0;
-        //kein error und nicht dateiende und play!=0 datei abspielen
-        while(err==0 && feof(fp_in)==0 && parameter.cmd_play!=0){
-
-            // Wertepaar einlesen
-            if (0 != sndWAVReadSampleStereo16(fp_in, &x))
-                {
-                    puts("error in sndWAVReadSampleStereo16");
-                }
-
-            // X filtern
-            y.val_li = x.val_li;
-            y.val_re = x.val_re;
-
-            if (parameter.flag_EQ_is_active) {
-                y.val_li = (short)EQ_filter_left(x.val_li, parameter.TP, parameter.BP, parameter.HP,
-                                                 parameter.A_TP, parameter.A_BP, parameter.A_HP, parameter.B);
-
-                y.val_re = (short)EQ_filter_right(x.val_re, parameter.TP, parameter.BP, parameter.HP,
-                                                  parameter.A_TP, parameter.A_BP, parameter.A_HP, parameter.B);
+        n_total = sndWAVGetNumberOfSamples(wh);
+        pos = 0;
+        flags = BLOCK_NEW_STREAM;  /* neue Datei: keine Filterreste der alten */
+        in = NULL;
+
+        /* blockweise lesen, bis Dateiende oder stop */
+        while(parameter.cmd_play!=0 && pos<n_total){
+
+            // Slot in qDsp holen, blockiert wenn der Ring voll ist
+            in = pipe_write_begin(&qDsp);
+
+            // Block von Wertepaaren holen
+            n = N_FRAMES;
+            if ((unsigned long)n > n_total-pos) n = (int)(n_total-pos);
+            if (is_mapped)
+            {   /* Verweis in die Abbildung, Readahead nachfordern. Die
+                   Abbildung bleibt bis nach drainSema bestehen */
+                in->data = (const short *)((const sndStereo16_t *)map.data + pos);
+                sndWAVMapAdvise(&map, (uint32_t)pos);
             }
-
-            if (parameter.flag_Echo_is_active == 1) {
-                y = echo_effect(y, parameter.Echo);
+            else
+            {   in->data = in->buf;
+                n = sndWAVReadBlockStereo16(fp_in, (sndStereo16_t *)in->buf, n);
             }
-
-            // In Puffer schreiben
-            buf[i] = y.val_li * parameter.B;
-            buf[i+1] = y.val_re * parameter.B;
-
-            // berprfen ob Puffer voll
-            if (i >= N-2) {
-                sndWrite(psd, buf, N);
-                for(i=0; i<N; i++){
-                    buf[i]=0;
-                }
-                i = 0;
-            } else {
-                i += 2;
+            if (n <= 0)
+            {   if (n < 0) puts("error in sndWAVReadBlockStereo16");
+                break;     /* Slot bleibt reserviert, fuer das Stromende */
             }
+            pos += n;
 
-            if (feof(fp_in)) {
-                sRam.cmd_play = 0;
-            }
+            // an die DSP-Stufe
+            in->nFrames = n;
+            in->flags = flags;
+            pipe_write_end(&qDsp);
+            in = NULL;
+            flags = 0;
 
-            // Neue Parameter holen
-            PTL_SemWait(&sRamSema);
-            parameter = sRam;
-            PTL_SemSignal(&sRamSema);
+            // Neue Parameter holen, einmal pro Block und nur bei Aenderung
+            sRamReadSnapshot(&parameter, &generation);
         }
 
+        /* Stromende markieren und warten, bis die Ausgabe es erreicht hat;
+           erst dann ist die Datei zu Ende gespielt */
+        if (NULL == in) in = pipe_write_begin(&qDsp);
+        in->nFrames = 0;
+        in->flags = BLOCK_END_STREAM;
+        in->data = NULL;
+        pipe_write_end(&qDsp);
+        PTL_SemWait(&drainSema);
+
+        sRamReadSnapshot(&parameter, &generation);
+        if (parameter.cmd_play != 0) { /* Ende erreicht, nicht gestoppt */
+            stop_playing();
+        }
 
         //Datei Schliessen
-        fclose(fp_in);
+        if (is_mapped) sndWAVUnmapFile(&map);
+        else           fclose(fp_in);
+    }
+    else
+    {   PTL_Sleep(0.05); /* nichts zu tun */
     }
 
 
     } while(parameter.cmd_end == 0);
-    // soundcard schliessen ...
-    sndClose(psd);
+
+    stop_pipeline(nStages);
 
     printf("WAV-Player Thread terminiert...");
     PTL_SemSignal(&endSema);
 
     return 0;
 }
-/* Prototyp der Funktionen, die der Thread nutzt */
 
+/*---------------------------------------------*/
+/* DSP: Bloecke aus qDsp filtern, nach qOut stellen */
+static PTL_THREAD_RET_TYPE DspThreadFunc(void* pt)
+{   sRam_t parameter;
+    long generation = -1;
+    player_in_t *in;
+    player_out_t *blk;
+    static dsp_chain_t chain; /* Filterzustand dieses Stroms */
+    int flags;
+
+    DSP_chain_reset(&chain);
+    sRamReadSnapshot(&parameter, &generation);
 
+    do
+    {   in = pipe_read_begin(&qDsp);
+        blk = pipe_write_begin(&qOut);
+        blk->nFrames = in->nFrames;
+        blk->flags = flags = in->flags;
+        if (flags & BLOCK_NEW_STREAM)
+        {   DSP_chain_reset(&chain);
+        }
+        if (blk->nFrames > 0)
+        {   /* vom Slot in qDsp (oder der Abbildung) in den Slot von qOut */
+            sRamReadSnapshot(&parameter, &generation);
+            DSP_chain_process_float(&chain, &parameter, in->data, blk->data, blk->nFrames);
+            if (DSP_chain_latency(&chain) != dspLatency)
+            {   dspLatency = DSP_chain_latency(&chain);
+                printf("DSP-Kette: Latenz %d Wertepaare (%.1f ms)\n",
+                       dspLatency, 1e3 * dspLatency / F_S);
+            }
+        }
+        pipe_read_end(&qDsp);
+        pipe_write_end(&qOut);
+    } while (!(flags & BLOCK_TERMINATE));
+
+    PTL_SemSignal(&stageEndSema);
+    return 0;
+}
 
 /*---------------------------------------------*/
+/* Ausgabe: Bloecke aus qOut auf die Soundkarte */
+static PTL_THREAD_RET_TYPE OutputThreadFunc(void* pt)
+{   sRam_t parameter;
+    long generation = -1;
+    player_out_t *blk;
+    SndDevice_t *psd;
+    short *area;              /* mmap: Zeiger in den Ringpuffer der Soundkarte */
+    static short pcm[N];      /* sonst: gewandelter Block fuer sndWrite */
+    int done, n;
 
+    // soundcard initialisieren ...
+    if (!sndCfgValid)
+    {   sndGetProfile(PLAYER_SOUND_PROFILE_DEFAULT, &sndCfg);
+        sndCfgValid = 1;
+    }
+    psd = sndOpenEx(SND_WRITE_ONLY, SND_STEREO, &sndCfg);
+    if (NULL==psd) puts("cannot open dsp device");
+    else printf("soundcard: %u Hz, %u frames x %u periods (%.1f ms)\n",
+                sndCfg.rate_Hz, sndCfg.period_frames, sndCfg.periods,
+                1000.0 * sndCfg.period_frames * sndCfg.periods / sndCfg.rate_Hz);
+    publish_stats(psd);
+
+    for (;;)
+    {   blk = pipe_read_begin(&qOut);
+        if (blk->flags & BLOCK_TERMINATE)
+        {   pipe_read_end(&qOut);
+            break;
+        }
+        if (blk->flags & BLOCK_END_STREAM)
+        {   /* ausspielen; die Pause bis zur naechsten Datei ist kein Unterlauf */
+            pipe_read_end(&qOut);
+            if (NULL != psd) sndDrain(psd);
+            publish_stats(psd);
+            PTL_SemSignal(&drainSema);
+            continue;
+        }
+        /* nach stop: was noch in der Pipeline steht, verwerfen */
+        sRamReadSnapshot(&parameter, &generation);
+        if ((parameter.cmd_play != 0) && (NULL != psd))
+        {   /* mmap-Modus: die einzige Wandlung nach 16 Bit schreibt direkt
+               in den Ringpuffer, was gespielt wird auch an den Analyzer */
+            for (done = 0; done < blk->nFrames; done += n)
+            {   n = blk->nFrames - done;
+                if (0 != sndMmapBegin(psd, &area, &n)) break;
+                DSP_float_to_s16(&blk->data[2*done], area, 2*n, 1.0f, NULL);
+                SpecTapWrite(area, n);
+                sndMmapCommit(psd, n);
+            }
+            /* sonst (oder der Rest) ueber sndWrite */
+            if (done < blk->nFrames)
+            {   n = blk->nFrames - done;
+                DSP_float_to_s16(&blk->data[2*done], pcm, 2*n, 1.0f, NULL);
+                SpecTapWrite(pcm, n);
+                sndWrite(psd, pcm, 2*n);
+            }
+            publish_stats(psd);
+        }
+        pipe_read_end(&qOut);
+    }
+
+    // soundcard schliessen ...
+    publish_stats(NULL);
+    if (NULL != psd) sndClose(psd);
+
+    PTL_SemSignal(&stageEndSema);
+    return 0;
+}
+
+/*---------------------------------------------*/
+/* Pipeline abbauen: Ende durchreichen, auf die nStages gestarteten Stufen
+   (DSP, dann Ausgabe) warten, Getter aussperren, Ringe und Semaphoren
+   freigeben */
+static void stop_pipeline(int nStages)
+{   player_in_t *in;
+    int i;
+
+    if (nStages > 0)
+    {   in = pipe_write_begin(&qDsp);
+        in->nFrames = 0;
+        in->flags = BLOCK_TERMINATE;
+        in->data = NULL;
+        pipe_write_end(&qDsp);
+    }
+    for (i = 0; i < nStages; i++) PTL_SemWait(&stageEndSema);
+
+    /* neue Getter sehen queuesReady == 0, wer schon drin ist, wird fertig */
+    PTL_SemWait(&statsSema);
+    PTL_AtomicStore(&queuesReady, 0);
+    PTL_SemSignal(&statsSema);
+    PTL_MemoryBarrier();
+    while (PTL_AtomicLoad(&statsUsers) > 0) PTL_Sleep(0.001);
+
+    pipe_destroy(&qDsp);
+    pipe_destroy(&qOut);
+    PTL_SemDestroy(&drainSema);
+    PTL_SemDestroy(&stageEndSema);
+    PTL_SemDestroy(&statsSema);
+}
+
+/*---------------------------------------------*/
+/* Ring fuer depth Bloecke zu slotSize Bytes. Der Ring hat die naechste
+   Zweierpotenz an Slots, benutzt werden nur depth davon: sind sie voll,
+   blockiert der Schreiber wie bei PTL_QueueWrite().
+
+   Schlafen ohne verlorenes Wecken: wer nichts reserviert bekommt, setzt
+   sein Waits-Flag, schaut nach einer vollen Barriere noch einmal in den
+   Ring und wartet erst dann. Die Gegenseite schaut nach Commit und
+   Barriere auf das Flag. Mindestens eine der beiden sieht also die
+   andere; ein ueberzaehliges Wecken kostet nur einen Durchlauf mehr */
+static int pipe_create(player_pipe_t *p, unsigned int slotSize, int depth)
+{   unsigned int nSlots = 1;
+
+    while (nSlots < (unsigned int)depth) nSlots *= 2;
+    if (0 != PTL_RingCreate(&p->ring, slotSize, nSlots)) return -1;
+    p->depth = depth;
+    p->writerWaits = 0;
+    p->readerWaits = 0;
+    PTL_SemCreate(&p->freeSema, 0);
+    PTL_SemCreate(&p->fullSema, 0);
+    return 0;
+}
+
+static void pipe_destroy(player_pipe_t *p)
+{
+    PTL_RingDestroy(&p->ring);
+    PTL_SemDestroy(&p->freeSema);
+    PTL_SemDestroy(&p->fullSema);
+}
+
+/* einen freien Slot reservieren, ohne zu blockieren; 0: depth Slots voll */
+static unsigned int pipe_write_try(player_pipe_t *p, void **slot)
+{
+    if ((p->depth < (int)p->ring.maxSlots) && (PTL_RingGetUsedSlots(&p->ring) >= p->depth))
+        return 0;
+    return PTL_RingWriteReserve(&p->ring, 1, slot);
+}
+
+/* naechsten freien Slot zum Fuellen, blockiert solange der Ring voll ist */
+static void *pipe_write_begin(player_pipe_t *p)
+{   void *slot;
+
+    while (0 == pipe_write_try(p, &slot))
+    {   PTL_AtomicStore(&p->writerWaits, 1);
+        PTL_MemoryBarrier();
+        if (0 != pipe_write_try(p, &slot))
+        {   PTL_AtomicStore(&p->writerWaits, 0);
+            break;
+        }
+        PTL_SemWait(&p->freeSema);
+    }
+    return slot;
+}
+
+/* gefuellten Slot an den Leser, ihn wecken falls er schlaeft */
+static void pipe_write_end(player_pipe_t *p)
+{
+    PTL_RingWriteCommit(&p->ring, 1);
+    PTL_MemoryBarrier();
+    if (PTL_AtomicLoad(&p->readerWaits))
+    {   PTL_AtomicStore(&p->readerWaits, 0);
+        PTL_SemSignal(&p->fullSema);
+    }
+}
+
+/* aeltesten vollen Slot, blockiert solange der Ring leer ist */
+static void *pipe_read_begin(player_pipe_t *p)
+{   void *slot;
+
+    while (0 == PTL_RingReadReserve(&p->ring, 1, &slot))
+    {   PTL_AtomicStore(&p->readerWaits, 1);
+        PTL_MemoryBarrier();
+        if (0 != PTL_RingReadReserve(&p->ring, 1, &slot))
+        {   PTL_AtomicStore(&p->readerWaits, 0);
+            break;
+        }
+        PTL_SemWait(&p->fullSema);
+    }
+    return slot;
+}
+
+/* gelesenen Slot an den Schreiber zurueck, ihn wecken falls er schlaeft */
+static void pipe_read_end(player_pipe_t *p)
+{
+    PTL_RingReadCommit(&p->ring, 1);
+    PTL_MemoryBarrier();
+    if (PTL_AtomicLoad(&p->writerWaits))
+    {   PTL_AtomicStore(&p->writerWaits, 0);
+        PTL_SemSignal(&p->freeSema);
+    }
+}
 
 /*---------------------------------------------*/
+/* Statistik der Soundkarte fuer PlayerGetSoundStats() kopieren, einmal
+   je Block aus dem Ausgabe-Thread; psd == NULL: Soundkarte zu */
+static void publish_stats(SndDevice_t *psd)
+{   sndStats_t st;
+    int valid = (NULL != psd) && (0 == sndGetStats(psd, &st));
+
+    PTL_SemWait(&statsSema);
+    if (valid) outStats = st;
+    outStatsValid = valid;
+    PTL_SemSignal(&statsSema);
+}
 
+/*---------------------------------------------*/
+/* Getter von aussen anmelden. Rueckgabe 0: Ringe und statsSema bestehen
+   bis stats_leave(), statsSema ist genommen; -1: Player laeuft nicht.
+   Gegenstueck in stop_pipeline(): queuesReady loeschen, dann auf
+   statsUsers == 0 warten; mindestens eine Seite sieht die andere */
+static int stats_enter(void)
+{
+    PTL_AtomicIncrement(&statsUsers);   /* volle Barriere */
+    if (!PTL_AtomicLoad(&queuesReady))
+    {   PTL_AtomicDecrement(&statsUsers);
+        return -1;
+    }
+    PTL_SemWait(&statsSema);
+    return 0;
+}
+
+static void stats_leave(void)
+{
+    PTL_SemSignal(&statsSema);
+    PTL_AtomicDecrement(&statsUsers);
+}
+
+/*---------------------------------------------*/
+static void stop_playing(void)
+{
+    PTL_SemWait(&sRamSema);
+    sRam.cmd_play = 0;
+    sRamPublish();
+    PTL_SemSignal(&sRamSema);
+}
+
+
+/****************** Messung der Uebergabe zwischen zwei Threads *************/
+typedef struct
+{   int mode;               /* PLAYER_BENCH_... */
+    int batch;              /* Bloecke je Aufruf, 1 bei PLAYER_BENCH_PIPE */
+    PTL_queue_t q;          /* PLAYER_BENCH_QUEUE */
+    player_pipe_t p;        /* PLAYER_BENCH_PIPE */
+    PTL_ring_t r;           /* PLAYER_BENCH_RING */
+    double seconds;
+    long wrapCuts;          /* Reservierungen des Schreibers, am Ringende gekuerzt */
+    PTL_sem_t doneSema;
+} bench_t;
+
+/* ganzen Block beschreiben, wie der Leser des Players */
+static void bench_fill(player_block_t *b, int seq, int flags)
+{   int i;
+
+    b->nFrames = N_FRAMES;
+    b->flags = flags;
+    for (i = 0; i < N; i++) b->data[i] = (short)(seq + i);
+}
+
+/* ganzen Block lesen, Rueckgabe: 0 wenn er der erwartete ist */
+static int bench_check(const player_block_t *b, int seq)
+{   int i;
+
+    for (i = 0; i < N; i++)
+        if (b->data[i] != (short)(seq + i)) return -1;
+    return 0;
+}
 
+/* n reservierte Slots ab slot: endet die Reservierung am Ringende, obwohl
+   mehr gewollt waren, hat der Ring sie dort abgeschnitten */
+static int bench_wrap_cut(const bench_t *b, const player_block_t *slot, unsigned int n)
+{
+    return (n < (unsigned int)b->batch)
+        && ((const char *)(slot + n) == b->r.buffer + (size_t)b->r.maxSlots * b->r.slotSize);
+}
 
+static PTL_THREAD_RET_TYPE bench_writer(void *pt)
+{   bench_t *b = (bench_t *)pt;
+    static player_block_t blk[PLAYER_BENCH_BATCH_MAX];
+    player_block_t *slot;
+    double t_end = PTL_GetTime() + b->seconds;
+    unsigned int i, n;
+    int seq = 0, last = 0;
 
+    do
+    {   if (b->mode == PLAYER_BENCH_RING)
+        {   /* wait-free: voller Ring heisst nur, die CPU abgeben */
+            n = PTL_RingWriteReserve(&b->r, b->batch, (void **)&slot);
+            if (n == 0)
+            {   PTL_Yield();
+                continue;
+            }
+            if (bench_wrap_cut(b, slot, n)) b->wrapCuts++;
+        }
+        else if (b->mode == PLAYER_BENCH_PIPE)
+        {   slot = pipe_write_begin(&b->p);
+            n = 1;
+        }
+        else
+        {   slot = blk;
+            n = b->batch;
+        }
+        /* immer ganze Reservierungen, das Ende steht im letzten Block */
+        last = (PTL_GetTime() >= t_end);
+        for (i = 0; i < n; i++)
+            bench_fill(&slot[i], seq++, (last && (i == n-1)) ? BLOCK_TERMINATE : 0);
+        if (b->mode == PLAYER_BENCH_RING)      PTL_RingWriteCommit(&b->r, n);
+        else if (b->mode == PLAYER_BENCH_PIPE) pipe_write_end(&b->p);
+        else                                   PTL_QueueWrite(&b->q, n, (char *)blk);
+    } while (!last);
+
+    PTL_SemSignal(&b->doneSema);
+    return 0;
+}
 
+/*---------------------------------------------*/
+double PlayerQueueBenchmark(int mode, int depth, int batch, double seconds, long *wrapCuts)
+{   static bench_t b;
+    static player_block_t blk[PLAYER_BENCH_BATCH_MAX];
+    player_block_t *slot;
+    PTL_thread_t tid;
+    unsigned int i, n, nSlots = 1;
+    double t0, t;
+    long readCuts = 0;
+    int seq = 0, flags = 0, ret, bad = 0;
+
+    if ((batch < 1) || (batch > PLAYER_BENCH_BATCH_MAX) || (batch > depth)
+        || ((mode == PLAYER_BENCH_PIPE) && (batch != 1)))
+        return -1;
+    while (nSlots < (unsigned int)depth) nSlots *= 2;
+    b.mode = mode;
+    b.batch = batch;
+    b.seconds = seconds;
+    b.wrapCuts = 0;
+    if (mode == PLAYER_BENCH_RING)      ret = PTL_RingCreate(&b.r, sizeof(player_block_t), nSlots);
+    else if (mode == PLAYER_BENCH_PIPE) ret = pipe_create(&b.p, sizeof(player_block_t), depth);
+    else                                ret = PTL_QueueCreate(&b.q, sizeof(player_block_t), depth);
+    if (0 != ret) return -1;
+    PTL_SemCreate(&b.doneSema, 0);
+
+    t0 = PTL_GetTime();
+    if (0 != PTL_CreateThread(&tid, bench_writer, &b))
+    {   puts("cannot start benchmark thread");
+        bad = 1;
+    }
+    else
+    {   do
+        {   if (mode == PLAYER_BENCH_RING)
+            {   n = PTL_RingReadReserve(&b.r, batch, (void **)&slot);
+                if (n == 0)
+                {   PTL_Yield();
+                    continue;
+                }
+                if (bench_wrap_cut(&b, slot, n)) readCuts++;
+            }
+            else if (mode == PLAYER_BENCH_PIPE)
+            {   slot = pipe_read_begin(&b.p);
+                n = 1;
+            }
+            else
+            {   PTL_QueueRead(&b.q, batch, (char *)blk);
+                slot = blk;
+                n = batch;
+            }
+            for (i = 0; i < n; i++)
+            {   if (0 != bench_check(&slot[i], seq)) bad++;
+                flags = slot[i].flags;
+                seq++;
+            }
+            if (mode == PLAYER_BENCH_RING)      PTL_RingReadCommit(&b.r, n);
+            else if (mode == PLAYER_BENCH_PIPE) pipe_read_end(&b.p);
+        } while (!(flags & BLOCK_TERMINATE));
+        PTL_SemWait(&b.doneSema);
+    }
+    t = PTL_GetTime() - t0;
+
+    PTL_SemDestroy(&b.doneSema);
+    if (mode == PLAYER_BENCH_RING)      PTL_RingDestroy(&b.r);
+    else if (mode == PLAYER_BENCH_PIPE) pipe_destroy(&b.p);
+    else                                PTL_QueueDestroy(&b.q);
+    if (NULL != wrapCuts) *wrapCuts = b.wrapCuts + readCuts;  /* nach doneSema */
+    if (bad) return -1;
+    return (t > 0.0) ? seq / t : 0.0;
+}
@@ -9,9 +9,54 @@
 
 
 
-/* Prototyp der Threadfundktion */
+#define PLAYER_QUEUE_DEPTH_DEFAULT 4   /* Bloecke je Queue, je ca. 93ms */
+#define PLAYER_QUEUE_DEPTH_MAX     64
+/* eine Periode entspricht einem Block, passt zu N_FRAMES */
+#define PLAYER_SOUND_PROFILE_DEFAULT SND_PROFILE_THROUGHPUT
+
+/* Prototyp der Threadfundktion, startet selbst DSP- und Ausgabe-Thread */
 PTL_THREAD_RET_TYPE WavPlayerThreadFunc(void* pt);
 
+/* Tiefe der Queues Leser->DSP und DSP->Ausgabe, nur vor dem Start des
+   Player-Threads. Rueckgabe: 0 fuer ok, -1 bei Fehler */
+int PlayerSetQueueDepth(int nSlots);
+
+/* Puffereinstellung der Soundkarte, Name wie bei sndGetProfile(). Nur vor
+   dem Start des Player-Threads. Rueckgabe: 0 fuer ok, -1 bei Fehler */
+int PlayerSetSoundProfile(const char *name);
+
+/* Fuellstand der Queues in Bloecken. Darf aus jedem Thread aufgerufen
+   werden, auch waehrend der Player-Thread endet.
+   Rueckgabe: Tiefe der Queues, -1 wenn der Player nicht laeuft */
+int PlayerGetQueueLevels(int *dspSlots, int *outSlots);
+
+/* Verzoegerung der DSP-Kette in Wertepaaren, zusaetzlich zu den Queues
+   (linearphasiger Equalizer), 0 ohne */
+int PlayerGetDspLatency(void);
+
+/* Uebergabe von Player-Bloecken zwischen zwei Threads, seconds lang, je
+   Aufruf batch Bloecke (1...PLAYER_BENCH_BATCH_MAX, hoechstens depth):
+     PLAYER_BENCH_QUEUE  PTL_QueueWrite/-Read, kopiert beim Schreiben und Lesen
+     PLAYER_BENCH_PIPE   wie der Player: Ring, Semaphore nur wenn voll/leer,
+                         nur batch 1
+     PLAYER_BENCH_RING   PTL_RingWrite/ReadReserve und -Commit direkt, an
+                         Ort und Stelle, bei vollem/leerem Ring PTL_Yield();
+                         der Ring hat die naechste Zweierpotenz >= depth Slots
+   Der Schreiber fuellt, der Leser prueft jeden Block ganz. *wrapCuts (darf
+   NULL sein): Reservierungen, die der Ring am Pufferende gekuerzt hat.
+   Rueckgabe: Bloecke je Sekunde, -1 bei Fehler */
+#define PLAYER_BENCH_QUEUE     0
+#define PLAYER_BENCH_PIPE      1
+#define PLAYER_BENCH_RING      2
+#define PLAYER_BENCH_BATCH_MAX 8
+double PlayerQueueBenchmark(int mode, int depth, int batch, double seconds, long *wrapCuts);
+
+/* Statistik der Soundkarte (Unterlaeufe, laengste Pause, Verzoegerung),
+   Stand nach dem zuletzt ausgegebenen Block. Darf aus jedem Thread
+   aufgerufen werden. Rueckgabe: 0 fuer ok, -1 wenn die Soundkarte nicht
+   offen ist */
+int PlayerGetSoundStats(sndStats_t *st);
+
 
 
 #endif
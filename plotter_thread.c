@@ -1,32 +1,89 @@
-
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include "plotter_thread.h"
 #include "dig_filter.h"
+#include "peq.h"
+#include "sram_snapshot.h"
+
+
+/* die Teile des shared RAM, von denen der Amplitudengang abhaengt */
+typedef struct
+{   int flag_EQ_is_active;
+    float A_TP, A_BP, A_HP, B;
+    IIR_2_coeff_t TP, BP, HP;
+    int flag_PEQ_is_active;
+    peq_coeff_t PEQ;
+} response_params_t;
+
+/* Frequenzgang eines Filters 2. Ordnung an allen Punkten, gilt fuer die
+   Koeffizienten p. Neu gerechnet wird nur, wenn p sich aendert */
+typedef struct
+{   int valid;
+    IIR_2_coeff_t p;
+    float re[N_PLOT_POINTS], im[N_PLOT_POINTS];
+    float dB[N_PLOT_POINTS];           /* 20*log10|H| */
+} band_response_t;
+
+/* je Band ein Eintrag. TP/BP/HP liegen parallel: H = 1 + Summe A*H_band,
+   die Baender des parametrischen EQ in Kaskade: Summe der dB-Werte. Bei
+   geaenderten Gewichten oder einem verschobenen Band bleibt also alles
+   andere stehen */
+typedef struct
+{   band_response_t TP, BP, HP;
+    band_response_t PEQ[PEQ_MAX_BANDS];
+    long nEvaluated;                   /* neu gerechnete Baender, Statistik */
+} response_cache_t;
 
+/* Prototyp der Funktionen, die der Thread nutzt */
+static void get_response_params(const sRam_t *p, response_params_t *rp);
+static void update_band(const H_sweep_t *sw, response_cache_t *rc, band_response_t *b,
+                        const IIR_2_coeff_t *p);
+static void compute_response(const H_sweep_t *sw, response_cache_t *rc,
+                             const response_params_t *rp, float *H_dB);
 
 
 /****************** Threadfunktion und Funktionen, die der Thread nutzt *****/
 PTL_THREAD_RET_TYPE ComputeFrequncyResponseThreadFunc(void* pt)
 {   sRam_t parameter;  // fuer lokale Kopie des shared RAM
+    long generation = -1; // Generation der lokalen Kopie
+    static H_sweep_t sweep;            /* Stuetzstellen, einmal berechnet */
+    static float H_dB[N_PLOT_POINTS];  /* Ergebnis, erst lokal */
+    static response_cache_t cache;     /* Frequenzgaenge der Baender */
+    response_params_t rp, rp_last;
+    int valid = 0;                     /* 1: rp_last ist schon geplottet */
 
 
     printf("ComputeFrequncyResponseThreadFunc ist gestartet...");
 
+    H_sweep_init_log(&sweep, N_PLOT_POINTS, 1.0, 20000.0, F_S);
+    memset(&rp_last, 0, sizeof(rp_last));
 
     do
     {
-        // neue parameter holen: Dateinamen, play, end, usw.
-        PTL_SemWait(&sRamSema);
-        parameter = sRam;
-        PTL_SemSignal(&sRamSema);
+        // neue parameter holen, nur wenn sich etwas geaendert hat
+        if (sRamReadSnapshot(&parameter, &generation))
+        {   get_response_params(&parameter, &rp);
+
+            /* neu rechnen nur, wenn sich die Koeffizienten geaendert haben,
+               nicht bei play/stop oder neuem Dateinamen */
+            if (!valid || (0 != memcmp(&rp, &rp_last, sizeof(rp))))
+            {   compute_response(&sweep, &cache, &rp, H_dB);
 
-        PTL_Sleep(0.5);
+                /* plotSema nur fuer das Umkopieren halten */
+                PTL_SemWait(&plotSema);
+                memcpy(plot_data.f_Hz, sweep.f_Hz, sizeof(plot_data.f_Hz));
+                memcpy(plot_data.H_dB, H_dB, sizeof(plot_data.H_dB));
+                PTL_SemSignal(&plotSema);
+                PTL_AtomicStore(&plotDirty, 1);   /* neu zeichnen */
 
-        /****************************************************/
-        /* TODO: Amplitudengang berechnen                   */
-        /****************************************************/
+                rp_last = rp;
+                valid = 1;
+            }
+        }
+
+        PTL_Sleep(0.05);
 
     } while(parameter.cmd_end == 0);
 
@@ -35,8 +92,85 @@ PTL_THREAD_RET_TYPE ComputeFrequncyResponseThreadFunc(void* pt)
 
     return 0;
 }
-/* Prototyp der Funktionen, die der Thread nutzt */
 
 
+/*---------------------------------------------*/
+static void get_response_params(const sRam_t *p, response_params_t *rp)
+{
+    /* mit memset, damit memcmp auch Fuellbytes vergleichen darf */
+    memset(rp, 0, sizeof(*rp));
+    rp->flag_EQ_is_active = p->flag_EQ_is_active;
+    if (p->flag_EQ_is_active)
+    {   rp->A_TP = p->A_TP;
+        rp->A_BP = p->A_BP;
+        rp->A_HP = p->A_HP;
+        rp->B    = p->B;
+        rp->TP   = p->TP;
+        rp->BP   = p->BP;
+        rp->HP   = p->HP;
+    }
+    rp->flag_PEQ_is_active = p->flag_PEQ_is_active;
+    if (p->flag_PEQ_is_active)
+    {   rp->PEQ = p->PEQ;
+    }
+}
 
 /*---------------------------------------------*/
+/* Frequenzgang von b fuer p, nur wenn noch nicht vorhanden */
+static void update_band(const H_sweep_t *sw, response_cache_t *rc, band_response_t *b,
+                        const IIR_2_coeff_t *p)
+{   float m;
+    int i;
+
+    if (b->valid && (0 == memcmp(&b->p, p, sizeof(IIR_2_coeff_t)))) return;
+
+    IIR_2_response_sweep(sw, p, b->re, b->im);
+    for (i = 0; i < sw->n; i++)
+    {   m = b->re[i] * b->re[i] + b->im[i] * b->im[i];
+        if (m < 1e-20f) m = 1e-20f;
+        b->dB[i] = 10 * log10f(m);
+    }
+    b->p = *p;
+    b->valid = 1;
+    rc->nEvaluated++;
+}
+
+/*---------------------------------------------*/
+/* Amplitudengang der Kette: Equalizer (TP/BP/HP), dann parametrischer EQ.
+   Gerechnet werden nur Baender mit neuen Koeffizienten, der Rest ist
+   eine Summe ueber die Punkte */
+static void compute_response(const H_sweep_t *sw, response_cache_t *rc,
+                             const response_params_t *rp, float *H_dB)
+{   IIR_2_coeff_t p;
+    float re, im, m;
+    int i, k;
+
+    if (rp->flag_EQ_is_active)
+    {   update_band(sw, rc, &rc->TP, &rp->TP);
+        update_band(sw, rc, &rc->BP, &rp->BP);
+        update_band(sw, rc, &rc->HP, &rp->HP);
+        /* 20*log10(|H|*B) = 10*log10(|H|^2*B^2) */
+        for (i = 0; i < sw->n; i++)
+        {   re = 1 + rp->A_TP * rc->TP.re[i] + rp->A_BP * rc->BP.re[i] + rp->A_HP * rc->HP.re[i];
+            im =     rp->A_TP * rc->TP.im[i] + rp->A_BP * rc->BP.im[i] + rp->A_HP * rc->HP.im[i];
+            m = (re * re + im * im) * rp->B * rp->B;
+            if (m < 1e-20f) m = 1e-20f;
+            H_dB[i] = 10 * log10f(m);
+        }
+    }
+    else
+    {   for (i = 0; i < sw->n; i++) H_dB[i] = 0;
+    }
+
+    if (rp->flag_PEQ_is_active)
+    {   for (k = 0; k < rp->PEQ.nBands; k++)
+        {   p.b0 = rp->PEQ.b0[k];
+            p.b1 = rp->PEQ.b1[k];
+            p.b2 = rp->PEQ.b2[k];
+            p.a1 = rp->PEQ.a1[k];
+            p.a2 = rp->PEQ.a2[k];
+            update_band(sw, rc, &rc->PEQ[k], &p);
+            for (i = 0; i < sw->n; i++) H_dB[i] += rc->PEQ[k].dB[i];
+        }
+    }
+}
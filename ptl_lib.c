@@ -66,7 +66,9 @@
 /* OS specific includes */
 #if (PLATFORM==OS_LINUX)
   #include <errno.h>
+  #include <sched.h>
   #include <time.h>
+  #include <unistd.h>
 #endif
 #if (PLATFORM==OS_MS_WINDOWS)
 #endif
@@ -221,6 +223,109 @@ int PTL_Sleep(double seconds)
 /*------------------------------------------------*/
 
 
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_Yield
+ *
+ * @par Description:
+ *   This function gives the processor to another ready thread, if there
+ *   is one, and returns at once otherwise. Useful when polling a
+ *   PTL_ring_t that is full or empty, so the other side can run.
+ *
+ * @retval 0               - no error
+ * @retval negative        - an error occured
+ *
+ * @see
+ *    @arg PTL_Sleep
+ ************************************************************************/
+int PTL_Yield(void)
+{
+  #if (PLATFORM==OS_MS_WINDOWS)
+    Sleep(0);
+    return 0;
+  #endif
+
+  #if (PLATFORM==OS_LINUX)
+    return sched_yield();
+  #endif
+}
+/*------------------------------------------------*/
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_GetTime
+ *
+ * @par Description:
+ *   This function returns a monotonic time stamp, e.g. to measure how
+ *   long a piece of code runs. Only differences of two time stamps are
+ *   meaningful, the zero point is arbitrary.
+ *
+ * @retval time in seconds
+ *
+ * @par Example :
+ * @verbatim
+    double t0 = PTL_GetTime();
+    ...
+    printf("%.3f s\n", PTL_GetTime() - t0);
+   @endverbatim
+ * @see
+ *    @arg PTL_Sleep
+ ************************************************************************/
+double PTL_GetTime(void)
+{
+  #if (PLATFORM==OS_MS_WINDOWS)
+    LARGE_INTEGER f, t;
+
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / (double)f.QuadPart;
+  #endif
+
+  #if (PLATFORM==OS_LINUX)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+  #endif
+}
+/*------------------------------------------------*/
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_GetNumberOfCPUs
+ *
+ * @par Description:
+ *   This function returns the number of processors currently online,
+ *   e.g. to choose the number of worker threads of a thread pool.
+ *
+ * @retval number of processors, at least 1
+ *
+ * @see
+ *    @arg PTL_CreateThread
+ ************************************************************************/
+int PTL_GetNumberOfCPUs(void)
+{
+  #if (PLATFORM==OS_MS_WINDOWS)
+    SYSTEM_INFO si;
+
+    GetSystemInfo(&si);
+    return (si.dwNumberOfProcessors > 0) ? (int)si.dwNumberOfProcessors : 1;
+  #endif
+
+  #if (PLATFORM==OS_LINUX)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (n > 0) ? (int)n : 1;
+  #endif
+}
+/*------------------------------------------------*/
+
+
 /*!
  **********************************************************************
  * @par Exported Function:
@@ -279,6 +384,145 @@ int PTL_TerminateThread(PTL_thread_t thread)
 /*------------------------------------------------*/
 
 
+/*************************************************************************
+ * atomic operations
+ *************************************************************************/
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_AtomicLoad
+ *
+ * @par Description:
+ *   This function reads an atomic counter. Memory accesses following the
+ *   load in program order will not be moved before it (acquire).
+ *
+ * @see
+ * @arg  PTL_AtomicStore()
+ *
+ *
+ * @param  a               - IN, pointer to atomic counter
+ *
+ * @retval value of the counter
+ ************************************************************************/
+long PTL_AtomicLoad(PTL_atomic_t *a)
+{
+  #if (PLATFORM==OS_LINUX)
+    return __atomic_load_n(a, __ATOMIC_ACQUIRE);
+  #endif
+  #if (PLATFORM==OS_MS_WINDOWS)
+    return InterlockedCompareExchange((LONG volatile *)a, 0, 0);
+  #endif
+}
+/*------------------------------------------------*/
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_AtomicStore
+ *
+ * @par Description:
+ *   This function writes an atomic counter. Memory accesses preceding the
+ *   store in program order are visible to other threads before the new
+ *   value is (release).
+ *
+ * @see
+ * @arg  PTL_AtomicLoad()
+ *
+ *
+ * @param  a               - IN/OUT, pointer to atomic counter
+ * @param  value           - IN, new value
+ ************************************************************************/
+void PTL_AtomicStore(PTL_atomic_t *a, long value)
+{
+  #if (PLATFORM==OS_LINUX)
+    __atomic_store_n(a, value, __ATOMIC_RELEASE);
+  #endif
+  #if (PLATFORM==OS_MS_WINDOWS)
+    InterlockedExchange((LONG volatile *)a, value);
+  #endif
+}
+/*------------------------------------------------*/
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_AtomicIncrement
+ *
+ * @par Description:
+ *   This function increments an atomic counter by one and returns the
+ *   new value. Acts as a full memory barrier.
+ *
+ * @param  a               - IN/OUT, pointer to atomic counter
+ *
+ * @retval incremented value of the counter
+ ************************************************************************/
+long PTL_AtomicIncrement(PTL_atomic_t *a)
+{
+  #if (PLATFORM==OS_LINUX)
+    return __atomic_add_fetch(a, 1, __ATOMIC_SEQ_CST);
+  #endif
+  #if (PLATFORM==OS_MS_WINDOWS)
+    return InterlockedIncrement((LONG volatile *)a);
+  #endif
+}
+/*------------------------------------------------*/
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_AtomicDecrement
+ *
+ * @par Description:
+ *   This function decrements an atomic counter by one and returns the
+ *   new value. Acts as a full memory barrier.
+ *
+ * @see
+ * @arg  PTL_AtomicIncrement()
+ *
+ *
+ * @param  a               - IN/OUT, pointer to atomic counter
+ *
+ * @retval decremented value of the counter
+ ************************************************************************/
+long PTL_AtomicDecrement(PTL_atomic_t *a)
+{
+  #if (PLATFORM==OS_LINUX)
+    return __atomic_sub_fetch(a, 1, __ATOMIC_SEQ_CST);
+  #endif
+  #if (PLATFORM==OS_MS_WINDOWS)
+    return InterlockedDecrement((LONG volatile *)a);
+  #endif
+}
+/*------------------------------------------------*/
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_MemoryBarrier
+ *
+ * @par Description:
+ *   Full memory barrier: no load or store is moved across this call,
+ *   neither by the compiler nor by the CPU.
+ ************************************************************************/
+void PTL_MemoryBarrier(void)
+{
+  #if (PLATFORM==OS_LINUX)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  #endif
+  #if (PLATFORM==OS_MS_WINDOWS)
+    LONG dummy = 0;
+    InterlockedExchange(&dummy, 1);  /* locked instruction: full fence */
+  #endif
+}
+/*------------------------------------------------*/
+
+
 /*************************************************************************
  * counting semaphore implementation
  *************************************************************************/
@@ -1012,3 +1256,237 @@ int PTL_QueueUnblockThreadsForTermination(PTL_queue_t *q)
     return 0;
 }
 
+
+
+/*************************************************************************
+ * lock-free single producer / single consumer ring
+ *************************************************************************/
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_RingCreate
+ *
+ * @par Description:
+ *   This function creates a lock-free ring buffer for exactly one writing
+ *   and one reading thread. Unlike PTL_queue_t no semaphores are used and
+ *   no data is copied: the writer reserves slots, fills them in place and
+ *   commits them; the reader reserves filled slots, uses them in place and
+ *   commits them back. No call ever blocks, a full or empty ring is
+ *   reported by a reservation of 0 slots.
+ *
+ *   Head and tail index live in separate cache lines, so writer and
+ *   reader do not steal each other's cache line on every slot. Each side
+ *   keeps a cached copy of the other side's index and only reloads it
+ *   when the cached value says the ring is full (or empty).
+ *
+ * @see
+ * @arg  PTL_RingDestroy()
+ *
+ *
+ * @param  r               - IN/OUT, pointer to ring struct
+ * @param  slotSize        - IN, size of one slot in byte
+ * @param  nSlots          - IN, number of slots, must be a power of two
+ *
+ * @retval 0               - ok
+ * @retval -1              - an error occured
+ *
+ * @par Example:
+ * @verbatim
+  writer:                                     reader:
+  float *p;                                   float *p;
+  n = PTL_RingWriteReserve(&r, 4, &p);        n = PTL_RingReadReserve(&r, 4, &p);
+  ... fill p[0...n*slot-1] ...                ... use p[0...n*slot-1] ...
+  PTL_RingWriteCommit(&r, n);                 PTL_RingReadCommit(&r, n);
+  @endverbatim
+ ************************************************************************/
+int PTL_RingCreate(PTL_ring_t *r, unsigned int slotSize, unsigned int nSlots)
+{
+  if((nSlots == 0) || ((nSlots & (nSlots - 1)) != 0) || (slotSize == 0))
+  { _errMsg("PTL_RingCreate: number of slots must be a power of two");
+    return -1;
+  }
+  r->buffer = (char *) malloc((size_t)slotSize * nSlots);
+  if(NULL == r->buffer)
+  { _errMsg("PTL_RingCreate:malloc, cannot create buffer");
+    return -1;
+  }
+  r->maxSlots  = nSlots;
+  r->mask      = nSlots - 1;
+  r->slotSize  = slotSize;
+  r->head      = 0;         /* empty ring */
+  r->tail      = 0;
+  r->headCache = 0;
+  r->tailCache = 0;
+  r->isInitialized = 1;
+  PTL_MemoryBarrier();
+  return 0;
+}
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_RingDestroy
+ *
+ * @par Description:
+ *   This function frees the ring buffer. Neither writer nor reader may
+ *   use the ring any more.
+ *
+ * @param  r               - IN/OUT, pointer to ring struct
+ *
+ * @retval 0               - ok
+ * @retval -1              - an error occured
+ ************************************************************************/
+int PTL_RingDestroy(PTL_ring_t *r)
+{
+  if(r->isInitialized == 0)
+  { _errMsg("PTL_RingDestroy: ring not initialized");
+    return -1;
+  }
+  free(r->buffer);
+  r->buffer = NULL;
+  r->isInitialized = 0;
+  return 0;
+}
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_RingWriteReserve
+ *
+ * @par Description:
+ *   Writer only. This function hands out up to nSlots free slots as one
+ *   contiguous piece of the ring buffer. Fewer slots are returned if the
+ *   ring is nearly full or the free space wraps around the end of the
+ *   buffer; call again after committing to get the rest. Wait-free.
+ *
+ * @see
+ * @arg  PTL_RingWriteCommit()
+ *
+ *
+ * @param  r               - IN/OUT, pointer to ring struct
+ * @param  nSlots          - IN, number of slots wanted
+ * @param  data            - OUT, pointer to the first reserved slot
+ *
+ * @retval number of reserved slots, 0 if the ring is full
+ ************************************************************************/
+unsigned int PTL_RingWriteReserve(PTL_ring_t *r, unsigned int nSlots, void **data)
+{ unsigned long head, free_slots, to_end;
+
+  head = (unsigned long)r->head;   /* own index, no barrier needed */
+  free_slots = r->maxSlots - (head - r->tailCache);
+  if(free_slots < nSlots)
+  { r->tailCache = (unsigned long)PTL_AtomicLoad(&r->tail);
+    free_slots = r->maxSlots - (head - r->tailCache);
+  }
+  to_end = r->maxSlots - (head & r->mask);
+  if(nSlots > free_slots) nSlots = free_slots;
+  if(nSlots > to_end)     nSlots = to_end;
+  *data = &(r->buffer[(head & r->mask) * r->slotSize]);
+  return nSlots;
+}
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_RingWriteCommit
+ *
+ * @par Description:
+ *   Writer only. This function hands nSlots slots, reserved with
+ *   PTL_RingWriteReserve() and filled, over to the reader.
+ *
+ * @param  r               - IN/OUT, pointer to ring struct
+ * @param  nSlots          - IN, number of slots, at most as many as reserved
+ ************************************************************************/
+void PTL_RingWriteCommit(PTL_ring_t *r, unsigned int nSlots)
+{
+  /* release: slot data is visible before the new head */
+  PTL_AtomicStore(&r->head, (long)((unsigned long)r->head + nSlots));
+}
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_RingReadReserve
+ *
+ * @par Description:
+ *   Reader only. This function hands out up to nSlots filled slots as one
+ *   contiguous piece of the ring buffer. Fewer slots are returned if not
+ *   enough data is available or the data wraps around the end of the
+ *   buffer. Wait-free.
+ *
+ * @see
+ * @arg  PTL_RingReadCommit()
+ *
+ *
+ * @param  r               - IN/OUT, pointer to ring struct
+ * @param  nSlots          - IN, number of slots wanted
+ * @param  data            - OUT, pointer to the first reserved slot
+ *
+ * @retval number of reserved slots, 0 if the ring is empty
+ ************************************************************************/
+unsigned int PTL_RingReadReserve(PTL_ring_t *r, unsigned int nSlots, void **data)
+{ unsigned long tail, used, to_end;
+
+  tail = (unsigned long)r->tail;   /* own index, no barrier needed */
+  used = r->headCache - tail;
+  if(used < nSlots)
+  { r->headCache = (unsigned long)PTL_AtomicLoad(&r->head);
+    used = r->headCache - tail;
+  }
+  to_end = r->maxSlots - (tail & r->mask);
+  if(nSlots > used)   nSlots = used;
+  if(nSlots > to_end) nSlots = to_end;
+  *data = &(r->buffer[(tail & r->mask) * r->slotSize]);
+  return nSlots;
+}
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_RingReadCommit
+ *
+ * @par Description:
+ *   Reader only. This function gives nSlots slots, reserved with
+ *   PTL_RingReadReserve(), back to the writer.
+ *
+ * @param  r               - IN/OUT, pointer to ring struct
+ * @param  nSlots          - IN, number of slots, at most as many as reserved
+ ************************************************************************/
+void PTL_RingReadCommit(PTL_ring_t *r, unsigned int nSlots)
+{
+  /* release: reading the slots is finished before the writer may reuse them */
+  PTL_AtomicStore(&r->tail, (long)((unsigned long)r->tail + nSlots));
+}
+
+
+/*!
+ **********************************************************************
+ * @par Exported Function:
+ *   PTL_RingGetUsedSlots
+ *
+ * @par Description:
+ *   This function returns the number of filled slots. May be called from
+ *   any thread; the value is a snapshot.
+ *
+ * @param  r               - IN, pointer to ring struct
+ *
+ * @retval number of filled slots
+ * @retval negative        - an error occured
+ ************************************************************************/
+int PTL_RingGetUsedSlots(PTL_ring_t *r)
+{ unsigned long head, tail;
+  if(r->isInitialized == 0)
+  { _errMsg("PTL_RingGetUsedSlots: ring not initialized");
+    return -1;
+  }
+  tail = (unsigned long)PTL_AtomicLoad(&r->tail);
+  head = (unsigned long)PTL_AtomicLoad(&r->head);
+  return (int)(head - tail);
+}
@@ -106,6 +106,35 @@ typedef struct {
 } PTL_queue_t;
 
 
+/***********************************************
+ * atomic counter, shared among threads :
+ ***********************************************/
+typedef volatile long PTL_atomic_t; /*!< access only via PTL_Atomic...() */
+
+
+/***********************************************
+ * lock-free single producer / single consumer ring :
+ ***********************************************/
+#define PTL_CACHE_LINE 64  /*!< bytes, for padding of shared indices */
+
+typedef struct {
+        /* producer side, own cache line */
+        PTL_atomic_t head;          /*!< slots written so far, written by producer only */
+        unsigned long tailCache;    /*!< producer's last view of tail */
+        char padHead[PTL_CACHE_LINE - sizeof(PTL_atomic_t) - sizeof(unsigned long)];
+        /* consumer side, own cache line */
+        PTL_atomic_t tail;          /*!< slots read so far, written by consumer only */
+        unsigned long headCache;    /*!< consumer's last view of head */
+        char padTail[PTL_CACHE_LINE - sizeof(PTL_atomic_t) - sizeof(unsigned long)];
+        /* read-only after PTL_RingCreate() */
+        char *buffer;               /*!< ring data buffer */
+        unsigned int maxSlots;      /*!< total number of slots, power of two */
+        unsigned int mask;          /*!< maxSlots - 1 */
+        unsigned int slotSize;      /*!< size of slot in byte */
+        unsigned int isInitialized; /*!< 0 if not initinialized */
+} PTL_ring_t;
+
+
 /***********************************************
  * exported functions
  ***********************************************/
@@ -116,6 +145,9 @@ int PTL_CreateThread(PTL_thread_t *thread,
                      void * arg);   
                                                          
 int PTL_Sleep(double seconds);
+int PTL_Yield(void);
+double PTL_GetTime(void);
+int PTL_GetNumberOfCPUs(void);
 int PTL_TerminateThread(PTL_thread_t thread);
 
 /* counting semaphores */
@@ -124,6 +156,13 @@ int PTL_SemDestroy(PTL_sem_t *s);
 int PTL_SemWait(PTL_sem_t *s);
 int PTL_SemSignal(PTL_sem_t *s);
 
+/* atomic operations, lock-free */
+long PTL_AtomicLoad(PTL_atomic_t *a);
+void PTL_AtomicStore(PTL_atomic_t *a, long value);
+long PTL_AtomicIncrement(PTL_atomic_t *a);
+long PTL_AtomicDecrement(PTL_atomic_t *a);
+void PTL_MemoryBarrier(void);
+
 /* message queues */
 int PTL_QueueCreate(PTL_queue_t *q, unsigned int slotSize, unsigned int nSlots);
 int PTL_QueueDestroy(PTL_queue_t *q);
@@ -136,6 +175,15 @@ int PTL_QueueGetMaxSlots(PTL_queue_t *q);
 int PTL_QueueGetSlotSize(PTL_queue_t *q);
 int PTL_QueueUnblockThreadsForTermination(PTL_queue_t *q);
 
+/* lock-free SPSC ring, zero copy */
+int PTL_RingCreate(PTL_ring_t *r, unsigned int slotSize, unsigned int nSlots);
+int PTL_RingDestroy(PTL_ring_t *r);
+unsigned int PTL_RingWriteReserve(PTL_ring_t *r, unsigned int nSlots, void **data);
+void PTL_RingWriteCommit(PTL_ring_t *r, unsigned int nSlots);
+unsigned int PTL_RingReadReserve(PTL_ring_t *r, unsigned int nSlots, void **data);
+void PTL_RingReadCommit(PTL_ring_t *r, unsigned int nSlots);
+int PTL_RingGetUsedSlots(PTL_ring_t *r);
+
 
 /*------------------------------------------*/
 #endif
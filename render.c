@@ -0,0 +1,440 @@
+/* render.c
+
+   Offline-Rendern, siehe render.h. Gelesen und geschrieben wird
+   blockweise mit sndWAVReadBlockStereo16()/sndWAVWriteBlockStereo16(),
+   dazwischen laeuft dieselbe dsp_chain wie im Player. Puffer und
+   Filterzustand liegen auf dem Heap, jeder Aufruf hat seine eigenen,
+   damit mehrere Dateien gleichzeitig gerechnet werden koennen (batch.c).
+
+   RenderWAVFileParallel() teilt eine Datei in Segmente, je Segment ein
+   Thread mit eigener Kette. Ein Segment beginnt RenderWarmupFrames()
+   vor seinem Anfang zu rechnen und verwirft diesen Vorlauf; bis dahin
+   ist der Filterzustand so weit eingeschwungen, dass er (fast) dem der
+   durchgehenden Rechnung entspricht. Jeder Thread schreibt mit eigenem
+   FILE an seine Stelle der Ausgabedatei.
+*/
+
+#define _FILE_OFFSET_BITS 64       /* fseeko() ueber 2GB, auch auf 32-Bit-Linux */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include "render.h"
+#include "dsp_chain.h"
+
+#define RENDER_BLOCK_FRAMES DSP_CHAIN_MAX_FRAMES
+#define RENDER_WARMUP_EPS   1e-6          /* Restanteil des alten Zustands */
+#define RENDER_MIN_SEGMENT  (10L * F_S)   /* kuerzere Segmente lohnen nicht */
+#define RENDER_FULL_SCALE   32768.0       /* groesster Betrag am Eingang eines Filters */
+#define RENDER_ROUND_OPS    8             /* Rundungen je Schritt eines Filters 2. Ordnung */
+
+/* ein Segment fuer RenderWAVFileParallel() */
+typedef struct
+{   const char *inName, *outName;
+    const sRam_t *parameter;
+    unsigned long first;      /* erstes Wertepaar mit Vorlauf */
+    unsigned long start;      /* erstes Wertepaar, das geschrieben wird */
+    unsigned long end;        /* hinter dem letzten */
+    long dataOut;             /* Anfang der Sounddaten in der Ausgabedatei */
+    int result;               /* 0 ok, -1 Fehler */
+    PTL_sem_t *doneSema;
+} render_segment_t;
+
+
+/*---------------------------------------------*/
+/* fseek() mit 64-Bit-Offset: long hat unter Windows nur 32 Bit, eine
+   WAV-Datei darf aber bis 4GB lang sein (gut 6 Stunden) */
+static int seek64(FILE *fp, unsigned long long offset, int whence)
+{
+#if (PLATFORM==OS_MS_WINDOWS)
+    return _fseeki64(fp, (__int64)offset, whence);
+#else
+    return fseeko(fp, (off_t)offset, whence);
+#endif
+}
+
+/*---------------------------------------------*/
+/* 16Bit-Stereo-Datei oeffnen, fp steht danach am Anfang der Sounddaten */
+static FILE *open_input(const char *inName, sndWaveHeader_t *wh)
+{   sndWAVChunkList_t chunks;
+    FILE *fp = fopen(inName, "rb");
+
+    if ((NULL == fp) || (0 != sndWAVScanChunks(fp, wh, &chunks)))
+    {   printf("cannot read %s\n", inName);
+        if (NULL != fp) fclose(fp);
+        return NULL;
+    }
+    if ((wh->nChannels != 2) || (wh->nBytesPerSample != 4))
+    {   puts("sorry: nur 16Bit Stereo-Dateien bitte");
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+/*---------------------------------------------*/
+/* bis zu nFrames Wertepaare lesen, rechnen und, falls fp_out != NULL,
+   schreiben. Rueckgabe: gerechnete Wertepaare (weniger am Dateiende),
+   -1 bei Fehler */
+static long render_frames(FILE *fp_in, FILE *fp_out, dsp_chain_t *chain, sndStereo16_t *x,
+                          const sRam_t *parameter, unsigned long nFrames)
+{   unsigned long pos;
+    int n;
+
+    for (pos = 0; pos < nFrames; pos += n)
+    {   n = RENDER_BLOCK_FRAMES;
+        if ((unsigned long)n > nFrames - pos) n = (int)(nFrames - pos);
+        n = sndWAVReadBlockStereo16(fp_in, x, n);
+        if (n < 0) return -1;
+        if (n == 0) break;
+        DSP_chain_process(chain, parameter, (short *)x, n);
+        if ((NULL != fp_out) && (n != sndWAVWriteBlockStereo16(fp_out, x, n)))
+            return -1;
+    }
+    return (long)pos;
+}
+
+/*---------------------------------------------*/
+int RenderWAVFile(const char *inName, const char *outName,
+                  const sRam_t *parameter, render_stats_t *st)
+{   sndStereo16_t *x;
+    dsp_chain_t *chain;
+    sndWaveHeader_t wh, wh_out;
+    FILE *fp_in, *fp_out;
+    unsigned long n_total, pos = 0;
+    double t0, t;
+    long n;
+    int ok = 1;
+
+    fp_in = open_input(inName, &wh);
+    if (NULL == fp_in) return -1;
+    if (wh.nSamplesPerSec != F_S)
+    {   printf("Achtung: Filter sind fuer %d Hz berechnet, Datei hat %lu Hz\n",
+               F_S, (unsigned long)wh.nSamplesPerSec);
+    }
+
+    /* Header mit der erwarteten Laenge, am Ende ggf. korrigiert */
+    n_total = sndWAVGetNumberOfSamples(wh);
+    fp_out = fopen(outName, "wb");
+    if ((NULL == fp_out)
+        || (0 != sndWAVInitHeader16(&wh_out, SND_STEREO, wh.nSamplesPerSec,
+                                    (uint32_t)(n_total * sizeof(sndStereo16_t))))
+        || (0 != sndWAVWriteFileHeader(fp_out, wh_out)))
+    {   printf("cannot write %s\n", outName);
+        if (NULL != fp_out) fclose(fp_out);
+        fclose(fp_in);
+        return -1;
+    }
+
+    x = malloc(RENDER_BLOCK_FRAMES * sizeof(sndStereo16_t));
+    chain = malloc(sizeof(dsp_chain_t));
+    if ((NULL == x) || (NULL == chain))
+    {   puts("RenderWAVFile: out of memory");
+        free(x);
+        free(chain);
+        fclose(fp_out);
+        fclose(fp_in);
+        return -1;
+    }
+
+    DSP_chain_reset(chain);
+    t0 = PTL_GetTime();
+    n = render_frames(fp_in, fp_out, chain, x, parameter, n_total);
+    if (n < 0) ok = 0;
+    else pos = (unsigned long)n;
+
+    /* Datei kuerzer als im Header angegeben: Laenge nachtragen */
+    if (ok && (pos != n_total))
+    {   sndWAVInitHeader16(&wh_out, SND_STEREO, wh.nSamplesPerSec,
+                           (uint32_t)(pos * sizeof(sndStereo16_t)));
+        if ((0 != fseek(fp_out, 0, SEEK_SET)) || (0 != sndWAVWriteFileHeader(fp_out, wh_out)))
+            ok = 0;
+    }
+    if (0 != fclose(fp_out)) ok = 0;
+    t = PTL_GetTime() - t0;
+    fclose(fp_in);
+    free(chain);
+    free(x);
+
+    if (NULL != st)
+    {   st->nFrames = pos;
+        st->seconds = t;
+        st->audio_seconds = (double)pos / wh.nSamplesPerSec;
+        st->realtime_factor = (t > 0.0) ? st->audio_seconds / t : 0.0;
+    }
+    return ok ? 0 : -1;
+}
+
+/*---------------------------------------------*/
+/* groesster Betrag der Pole von 1 + a1 z^-1 + a2 z^-2 */
+static double pole_radius(double a1, double a2)
+{   double d = a1 * a1 - 4.0 * a2, r1, r2;
+
+    if (d < 0.0) return sqrt(a2);            /* konjugiert komplex */
+    r1 = fabs((-a1 + sqrt(d)) / 2.0);
+    r2 = fabs((-a1 - sqrt(d)) / 2.0);
+    return (r1 > r2) ? r1 : r2;
+}
+
+/*---------------------------------------------*/
+/* Wertepaare, bis r^n unter RENDER_WARMUP_EPS liegt */
+static unsigned long decay_frames(double r)
+{
+    if (r <= 0.0) return 2;
+    if (r >= 1.0) return RENDER_WARMUP_MAX;
+    return (unsigned long)ceil(log(RENDER_WARMUP_EPS) / log(r));
+}
+
+/*---------------------------------------------*/
+/* Pole aller aktiven IIR-Filter: groesster Betrag und, als Schranke fuer
+   die Verstaerkung des Rundungsfehlers, die Summe von 1/(1-r)^2. Das ist
+   die L1-Norm der Impulsantwort von 1/A(z) bei einem doppelten Pol mit
+   Radius r, konjugiert komplexe oder verschiedene reelle Pole mit
+   hoechstens diesem Radius bleiben darunter */
+static double pole_stats(const sRam_t *parameter, double *noise_gain)
+{   double r = 0.0, rb, g = 0.0;
+    int i;
+
+    if (parameter->flag_EQ_is_active)
+    {   rb = pole_radius(parameter->TP.a1, parameter->TP.a2);  if (rb > r) r = rb;
+        if (rb < 1.0) g += 1.0 / ((1.0 - rb) * (1.0 - rb));
+        rb = pole_radius(parameter->BP.a1, parameter->BP.a2);  if (rb > r) r = rb;
+        if (rb < 1.0) g += 1.0 / ((1.0 - rb) * (1.0 - rb));
+        rb = pole_radius(parameter->HP.a1, parameter->HP.a2);  if (rb > r) r = rb;
+        if (rb < 1.0) g += 1.0 / ((1.0 - rb) * (1.0 - rb));
+    }
+    if (parameter->flag_PEQ_is_active)
+    {   for (i = 0; i < parameter->PEQ.nBands; i++)
+        {   rb = pole_radius(parameter->PEQ.a1[i], parameter->PEQ.a2[i]);
+            if (rb > r) r = rb;
+            if (rb < 1.0) g += 1.0 / ((1.0 - rb) * (1.0 - rb));
+        }
+    }
+    if (NULL != noise_gain) *noise_gain = g;
+    return r;
+}
+
+/*---------------------------------------------*/
+unsigned long RenderWarmupFrames(const sRam_t *parameter)
+{   double r = pole_stats(parameter, NULL);
+    unsigned long n = 0, n_echo;
+    int i, c, d0;
+
+    /* doppelte Pole (TP, HP) klingen wie n*r^n ab: doppelt so lang */
+    if (r > 0.0) n = 2 * decay_frames(r);
+
+    /* das Echo braucht die Werte bis zum laengsten Tap zurueck, mit
+       Rueckkopplung zusaetzlich so viele Umlaeufe ueber Tap 0, bis
+       feedback^k vernachlaessigbar ist */
+    if (parameter->flag_Echo_is_active && (parameter->Echo.nTaps > 0))
+    {   n_echo = 0;
+        for (i = 0; (i < parameter->Echo.nTaps) && (i < ECHO_MAX_TAPS); i++)
+            for (c = 0; c < 2; c++)
+                if ((unsigned long)parameter->Echo.tap[i].delay_n[c] > n_echo)
+                    n_echo = parameter->Echo.tap[i].delay_n[c];
+        n_echo++;
+        if (parameter->Echo.feedback != 0.0f)
+        {   d0 = parameter->Echo.tap[0].delay_n[0];
+            if (parameter->Echo.tap[0].delay_n[1] > d0) d0 = parameter->Echo.tap[0].delay_n[1];
+            if (d0 < 1) d0 = 1;
+            n_echo += (unsigned long)d0 * decay_frames(fabs(parameter->Echo.feedback));
+        }
+        n += n_echo;
+    }
+
+    /* der Hall braucht die ganze Impulsantwort zurueck, dazu seine Latenz */
+    if (parameter->flag_Conv_is_active && (NULL != parameter->Conv_IR))
+        n += (unsigned long)parameter->Conv_IR->nFrames + CONV_BLOCK;
+
+    /* ebenso der linearphasige Equalizer */
+    if (parameter->flag_EQ_is_active && parameter->flag_EQ_linear_phase)
+        n += FIR_EQ_TAPS + CONV_BLOCK;
+    return (n > RENDER_WARMUP_MAX) ? RENDER_WARMUP_MAX : n;
+}
+
+/*---------------------------------------------*/
+/* Die Filter rechnen ihren Zustand in double. Nach dem Vorlauf
+   unterscheiden sich Segment und Rechnung am Stueck nur noch um die
+   Rundungsfehler der Rekursion: je Schritt hoechstens RENDER_ROUND_OPS
+   Rundungen um DBL_EPSILON des Vollausschlags, verstaerkt um die L1-Norm
+   aus pole_stats(). Ein Unterschied e vor der Wandlung nach 16 Bit ergibt
+   hoechstens floor(e) + 1 LSB; das 1 LSB steckt in RENDER_PARALLEL_TOL_LSB. */
+int RenderParallelTolerance(const sRam_t *parameter)
+{   double g, e;
+
+    if (pole_stats(parameter, &g) >= 1.0) return 32767;   /* instabil */
+    e = RENDER_FULL_SCALE * RENDER_ROUND_OPS * DBL_EPSILON * g;
+    if (e > 32767.0) return 32767;
+    return RENDER_PARALLEL_TOL_LSB + (int)floor(e)
+           + (parameter->flag_dither ? 2 : 0);   /* anderes Rauschen je Segment */
+}
+
+/*---------------------------------------------*/
+static PTL_THREAD_RET_TYPE RenderSegmentFunc(void *pt)
+{   render_segment_t *seg = (render_segment_t *)pt;
+    sndWaveHeader_t wh;
+    sndStereo16_t *x = malloc(RENDER_BLOCK_FRAMES * sizeof(sndStereo16_t));
+    dsp_chain_t *chain = malloc(sizeof(dsp_chain_t));
+    FILE *fp_in = NULL, *fp_out = NULL;
+    unsigned long nWarm = seg->start - seg->first, nSeg = seg->end - seg->start;
+
+    seg->result = -1;
+    if ((NULL != x) && (NULL != chain)
+        && (NULL != (fp_in = open_input(seg->inName, &wh)))
+        && (NULL != (fp_out = fopen(seg->outName, "r+b")))
+        && (0 == seek64(fp_in, (unsigned long long)seg->first * sizeof(sndStereo16_t), SEEK_CUR))
+        && (0 == seek64(fp_out, (unsigned long long)seg->dataOut
+                                + (unsigned long long)seg->start * sizeof(sndStereo16_t), SEEK_SET)))
+    {   DSP_chain_reset(chain);
+        if (((long)nWarm == render_frames(fp_in, NULL, chain, x, seg->parameter, nWarm))
+            && ((long)nSeg == render_frames(fp_in, fp_out, chain, x, seg->parameter, nSeg)))
+            seg->result = 0;
+    }
+    if ((NULL != fp_out) && (0 != fclose(fp_out))) seg->result = -1;
+    if (NULL != fp_in) fclose(fp_in);
+    free(chain);
+    free(x);
+    PTL_SemSignal(seg->doneSema);
+    return 0;
+}
+
+/*---------------------------------------------*/
+int RenderWAVFileParallel(const char *inName, const char *outName,
+                          const sRam_t *parameter, int nSegments, render_stats_t *st)
+{   render_segment_t seg[RENDER_MAX_SEGMENTS];
+    sndWaveHeader_t wh, wh_out;
+    PTL_sem_t doneSema;
+    PTL_thread_t tid;
+    FILE *fp;
+    unsigned long n_total, nWarm, len;
+    long dataOut;
+    double t0, t;
+    int i, ok = 1;
+
+    if (nSegments <= 0) nSegments = PTL_GetNumberOfCPUs();
+    if (nSegments > RENDER_MAX_SEGMENTS) nSegments = RENDER_MAX_SEGMENTS;
+
+    fp = open_input(inName, &wh);
+    if (NULL == fp) return -1;
+    fclose(fp);
+    n_total = sndWAVGetNumberOfSamples(wh);
+    nWarm = RenderWarmupFrames(parameter);
+
+    /* Segmente nicht kuerzer als Vorlauf und RENDER_MIN_SEGMENT */
+    len = (nWarm > (unsigned long)RENDER_MIN_SEGMENT) ? nWarm : (unsigned long)RENDER_MIN_SEGMENT;
+    if ((unsigned long)nSegments > n_total / len) nSegments = (int)(n_total / len);
+    if (nSegments <= 1)
+        return RenderWAVFile(inName, outName, parameter, st);
+
+    if (wh.nSamplesPerSec != F_S)
+    {   printf("Achtung: Filter sind fuer %d Hz berechnet, Datei hat %lu Hz\n",
+               F_S, (unsigned long)wh.nSamplesPerSec);
+    }
+
+    /* Header mit der vollen Laenge, die Segmente schreiben dahinter */
+    fp = fopen(outName, "wb");
+    if ((NULL == fp)
+        || (0 != sndWAVInitHeader16(&wh_out, SND_STEREO, wh.nSamplesPerSec,
+                                    (uint32_t)(n_total * sizeof(sndStereo16_t))))
+        || (0 != sndWAVWriteFileHeader(fp, wh_out))
+        || (0 > (dataOut = ftell(fp))))
+    {   printf("cannot write %s\n", outName);
+        if (NULL != fp) fclose(fp);
+        return -1;
+    }
+    if (0 != fclose(fp))
+    {   printf("cannot write %s\n", outName);
+        return -1;
+    }
+
+    PTL_SemCreate(&doneSema, 0);
+    EQ_init_kernel();
+    t0 = PTL_GetTime();
+    for (i = 0; i < nSegments; i++)
+    {   seg[i].inName = inName;
+        seg[i].outName = outName;
+        seg[i].parameter = parameter;
+        seg[i].start = n_total / nSegments * i;
+        seg[i].end = (i == nSegments - 1) ? n_total : n_total / nSegments * (i + 1);
+        seg[i].first = (seg[i].start > nWarm) ? seg[i].start - nWarm : 0;
+        if (parameter->flag_Conv_is_active ||   /* Bloecke der Faltung wie am Stueck */
+            (parameter->flag_EQ_is_active && parameter->flag_EQ_linear_phase))
+            seg[i].first -= seg[i].first % CONV_BLOCK;
+        seg[i].dataOut = dataOut;
+        seg[i].doneSema = &doneSema;
+        if (0 != PTL_CreateThread(&tid, RenderSegmentFunc, &seg[i]))
+            RenderSegmentFunc(&seg[i]);       /* dann eben selbst */
+    }
+    for (i = 0; i < nSegments; i++) PTL_SemWait(&doneSema);
+    t = PTL_GetTime() - t0;
+    PTL_SemDestroy(&doneSema);
+
+    for (i = 0; i < nSegments; i++)
+        if (0 != seg[i].result) ok = 0;
+    if (!ok) printf("Rendern von %s fehlgeschlagen\n", outName);
+
+    if (NULL != st)
+    {   st->nFrames = ok ? n_total : 0;
+        st->seconds = t;
+        st->audio_seconds = (double)st->nFrames / wh.nSamplesPerSec;
+        st->realtime_factor = (t > 0.0) ? st->audio_seconds / t : 0.0;
+    }
+    return ok ? 0 : -1;
+}
+
+/*---------------------------------------------*/
+int RenderCompareWAV(const char *aName, const char *bName, render_diff_t *d)
+{   sndWaveHeader_t wa, wb;
+    sndStereo16_t *a, *b;
+    FILE *fpa, *fpb;
+    unsigned long pos = 0;
+    int n, i, diff, ok = 1;
+
+    d->nFrames = 0;
+    d->nDiff = 0;
+    d->maxDiff = 0;
+    d->firstDiff = 0;
+    fpa = open_input(aName, &wa);
+    if (NULL == fpa) return -1;
+    fpb = open_input(bName, &wb);
+    if (NULL == fpb)
+    {   fclose(fpa);
+        return -1;
+    }
+    if (sndWAVGetNumberOfSamples(wa) != sndWAVGetNumberOfSamples(wb))
+    {   puts("RenderCompareWAV: Dateien sind unterschiedlich lang");
+        fclose(fpb);
+        fclose(fpa);
+        return -1;
+    }
+    a = malloc(2 * RENDER_BLOCK_FRAMES * sizeof(sndStereo16_t));
+    if (NULL == a)
+    {   fclose(fpb);
+        fclose(fpa);
+        return -1;
+    }
+    b = a + RENDER_BLOCK_FRAMES;
+
+    while (0 < (n = sndWAVReadBlockStereo16(fpa, a, RENDER_BLOCK_FRAMES)))
+    {   if (n != sndWAVReadBlockStereo16(fpb, b, n))
+        {   ok = 0;
+            break;
+        }
+        for (i = 0; i < n; i++)
+        {   diff = abs(a[i].val_li - b[i].val_li);
+            if (abs(a[i].val_re - b[i].val_re) > diff) diff = abs(a[i].val_re - b[i].val_re);
+            if (diff == 0) continue;
+            if (d->nDiff == 0) d->firstDiff = pos + i;
+            d->nDiff++;
+            if (diff > d->maxDiff) d->maxDiff = diff;
+        }
+        pos += n;
+    }
+    if (n < 0) ok = 0;
+    d->nFrames = pos;
+    free(a);
+    fclose(fpb);
+    fclose(fpa);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,70 @@
+/* render.h :
+   Offline-Rendern: eine WAV-Datei durch die Signalverarbeitung des
+   Players (dsp_chain) schicken und das Ergebnis wieder als WAV-Datei
+   schreiben, so schnell wie die CPU kann, ohne Soundkarte und GUI.
+*/
+
+#ifndef _render_h_
+#define _render_h_
+
+#include "globals.h"
+
+/* Ergebnis eines Durchlaufs */
+typedef struct
+{   unsigned long nFrames;   /* bearbeitete Wertepaare */
+    double seconds;          /* Rechenzeit */
+    double audio_seconds;    /* Dauer der Datei */
+    double realtime_factor;  /* Dauer der Datei / Rechenzeit */
+} render_stats_t;
+
+/* inName (16Bit Stereo) mit den Einstellungen aus *parameter bearbeiten
+   und nach outName schreiben. st darf NULL sein.
+   Rueckgabe: 0 fuer ok, -1 bei Fehler */
+int RenderWAVFile(const char *inName, const char *outName,
+                  const sRam_t *parameter, render_stats_t *st);
+
+/* Eine lange Datei in nSegments Stuecken parallel rendern, je Stueck ein
+   Thread (nSegments <= 0: einer pro CPU). Jedes Stueck rechnet vorher
+   RenderWarmupFrames() Wertepaare Vorlauf, damit Filter und Echo
+   eingeschwungen sind. Zu kurze Dateien werden am Stueck gerechnet.
+   Gegenueber RenderWAVFile() weicht das Ergebnis hinter den Stossstellen
+   um hoechstens RenderParallelTolerance() LSB ab:
+   - 1 LSB durch andere Rundung bei der Wandlung nach 16 Bit, mit Echo
+     kommt dieselbe Abweichung verzoegert dazu.
+   - die IIR-Filter rechnen ihren Zustand in double. Auch Pole nahe z=1
+     (tiefe Baender des parametrischen EQ, z.B. 20..60 Hz, verstaerken
+     Rundungsfehler um bis zu 1/(1-r)^2) bringen damit weit unter 1 LSB;
+     die Schranke dafuer steht in RenderParallelTolerance().
+   - mit Dither beginnt jedes Segment eine eigene Rauschfolge, +-2 LSB.
+   - ein Echo mit feedback >= 1 klingt nie ab, dann gilt keine Grenze.
+   Rueckgabe: 0 fuer ok, -1 bei Fehler */
+#define RENDER_MAX_SEGMENTS     64
+#define RENDER_WARMUP_MAX       (60L * F_S)   /* hoechstens 1 Minute Vorlauf */
+#define RENDER_PARALLEL_TOL_LSB 2             /* Rundung nach 16 Bit, mit Echo */
+
+int RenderWAVFileParallel(const char *inName, const char *outName,
+                          const sRam_t *parameter, int nSegments, render_stats_t *st);
+
+/* Vorlauf in Wertepaaren fuer die Einstellungen *parameter: bis der
+   Einfluss des Anfangszustands der IIR-Filter auf 1e-6 abgeklungen und
+   der Ringbuffer des Echos und die Impulsantworten von Hall und
+   linearphasigem Equalizer gefuellt sind */
+unsigned long RenderWarmupFrames(const sRam_t *parameter);
+
+/* erlaubte Abweichung in LSB fuer die Einstellungen *parameter, siehe
+   RenderWAVFileParallel(), aus den Polradien aller aktiven Filter.
+   32767 fuer instabile Filter: dann gilt keine Grenze */
+int RenderParallelTolerance(const sRam_t *parameter);
+
+/* Unterschied zweier 16Bit-Stereo-Dateien */
+typedef struct
+{   unsigned long nFrames;    /* verglichene Wertepaare */
+    unsigned long nDiff;      /* Wertepaare mit Abweichung */
+    unsigned long firstDiff;  /* erstes davon */
+    int maxDiff;              /* groesste Abweichung in LSB */
+} render_diff_t;
+
+/* Rueckgabe: 0 fuer ok, -1 wenn nicht lesbar oder unterschiedlich lang */
+int RenderCompareWAV(const char *aName, const char *bName, render_diff_t *d);
+
+#endif
@@ -31,6 +31,12 @@
 #include <string.h>
 #include "snd_lib.h"
 
+#if (PLATFORM==OS_LINUX)
+  #include <sys/mman.h>   /* sndWAVMapFile */
+  #include <sys/stat.h>
+  #include <time.h>       /* Takt von SND_SINK_NULL, Statistik */
+#endif
+
 
 
 #define BugFixWin10 1   /* != 0 for Win10 Bug Fix!! */
@@ -112,23 +118,39 @@ static void _errMsg(char *str)
 
 
 
+/* der kanonische Header muss ohne Padding genau 44 Byte lang sein */
+typedef char _sndWaveHeaderSizeCheck[(sizeof(sndWaveHeader_t) == 44) ? 1 : -1];
+
+#define WAVE_FORMAT_PCM        0x0001
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+/*************************************************/
+/* little endian Felder byteweise lesen, unabhaengig von der Host-Byteordnung */
+static uint16_t _le16(const unsigned char *p)
+{   return (uint16_t)(p[0] | (p[1] << 8));
+}
+static uint32_t _le32(const unsigned char *p)
+{   return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+/*************************************************/
+
+
 /*!
  ***********************************************************************
   @par Description:
     Funktion liest den Header aus der Wave-Datei mit Hilfe der Struktur
     sndWaveHeader_t.
 
-  @par Note: Diese Funktion geht davon aus, dass es nur einen Format-Chunk
-    und einen Data-Chunk der Wave-Datei gibt. Das trifft nicht fuer jede
-    Datei zu. In einer verbesserten Version dieser Funktion muesste man
-    den Datei-Header nach dem Format-Chunk und dem Data-Chunk durchsuchen
-    und ggf. weitere Chunks ueberlesen.
+  @par Note: Die RIFF-Chunks werden mit sndWAVScanChunks() durchlaufen,
+    weitere Chunks werden ueberlesen. Danach steht der Dateizeiger am
+    Anfang der Sounddaten.
 
   @par Used by:
   @arg sndWAVPlaySound()
 
   @see
-  @arg sndWAVWriteFileHeader()
+  @arg sndWAVWriteFileHeader(), sndWAVScanChunks()
 
   @param  fp -  IN, Zeiger auf die bereits geoeffnete Datei
   @param  wh -  IN/OUT, Zeiger auf Struktur der Daten des Headers der
@@ -139,30 +161,400 @@ static void _errMsg(char *str)
  ********************************************************************/
 int sndWAVReadFileHeader(FILE *fp, sndWaveHeader_t *wh)
 {
-        /* HeaderDaten aus Datei einlesen */
-        if(NULL == fp)
-        {   _errMsg("sndWAVReadFileHeader, no file!");
-            return -1;
-        }
-        if(1!=fread(wh, sizeof(sndWaveHeader_t),1,fp))
+        sndWAVChunkList_t cl;
+
+        if(0!=sndWAVScanChunks(fp, wh, &cl))
         {   _errMsg("sndWAVReadFileHeader: cannot read header");
             return -1;
         }
 #if 0
-        printf(" Datei-Laenge................. %u\n",wh->length);
-        printf(" Laenge sub_chunk............. %u\n",wh->sub_length);
+        printf(" Datei-Laenge................. %lu\n",(unsigned long)wh->length);
+        printf(" Laenge sub_chunk............. %lu\n",(unsigned long)wh->sub_length);
         printf(" PCM-Code..................... %u\n",wh->format);
         printf(" Anzahl Kanaele............... %u\n",wh->nChannels);
-        printf(" 11kHz | 22kHz ............... %u\n",wh->nSamplesPerSec);
-        printf(" Datendurchsatz Bytes per Sec. %u\n",wh->nBytesPerSec);
+        printf(" 11kHz | 22kHz ............... %lu\n",(unsigned long)wh->nSamplesPerSec);
+        printf(" Datendurchsatz Bytes per Sec. %lu\n",(unsigned long)wh->nBytesPerSec);
         printf(" Bytes per Sample   .......... %u\n",wh->nBytesPerSample);
         printf(" Bit per Sample 8,12,16....... %u\n",wh->nBitsPerSample);
-        printf(" Laenge des Datenblocks....... %u\n\n",wh->data_length);
+        printf(" Laenge des Datenblocks....... %lu\n\n",(unsigned long)wh->data_length);
 #endif
         return(0);
 }
 /*----------------------------------------------------------------*/
 
+/*************************************************/
+/* Datenquelle fuer den Chunk-Parser: geoeffnete Datei oder Speicher-
+   abbildung (sndWAVMapFile). Gelesen wird immer ab absoluter Position. */
+typedef struct {
+    FILE *fp;                   /* != NULL: aus Datei lesen */
+    const unsigned char *mem;   /* sonst: aus dem Speicher lesen */
+    uint32_t size;              /* Groesse der Quelle in Bytes */
+} _wavSource_t;
+
+static int _srcRead(const _wavSource_t *src, uint32_t pos, void *buf, uint32_t len)
+{   if((pos > src->size) || (len > src->size - pos))
+    {   return -1;
+    }
+    if(NULL != src->fp)
+    {   if((0!=fseek(src->fp, (long)pos, SEEK_SET)) || (1!=fread(buf, len, 1, src->fp)))
+            return -1;
+    }
+    else
+    {   memcpy(buf, src->mem + pos, len);
+    }
+    return 0;
+}
+/*************************************************/
+
+/*! \internal
+ ***********************************************************************
+  @par Description:
+    Durchlaeuft die RIFF-Chunks der Quelle und merkt sich Kennung,
+    Offset und Laenge jedes Chunks. Aus "fmt " und "data" wird der
+    kanonische Header wh gebildet. Chunks mit ungerader Laenge haben
+    ein Fuellbyte, das mit ueberlesen wird. Fuer "fmt " und "data" bleibt
+    immer ein Eintrag frei: ist das Verzeichnis voll, werden weitere
+    Chunks nur noch ueberlesen, die beiden aber weiter gesucht.
+
+  @retval 0 for ok, -1 on error
+ ********************************************************************/
+static int _wavScanChunks(const _wavSource_t *src, sndWaveHeader_t *wh, sndWAVChunkList_t *cl)
+{
+    unsigned char hdr[12], fmt[40];
+    uint32_t riff_end, pos, len, fmt_len;
+    sndWAVChunk_t *c;
+    int is_fmt, is_data, reserved;
+
+    cl->nChunks   = 0;
+    cl->fmtIndex  = -1;
+    cl->dataIndex = -1;
+
+    /* RIFF-Kopf: "RIFF" <Laenge> "WAVE" */
+    if(0!=_srcRead(src, 0, hdr, sizeof(hdr)))
+    {   _errMsg("sndWAVScanChunks: cannot read RIFF header");
+        return -1;
+    }
+    if((0!=memcmp(hdr, "RIFF", 4)) || (0!=memcmp(hdr+8, "WAVE", 4)))
+    {   _errMsg("sndWAVScanChunks: not a RIFF/WAVE file");
+        return -1;
+    }
+    riff_end = _le32(hdr+4) + 8;
+    if((riff_end < 12) || (riff_end > src->size))
+    {   riff_end = src->size;  /* Laengenangabe kaputt: Dateigroesse nehmen */
+    }
+
+    /* alle Chunks durchlaufen */
+    pos = 12;
+    while(pos + 8 <= riff_end)
+    {   if(0!=_srcRead(src, pos, hdr, 8))
+        {   break;  /* abgeschnittene Datei: bisher Gefundenes verwenden */
+        }
+        len = _le32(hdr+4);
+        if(len > riff_end - (pos + 8))
+        {   len = riff_end - (pos + 8);  /* Laengenangabe zu gross */
+        }
+        is_fmt  = (cl->fmtIndex < 0) && (0==memcmp(hdr, "fmt ", 4));
+        is_data = (cl->dataIndex < 0) && (0==memcmp(hdr, "data", 4));
+        /* Eintraege, die fmt und data noch brauchen */
+        reserved = (cl->fmtIndex < 0) + (cl->dataIndex < 0);
+        if(is_fmt || is_data || (cl->nChunks < SND_WAV_MAX_CHUNKS - reserved))
+        {   c = &(cl->chunk[cl->nChunks]);
+            memcpy(c->id, hdr, 4);
+            c->offset = pos + 8;
+            c->length = len;
+            if(is_fmt)  cl->fmtIndex  = cl->nChunks;
+            if(is_data) cl->dataIndex = cl->nChunks;
+            cl->nChunks++;
+        }
+        pos += 8 + len + (len & 1);  /* Fuellbyte bei ungerader Laenge */
+    }
+
+    if((cl->fmtIndex < 0) || (cl->dataIndex < 0))
+    {   _errMsg("sndWAVScanChunks: fmt or data chunk missing");
+        return -1;
+    }
+
+    /* Format-Chunk auswerten */
+    c = &(cl->chunk[cl->fmtIndex]);
+    fmt_len = c->length;
+    if(fmt_len < 16)
+    {   _errMsg("sndWAVScanChunks: fmt chunk too short");
+        return -1;
+    }
+    if(fmt_len > sizeof(fmt)) fmt_len = sizeof(fmt);
+    if(0!=_srcRead(src, c->offset, fmt, fmt_len))
+    {   _errMsg("sndWAVScanChunks: cannot read fmt chunk");
+        return -1;
+    }
+
+    memcpy(&(wh->main_chunk), "RIFF", 4);
+    wh->length          = 36 + cl->chunk[cl->dataIndex].length;
+    memcpy(&(wh->chunk_type), "WAVE", 4);
+    memcpy(&(wh->sub_chunk), "fmt ", 4);
+    wh->sub_length      = 16;
+    wh->format          = _le16(fmt);
+    wh->nChannels       = _le16(fmt+2);
+    wh->nSamplesPerSec  = _le32(fmt+4);
+    wh->nBytesPerSec    = _le32(fmt+8);
+    wh->nBytesPerSample = _le16(fmt+12);
+    wh->nBitsPerSample  = _le16(fmt+14);
+    memcpy(&(wh->data_chunk), "data", 4);
+    wh->data_length     = cl->chunk[cl->dataIndex].length;
+
+    /* WAVE_FORMAT_EXTENSIBLE: Subformat-GUID beginnt mit dem Formatcode */
+    if((wh->format == WAVE_FORMAT_EXTENSIBLE) && (fmt_len >= 26))
+    {   wh->format = _le16(fmt+24);
+    }
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
+/*!
+ ***********************************************************************
+  @par Description:
+    Funktion durchlaeuft die RIFF-Chunks der Wave-Datei und merkt sich
+    Kennung, Offset und Laenge jedes Chunks. Am Ende steht der
+    Dateizeiger am Anfang der Sounddaten.
+
+  @see
+  @arg sndWAVReadFileHeader(), sndWAVSeekData()
+
+  @param  fp -  IN, Zeiger auf die bereits geoeffnete Datei
+  @param  wh -  IN/OUT, Header der Wavedatei
+  @param  cl -  IN/OUT, Chunk-Verzeichnis, darf NULL sein
+
+  @retval 0 for ok, -1 on error
+
+ ********************************************************************/
+int sndWAVScanChunks(FILE *fp, sndWaveHeader_t *wh, sndWAVChunkList_t *cl)
+{
+    sndWAVChunkList_t local;
+    _wavSource_t src;
+    long file_size;
+
+    if(NULL == fp)
+    {   _errMsg("sndWAVScanChunks, no file!");
+        return -1;
+    }
+    if(NULL == cl) cl = &local;
+
+    /* Dateilaenge, um kaputte Laengenangaben zu erkennen */
+    if((0!=fseek(fp, 0L, SEEK_END)) || ((file_size = ftell(fp)) < 12))
+    {   _errMsg("sndWAVScanChunks: file too short or not seekable");
+        return -1;
+    }
+    src.fp   = fp;
+    src.mem  = NULL;
+    src.size = (uint32_t)file_size;
+
+    if(0!=_wavScanChunks(&src, wh, cl))
+    {   return -1;
+    }
+    return sndWAVSeekData(fp, cl);
+}
+/*----------------------------------------------------------------*/
+
+/*!
+ ***********************************************************************
+  @par Description:
+    Positioniert den Dateizeiger auf den Anfang der Sounddaten.
+
+  @see
+  @arg sndWAVScanChunks()
+
+  @param  fp -  IN, Zeiger auf die bereits geoeffnete Datei
+  @param  cl -  IN, Chunk-Verzeichnis aus sndWAVScanChunks()
+
+  @retval 0 for ok, -1 on error
+
+ ********************************************************************/
+int sndWAVSeekData(FILE *fp, const sndWAVChunkList_t *cl)
+{
+    if((NULL == fp) || (NULL == cl) || (cl->dataIndex < 0))
+    {   _errMsg("sndWAVSeekData, no file or no data chunk!");
+        return -1;
+    }
+    if(0!=fseek(fp, (long)cl->chunk[cl->dataIndex].offset, SEEK_SET))
+    {   _errMsg("sndWAVSeekData: cannot seek to data chunk");
+        return -1;
+    }
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
+/*!
+ ***********************************************************************
+  @par Description:
+    Bildet die Wave-Datei schreibgeschuetzt in den Speicher ab und
+    ermittelt Header und Lage der Sounddaten direkt aus der Abbildung.
+    Linux: die Abbildung wird mit MADV_SEQUENTIAL markiert, der erste
+    Readahead-Bereich wird mit sndWAVMapAdvise() angefordert.
+
+  @see
+  @arg sndWAVUnmapFile(), sndWAVMapAdvise()
+
+  @param  Filename -  IN, Name der Wave-Datei
+  @param  map      -  IN/OUT, Beschreibung der Abbildung
+
+  @retval 0 for ok, -1 on error
+
+ ********************************************************************/
+int sndWAVMapFile(const char *Filename, sndWAVMap_t *map)
+{
+    _wavSource_t src;
+
+    memset(map, 0, sizeof(sndWAVMap_t));
+
+#if (PLATFORM==OS_LINUX)
+    {   int fd;
+        struct stat st;
+        void *base;
+
+        if((fd = open(Filename, O_RDONLY)) < 0)
+        {   _errMsg("sndWAVMapFile: cannot open file");
+            return -1;
+        }
+        if((0!=fstat(fd, &st)) || (st.st_size < 12) || ((uint64_t)st.st_size > 0xFFFFFFFFu))
+        {   _errMsg("sndWAVMapFile: file too short or too large");
+            close(fd);
+            return -1;
+        }
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);  /* die Abbildung bleibt auch ohne Deskriptor gueltig */
+        if(MAP_FAILED == base)
+        {   _errMsg("sndWAVMapFile: mmap failed");
+            return -1;
+        }
+        madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+        map->base = (const unsigned char *)base;
+        map->size = (uint32_t)st.st_size;
+    }
+#endif
+#if (PLATFORM==OS_MS_WINDOWS)
+    {   HANDLE hFile, hMapping;
+        DWORD size_hi, size_lo;
+
+        hFile = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if(INVALID_HANDLE_VALUE == hFile)
+        {   _errMsg("sndWAVMapFile: cannot open file");
+            return -1;
+        }
+        size_lo = GetFileSize(hFile, &size_hi);
+        if((size_hi != 0) || (size_lo < 12))
+        {   _errMsg("sndWAVMapFile: file too short or too large");
+            CloseHandle(hFile);
+            return -1;
+        }
+        hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(hFile);
+        if(NULL == hMapping)
+        {   _errMsg("sndWAVMapFile: CreateFileMapping failed");
+            return -1;
+        }
+        map->base = (const unsigned char *)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(hMapping);  /* die Sicht haelt die Abbildung am Leben */
+        if(NULL == map->base)
+        {   _errMsg("sndWAVMapFile: MapViewOfFile failed");
+            return -1;
+        }
+        map->size = size_lo;
+    }
+#endif
+
+    src.fp   = NULL;
+    src.mem  = map->base;
+    src.size = map->size;
+    if(0!=_wavScanChunks(&src, &(map->wh), &(map->cl)))
+    {   sndWAVUnmapFile(map);
+        return -1;
+    }
+    map->data    = (const int16_t *)(map->base + map->cl.chunk[map->cl.dataIndex].offset);
+    map->nFrames = sndWAVGetNumberOfSamples(map->wh);
+    sndWAVMapAdvise(map, 0);
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
+/*!
+ ***********************************************************************
+  @par Description:
+    Fordert fuer die Sounddaten ab Abtastwert(paar) framePos vorab
+    SND_WAV_MAP_READAHEAD_FRAMES an (Linux: MADV_WILLNEED). Ein neues
+    Fenster wird erst angefordert, wenn framePos die Mitte des zuletzt
+    angeforderten Fensters erreicht; der Aufruf pro Block ist also
+    billig. Unter Windows ohne Wirkung.
+
+  @param  map      -  IN/OUT, Beschreibung der Abbildung
+  @param  framePos -  IN, aktuelle Leseposition in Abtastwerten
+
+  @retval 0 for ok, -1 on error
+
+ ********************************************************************/
+int sndWAVMapAdvise(sndWAVMap_t *map, uint32_t framePos)
+{
+#if (PLATFORM==OS_LINUX)
+    uint32_t frame_bytes, start, end;
+    long page;
+
+    if((NULL == map) || (NULL == map->base))
+    {   return -1;
+    }
+    if((map->advisedFrames > 0) &&
+       (framePos + SND_WAV_MAP_READAHEAD_FRAMES/2 < map->advisedFrames))
+    {   return 0;  /* noch genug vorab angefordert */
+    }
+    if(framePos >= map->nFrames)
+    {   return 0;
+    }
+    frame_bytes = map->wh.nBytesPerSample;
+    if(frame_bytes == 0) frame_bytes = 1;
+    end = framePos + SND_WAV_MAP_READAHEAD_FRAMES;
+    if(end > map->nFrames) end = map->nFrames;
+
+    /* madvise braucht seitenbuendige Adressen */
+    page  = sysconf(_SC_PAGESIZE);
+    if(page <= 0) page = 4096;
+    start = (uint32_t)((const unsigned char *)map->data - map->base) + framePos * frame_bytes;
+    start -= start % (uint32_t)page;
+    madvise((void *)(map->base + start),
+            ((const unsigned char *)map->data - map->base) + (size_t)end * frame_bytes - start,
+            MADV_WILLNEED);
+    map->advisedFrames = end;
+#endif
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
+/*!
+ ***********************************************************************
+  @par Description:
+    Hebt die Abbildung der Wave-Datei wieder auf.
+
+  @see
+  @arg sndWAVMapFile()
+
+  @param  map      -  IN/OUT, Beschreibung der Abbildung
+
+  @retval 0 for ok, -1 on error
+
+ ********************************************************************/
+int sndWAVUnmapFile(sndWAVMap_t *map)
+{
+    if((NULL == map) || (NULL == map->base))
+    {   return -1;
+    }
+#if (PLATFORM==OS_LINUX)
+    munmap((void *)map->base, map->size);
+#endif
+#if (PLATFORM==OS_MS_WINDOWS)
+    UnmapViewOfFile(map->base);
+#endif
+    memset(map, 0, sizeof(sndWAVMap_t));
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
 /*!
  *******************************************************************
   @par Description:
@@ -195,6 +587,31 @@ int sndWAVReadFileHeader(FILE *fp, sndWaveHeader_t *wh)
 /*----------------------------------------------------------------*/
 
 
+int sndWAVInitHeader16(sndWaveHeader_t *wh, int nChannels, uint32_t rate_Hz,
+                       uint32_t data_length)
+{
+    if((nChannels != SND_MONO) && (nChannels != SND_STEREO))
+    {   _errMsg("sndWAVInitHeader16: use either SND_MONO or SND_STEREO");
+        return -1;
+    }
+    memcpy(&(wh->main_chunk), "RIFF", 4);
+    wh->length          = 36 + data_length;
+    memcpy(&(wh->chunk_type), "WAVE", 4);
+    memcpy(&(wh->sub_chunk), "fmt ", 4);
+    wh->sub_length      = 16;
+    wh->format          = WAVE_FORMAT_PCM;
+    wh->nChannels       = nChannels;
+    wh->nSamplesPerSec  = rate_Hz;
+    wh->nBytesPerSample = nChannels * sizeof(short);
+    wh->nBytesPerSec    = rate_Hz * wh->nBytesPerSample;
+    wh->nBitsPerSample  = 16;
+    memcpy(&(wh->data_chunk), "data", 4);
+    wh->data_length     = data_length;
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
+
 /*!
  **************************************************************
   @par Description:
@@ -457,46 +874,351 @@ int sndWAVReadSampleMono16(FILE *fp, sndMono16_t *x)
   @param fp - IN, Zeiger auf bereits geoffnete Datei
   @param x  - IN, Abtastwert
 
-  @retval 0 for ok, -1 on error
+  @retval 0 for ok, -1 on error
+
+ *****************************************************************/
+int sndWAVWriteSampleStereo16(FILE *fp, sndStereo16_t x)
+{   if(NULL == fp)
+    {   _errMsg("sndWAVWriteSampleStereo16, no file!");
+        return -1;
+    }
+    if(1!=fwrite(&x, sizeof(sndStereo16_t),1,fp))
+    {   _errMsg("sndWAVWriteSampleStereo16: cannot write sample");
+        return -1;
+    }
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
+/*!
+ ******************************************************************
+  @par Description:
+    Funktion liest ein 16Bit Stereo Samplepaar aus Wavedatei ein
+
+  @par Used by:
+
+  @see
+  @arg sndWAVWriteSampleStereo16
+
+  @param fp - IN, Zeiger auf bereits geoffnete Datei
+  @param x - IN/OUT Zeiger auf Abtastwert
+
+  @retval  0: ok, -1: error
+
+ *****************************************************************/
+int sndWAVReadSampleStereo16(FILE *fp, sndStereo16_t *x)
+{   if(NULL == fp)
+    {   _errMsg("sndWAVReadSampleStereo16, no file!");
+        return -1;
+    }
+    if(1!=fread(x, sizeof(sndStereo16_t),1,fp))
+    {   _errMsg("sndWAVReadSampleStereo16: cannot read sample");
+        return -1;
+    }
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
+/*!
+ ******************************************************************
+  @par Description:
+    Funktion liest einen Block von bis zu nFrames 16Bit Stereo
+    Samplepaaren aus Wavedatei ein
+
+  @par Used by:
+
+  @see
+  @arg sndWAVReadSampleStereo16
+
+  @param fp      - IN, Zeiger auf bereits geoffnete Datei
+  @param x       - IN/OUT Feld fuer die Abtastwerte
+  @param nFrames - IN, Anzahl der zu lesenden Samplepaare
+
+  @retval  Anzahl gelesener Samplepaare, 0 am Dateiende, -1: error
+
+ *****************************************************************/
+int sndWAVReadBlockStereo16(FILE *fp, sndStereo16_t *x, int nFrames)
+{   size_t n;
+
+    if(NULL == fp)
+    {   _errMsg("sndWAVReadBlockStereo16, no file!");
+        return -1;
+    }
+    if(nFrames <= 0)
+    {   return 0;
+    }
+    n = fread(x, sizeof(sndStereo16_t), nFrames, fp);
+    if((n < (size_t)nFrames) && ferror(fp))
+    {   _errMsg("sndWAVReadBlockStereo16: cannot read samples");
+        return -1;
+    }
+    return (int)n;
+}
+/*----------------------------------------------------------------*/
+
+
+int sndWAVWriteBlockStereo16(FILE *fp, const sndStereo16_t *x, int nFrames)
+{
+    if(NULL == fp)
+    {   _errMsg("sndWAVWriteBlockStereo16, no file!");
+        return -1;
+    }
+    if(nFrames <= 0)
+    {   return 0;
+    }
+    if((size_t)nFrames != fwrite(x, sizeof(sndStereo16_t), nFrames, fp))
+    {   _errMsg("sndWAVWriteBlockStereo16: cannot write samples");
+        return -1;
+    }
+    return nFrames;
+}
+/*----------------------------------------------------------------*/
+
+
+/* Puffereinstellungen fuer sndGetProfile(), alle Plattformen */
+typedef struct {
+    const char  *name;
+    sndConfig_t cfg;
+} _sndProfile_t;
+
+static const _sndProfile_t _sndProfiles[] = {
+    /* name                      rate_Hz               period_frames  periods */
+    { SND_PROFILE_DEFAULT,     { SOUNDCARD_SAMPLE_RATE,    32,           128 } },
+    { SND_PROFILE_LOW_LATENCY, { SOUNDCARD_SAMPLE_RATE,   128,             3 } },
+    { SND_PROFILE_THROUGHPUT,  { SOUNDCARD_SAMPLE_RATE,  4096,             4 } },
+    { SND_PROFILE_POWER_SAVE,  { SOUNDCARD_SAMPLE_RATE, 16384,             4 } }
+};
+
+int sndGetProfile(const char *name, sndConfig_t *cfg)
+{   unsigned int i;
+
+    for(i=0; i<sizeof(_sndProfiles)/sizeof(_sndProfiles[0]); i++)
+    {   if(0 == strcmp(name, _sndProfiles[i].name))
+        {   *cfg = _sndProfiles[i].cfg;
+            return 0;
+        }
+    }
+    _errMsg("sndGetProfile: unknown profile");
+    return -1;
+}
+/*----------------------------------------------------------------*/
+
+
+
+/*********************************************************************
+Ausgabeziele ohne Soundkarte (sndSetSink), alle Plattformen.
+Die plattformabhaengigen sndOpenEx(), sndWrite() usw. geben an die
+_sndSink...() Funktionen ab, sobald psd->sink gesetzt ist.
+***********************************************************************/
+struct _sndSink {
+    int type;                   /* SND_SINK_... */
+    int frame_size_bytes;
+    unsigned int rate_Hz;
+    unsigned long lead_frames;  /* SND_SINK_NULL: so viel "Puffer" darf voraus sein */
+    double start_ms;            /* Beginn des Datenstroms, 0: noch keiner */
+    unsigned long frames;       /* Frames seit start_ms */
+    FILE *fp;                   /* SND_SINK_WAV_FILE */
+    uint32_t data_length;       /* bisher geschriebene Sounddaten in Bytes */
+    sndStats_t stats;
+    double last_write_ms;
+};
+
+/* Ausgabeziel fuer das naechste sndOpen(), siehe sndSetSink() */
+static int  _snd_sink_type = SND_SINK_DEVICE;
+static char _snd_sink_file[SND_SINK_NAME_LEN];
+
+/*************************************************/
+static double _snd_now_ms(void)
+{
+#if (PLATFORM==OS_LINUX)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+#endif
+#if (PLATFORM==OS_MS_WINDOWS)
+    LARGE_INTEGER f, t;
+
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return 1000.0 * (double)t.QuadPart / (double)f.QuadPart;
+#endif
+}
+/*************************************************/
+static void _snd_sleep_ms(double ms)
+{
+#if (PLATFORM==OS_LINUX)
+    struct timespec ts;
+
+    ts.tv_sec  = (time_t)(ms / 1000.0);
+    ts.tv_nsec = (long)((ms - ts.tv_sec * 1000.0) * 1.0e6);
+    nanosleep(&ts, NULL);
+#endif
+#if (PLATFORM==OS_MS_WINDOWS)
+    Sleep((DWORD)ms);
+#endif
+}
+/*************************************************/
+
+
+int sndSetSink(int sink, const char *filename)
+{
+    switch(sink)
+    {   case SND_SINK_DEVICE:
+        case SND_SINK_NULL:
+        case SND_SINK_NULL_FAST:
+            break;
+        case SND_SINK_WAV_FILE:
+            if((filename == NULL) || (strlen(filename) >= SND_SINK_NAME_LEN))
+            {   _errMsg("sndSetSink: missing or too long file name");
+                return -1;
+            }
+            strcpy(_snd_sink_file, filename);
+            break;
+        default:
+            _errMsg("sndSetSink: unknown sink");
+            return -1;
+    }
+    _snd_sink_type = sink;
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
+
+/* SND_SINK_NULL: warten, bis hoechstens lead_frames vorausgeschrieben sind */
+static void _sndSinkPace(struct _sndSink *ps, unsigned long lead_frames)
+{   double due_ms;
+
+    if(ps->type != SND_SINK_NULL) return;
+    if(ps->frames <= lead_frames) return;
+    due_ms = ps->start_ms + 1000.0 * (ps->frames - lead_frames) / ps->rate_Hz;
+    if(due_ms > _snd_now_ms()) _snd_sleep_ms(due_ms - _snd_now_ms());
+}
+/*----------------------------------------------------------------*/
+
+static SndDevice_t *_sndSinkOpen(int rw_mode, int mono_stereo, sndConfig_t *cfg)
+{   SndDevice_t *psd;
+    struct _sndSink *ps;
+    sndConfig_t defaultCfg;
+    sndWaveHeader_t wh;
+
+    if((mono_stereo != SND_MONO) && (mono_stereo != SND_STEREO))
+    {   _errMsg("sndOpen: use either SND_MONO or SND_STEREO");
+        return NULL;
+    }
+    if((_snd_sink_type == SND_SINK_WAV_FILE) && (rw_mode != SND_WRITE_ONLY))
+    {   _errMsg("sndOpen: a WAV file sink is SND_WRITE_ONLY");
+        return NULL;
+    }
+    if(cfg == NULL)
+    {   sndGetProfile(SND_PROFILE_DEFAULT, &defaultCfg);
+        cfg = &defaultCfg;
+    }
+
+    psd = (SndDevice_t*)calloc(1, sizeof(SndDevice_t));
+    ps  = (struct _sndSink*)calloc(1, sizeof(struct _sndSink));
+    _MyAssert((psd!=NULL) && (ps!=NULL), "sndOpen:calloc() crashed");
+
+    psd->nChannels = mono_stereo;
+    psd->rw_mode   = rw_mode;
+    psd->sink      = ps;
+    ps->type             = _snd_sink_type;
+    ps->frame_size_bytes = mono_stereo * sizeof(short);
+    ps->rate_Hz          = cfg->rate_Hz;
+    ps->lead_frames      = (unsigned long)cfg->period_frames * cfg->periods;
+
+    if(ps->type == SND_SINK_WAV_FILE)
+    {   /* Header mit Laenge 0, wird bei sndClose() nachgetragen */
+        if((NULL == (ps->fp = fopen(_snd_sink_file, "wb"))) ||
+           (0 != sndWAVInitHeader16(&wh, mono_stereo, ps->rate_Hz, 0)) ||
+           (0 != sndWAVWriteFileHeader(ps->fp, wh)))
+        {   _errMsg("sndOpen: cannot create WAV file");
+            if(ps->fp != NULL) fclose(ps->fp);
+            free(ps);
+            free(psd);
+            return NULL;
+        }
+    }
+    return psd;
+}
+/*----------------------------------------------------------------*/
+
+static SndDevice_t *_sndSinkClose(SndDevice_t *psd)
+{   struct _sndSink *ps = psd->sink;
+    sndWaveHeader_t wh;
+
+    if(ps->fp != NULL)
+    {   /* jetzt ist die Laenge bekannt */
+        sndWAVInitHeader16(&wh, psd->nChannels, ps->rate_Hz, ps->data_length);
+        if((0 != fseek(ps->fp, 0, SEEK_SET)) ||
+           (0 != sndWAVWriteFileHeader(ps->fp, wh)))
+        {   _errMsg("sndClose: cannot update WAV header");
+        }
+        fclose(ps->fp);
+    }
+    free(ps);
+    free(psd);
+    return NULL;
+}
+/*----------------------------------------------------------------*/
+
+static int _sndSinkRead(SndDevice_t *psd, short *buf, int buf_elements)
+{   struct _sndSink *ps = psd->sink;
 
- *****************************************************************/
-int sndWAVWriteSampleStereo16(FILE *fp, sndStereo16_t x)
-{   if(NULL == fp)
-    {   _errMsg("sndWAVWriteSampleStereo16, no file!");
-        return -1;
-    }
-    if(1!=fwrite(&x, sizeof(sndStereo16_t),1,fp))
-    {   _errMsg("sndWAVWriteSampleStereo16: cannot write sample");
-        return -1;
-    }
-    return 0;
+    if(ps->type == SND_SINK_WAV_FILE) return -1;
+    memset(buf, 0, buf_elements * sizeof(short));
+    if(ps->start_ms == 0.0) ps->start_ms = _snd_now_ms();
+    ps->frames += buf_elements / psd->nChannels;
+    _sndSinkPace(ps, 0);   /* Aufnahme: erst, wenn die Daten "da" sind */
+    return buf_elements;
 }
 /*----------------------------------------------------------------*/
 
-/*!
- ******************************************************************
-  @par Description:
-    Funktion liest ein 16Bit Stereo Samplepaar aus Wavedatei ein
+static int _sndSinkWrite(SndDevice_t *psd, short *buf, int buf_elements)
+{   struct _sndSink *ps = psd->sink;
+    int nFrames = buf_elements / psd->nChannels;
+    double now_ms = _snd_now_ms();
 
-  @par Used by:
+    if((ps->last_write_ms > 0.0) && (now_ms - ps->last_write_ms > ps->stats.max_stall_ms))
+        ps->stats.max_stall_ms = now_ms - ps->last_write_ms;
+    if(ps->start_ms == 0.0) ps->start_ms = now_ms;
 
-  @see
-  @arg sndWAVWriteSampleStereo16
+    if(ps->fp != NULL)
+    {   if((size_t)nFrames != fwrite(buf, ps->frame_size_bytes, nFrames, ps->fp))
+        {   _errMsg("sndWrite: cannot write WAV file");
+            return -1;
+        }
+        ps->data_length += nFrames * ps->frame_size_bytes;
+    }
+    ps->frames += nFrames;
+    ps->stats.frames_written += nFrames;
+    _sndSinkPace(ps, ps->lead_frames);
+    ps->last_write_ms = _snd_now_ms();
+    return nFrames * psd->nChannels;
+}
+/*----------------------------------------------------------------*/
 
-  @param fp - IN, Zeiger auf bereits geoffnete Datei
-  @param x - IN/OUT Zeiger auf Abtastwert
+static int _sndSinkDrain(SndDevice_t *psd)
+{   struct _sndSink *ps = psd->sink;
 
-  @retval  0: ok, -1: error
+    _sndSinkPace(ps, 0);
+    if(ps->fp != NULL) fflush(ps->fp);
+    ps->start_ms = 0.0;   /* die Pause bis zum naechsten Datenstrom */
+    ps->frames   = 0;
+    ps->last_write_ms = 0.0;
+    return 0;
+}
+/*----------------------------------------------------------------*/
 
- *****************************************************************/
-int sndWAVReadSampleStereo16(FILE *fp, sndStereo16_t *x)
-{   if(NULL == fp)
-    {   _errMsg("sndWAVReadSampleStereo16, no file!");
-        return -1;
-    }
-    if(1!=fread(x, sizeof(sndStereo16_t),1,fp))
-    {   _errMsg("sndWAVReadSampleStereo16: cannot read sample");
-        return -1;
+static int _sndSinkGetStats(SndDevice_t *psd, sndStats_t *st)
+{   struct _sndSink *ps = psd->sink;
+    double played;
+
+    *st = ps->stats;
+    st->delay_frames = 0;
+    if((ps->type == SND_SINK_NULL) && (ps->start_ms > 0.0))
+    {   played = (_snd_now_ms() - ps->start_ms) * ps->rate_Hz / 1000.0;
+        if(played < ps->frames) st->delay_frames = (long)(ps->frames - played);
     }
     return 0;
 }
@@ -1237,8 +1959,12 @@ module functions. */
 SndDevice_t *sndOpen(int rw_mode, int mono_stereo)
 {   SndDevice_t *psd;
 
+    if(_snd_sink_type != SND_SINK_DEVICE)
+        return _sndSinkOpen(rw_mode, mono_stereo, NULL);
+
     psd=(SndDevice_t*)malloc(sizeof(SndDevice_t));
     _MyAssert(psd!=NULL,"sndOpen:malloc() crashed");
+    psd->sink = NULL;
     psd->pt=(WaveInOut_t*) malloc(sizeof(WaveInOut_t));
     _MyAssert(psd->pt!=NULL,"sndOpen:malloc() crashed");
 
@@ -1263,10 +1989,29 @@ SndDevice_t *sndOpen(int rw_mode, int mono_stereo)
 }
 /*****************************************************************************/
 
+/* Windows: the rate is fixed and there are always NUM_SOUND_BUFFERS_OUT
+buffers, their size follows the block length passed to sndWrite(). So the
+period length is reported as requested. */
+SndDevice_t *sndOpenEx(int rw_mode, int mono_stereo, sndConfig_t *cfg)
+{   SndDevice_t *psd;
+
+    if(_snd_sink_type != SND_SINK_DEVICE)
+        return _sndSinkOpen(rw_mode, mono_stereo, cfg);
+
+    psd = sndOpen(rw_mode, mono_stereo);
+    if((psd != NULL) && (cfg != NULL))
+    {   cfg->rate_Hz = SOUNDCARD_SAMPLE_RATE;
+        cfg->periods = NUM_SOUND_BUFFERS_OUT;
+    }
+    return psd;
+}
+/*****************************************************************************/
+
 /* Closes the sound device (Windows: 2 devices if read/write) and frees all
 allocated memory. Return 0 for ok, negative integer on error */
 SndDevice_t *sndClose(SndDevice_t *psd)
-{   _win_sndClose(psd);
+{   if(psd->sink != NULL) return _sndSinkClose(psd);
+    _win_sndClose(psd);
     _win_sndDestructor(psd);
     free(psd->pt);
     free(psd);
@@ -1280,7 +2025,8 @@ Linux: ensure buffer size is a multiple of the sound card internal buffer size
 in order to prevent crashes!
 Returns number of (signed short) elements read or negative integer on error */
 int sndRead(SndDevice_t *psd, short *buf, int buf_elements)
-{   if(0==_win_sndRead(psd, buf, buf_elements))
+{   if(psd->sink != NULL) return _sndSinkRead(psd, buf, buf_elements);
+    if(0==_win_sndRead(psd, buf, buf_elements))
         return buf_elements;
     else
         return -1; //error
@@ -1293,7 +2039,8 @@ Linux: ensure buffer size is a multiple of the sound card internal buffer size
 in order to prevent crashes!
 Returns number of (signed short) elements written  or negative integer on error */
 int sndWrite(SndDevice_t *psd, short *buf, int buf_elements)
-{   if(TRUE==_win_sndWrite(psd, buf, buf_elements))
+{   if(psd->sink != NULL) return _sndSinkWrite(psd, buf, buf_elements);
+    if(TRUE==_win_sndWrite(psd, buf, buf_elements))
         return -1; //error
     else
         return buf_elements;
@@ -1303,6 +2050,42 @@ int sndWrite(SndDevice_t *psd, short *buf, int buf_elements)
 /*****************************************************************************/
 
 
+/* Windows: the buffers are played anyway, nothing to wait for here */
+int sndDrain(SndDevice_t *psd)
+{   if(psd->sink != NULL) return _sndSinkDrain(psd);
+    return 0;
+}
+/*****************************************************************************/
+
+/* Windows: statistics only for sndSetSink() targets */
+int sndGetStats(SndDevice_t *psd, sndStats_t *st)
+{   if(psd->sink != NULL) return _sndSinkGetStats(psd, st);
+    return -1;
+}
+/*****************************************************************************/
+
+
+/* Windows: device name is not evaluated, mmap access is not supported */
+int sndSetDevice(const char *pcm_name, int access)
+{   if(access != SND_ACCESS_RW)
+    {   _errMsg("sndSetDevice: mmap access not supported");
+        return -1;
+    }
+    return 0;
+}
+/*****************************************************************************/
+
+int sndMmapBegin(SndDevice_t *psd, short **buf, int *nFrames)
+{   return -1;  /* no mmap mode, use sndWrite() */
+}
+/*****************************************************************************/
+
+int sndMmapCommit(SndDevice_t *psd, int nFrames)
+{   return -1;
+}
+/*****************************************************************************/
+
+
 /***************************************************************
 * Windows Version of int sndWAVPlaySound(char *Filename)
 ****************************************************************/
@@ -1814,12 +2597,56 @@ Linux: /dev/dsp is the default sound device. Linux doesn't need a
 buffer size at this point.
 Returns pointer to structure containing all device info required by other module functions. */
 SndDevice_t *sndOpen(int rw_mode, int mono_stereo)
+{   return sndOpenEx(rw_mode, mono_stereo, NULL);
+}
+/******************************************************************/
+
+/*!
+ ***********************************************************************
+ * @par Description:
+ *   Stellt Laenge und Anzahl der Fragmente (= Perioden) ein. OSS kennt
+ *   nur Zweierpotenzen als Fragmentlaenge, es wird aufgerundet.
+ *   Muss vor dem Einstellen von Format und Abtastrate aufgerufen werden.
+ *
+ * @param  fd    -  IN, file descriptor des bereits geoeffneten dsp-Device
+ * @param  fragment_bytes - IN, gewuenschte Fragmentlaenge in Byte
+ * @param  nFragments - IN, gewuenschte Anzahl der Fragmente
+ *
+ * @retval 0 for ok, -1 on error
+ ********************************************************************/
+static int _sndSetDSPFragments(int fd, int fragment_bytes, int nFragments)
+{  int log2_bytes = 4;  /* Minimum 16 Byte */
+   int arg;
+
+   while(((1<<log2_bytes) < fragment_bytes) && (log2_bytes < 16))
+       log2_bytes++;
+   arg = (nFragments << 16) | log2_bytes;
+   if(ioctl(fd, SNDCTL_DSP_SETFRAGMENT, &arg) == -1) {
+      _errMsg("can't set fragment size");
+      return -1;
+   }
+   return 0;
+}
+/******************************************************************/
+
+SndDevice_t *sndOpenEx(int rw_mode, int mono_stereo, sndConfig_t *cfg)
 {   SndDevice_t *psd;
     int berror=0;
+    int frequencyHz;
+    int frame_size_bytes;
+    int blocksize;
+    audio_buf_info info;
+
+    if(_snd_sink_type != SND_SINK_DEVICE)
+        return _sndSinkOpen(rw_mode, mono_stereo, cfg);
 
     psd=(SndDevice_t*)malloc(sizeof(SndDevice_t));
     _MyAssert(psd!=NULL,"sndOpen:malloc() crashed");
 
+    psd->fd = -1;
+    psd->sink = NULL;
+    frame_size_bytes = sizeof(short) * ((mono_stereo==SND_MONO) ? 1 : 2);
+
     switch(rw_mode)
     {   case SND_READ_ONLY:     if((psd->fd = open(SOUND_DEVICE, O_RDONLY)) == -1){
                                     perror("cannot open dsp device");
@@ -1842,9 +2669,26 @@ SndDevice_t *sndOpen(int rw_mode, int mono_stereo)
                                  berror = 1;
     }
 
+    /* fragment size first, the driver ignores it after format and speed */
+    if((!berror) && (cfg!=NULL))
+    {   if(0!=_sndSetDSPFragments(psd->fd, cfg->period_frames*frame_size_bytes,
+                                  cfg->periods)){
+            perror("_sndSetDSPFragments"); berror=1;
+        }
+    }
+
     if(!berror)
-    {   if(0!=_sndSetDSPSamplingFrequency44100Hz(psd->fd)){
-            perror("_sndSetDSPSamplingFrequency44100Hz"); berror=1;
+    {   if(cfg==NULL)
+        {   if(0!=_sndSetDSPSamplingFrequency44100Hz(psd->fd)){
+                perror("_sndSetDSPSamplingFrequency44100Hz"); berror=1;
+            }
+        }
+        else
+        {   frequencyHz = cfg->rate_Hz;
+            if(ioctl(psd->fd, SNDCTL_DSP_SPEED, &frequencyHz) == -1){
+                perror("can't set sampling frequency"); berror=1;
+            }
+            cfg->rate_Hz = frequencyHz;
         }
         if(0!=_sndSetDSPAudioFormat16BitSigned(psd->fd)){
             perror("_sndSetDSPAudioFormat16BitSigned"); berror=1;
@@ -1866,8 +2710,18 @@ SndDevice_t *sndOpen(int rw_mode, int mono_stereo)
         }
     }
 
+    /* read back the negotiated fragment layout */
+    if((!berror) && (cfg!=NULL))
+    {   if(0==_sndDSPGetInternalBlockSizeInBytes(psd->fd, &blocksize))
+            cfg->period_frames = blocksize / frame_size_bytes;
+        if((rw_mode!=SND_READ_ONLY) &&
+           (ioctl(psd->fd, SNDCTL_DSP_GETOSPACE, &info) != -1))
+            cfg->periods = info.fragstotal;
+    }
+
     if(berror)
     {   perror("sndOpen has crashed!");
+        if(psd->fd != -1) close(psd->fd);
         free(psd);
         return NULL;
     }
@@ -1878,7 +2732,8 @@ SndDevice_t *sndOpen(int rw_mode, int mono_stereo)
 /* Closes the sound device  and frees all
 allocated memory. Return 0 for ok, negative integer on error */
 SndDevice_t *sndClose(SndDevice_t *psd)
-{   if(psd!=NULL)
+{   if((psd!=NULL) && (psd->sink!=NULL)) return _sndSinkClose(psd);
+    if(psd!=NULL)
     {   close(psd->fd);
         free(psd);
     }
@@ -1892,7 +2747,8 @@ SndDevice_t *sndClose(SndDevice_t *psd)
    Returns number of (signed short) elements read or negative integer
    on error */
 int sndRead(SndDevice_t *psd, short *buf, int buf_elements)
-{   if(0!=_sndDSPReadBytes(psd->fd, (char *)buf, sizeof(short)*buf_elements))
+{   if(psd->sink != NULL) return _sndSinkRead(psd, buf, buf_elements);
+    if(0!=_sndDSPReadBytes(psd->fd, (char *)buf, sizeof(short)*buf_elements))
     {   perror("_sndDSPReadBytes has crashed...");
         return -1; //error
     }
@@ -1907,7 +2763,8 @@ int sndRead(SndDevice_t *psd, short *buf, int buf_elements)
    Returns number of (signed short) elements written or negative integer
    on error */
 int sndWrite(SndDevice_t *psd, short *buf, int buf_elements)
-{   if(0!=_sndDSPWriteBytes(psd->fd, (char *)buf, sizeof(short)*buf_elements))
+{   if(psd->sink != NULL) return _sndSinkWrite(psd, buf, buf_elements);
+    if(0!=_sndDSPWriteBytes(psd->fd, (char *)buf, sizeof(short)*buf_elements))
     {   perror("sndWrite: can't play audio data");
         return buf_elements;
     }
@@ -1918,6 +2775,46 @@ int sndWrite(SndDevice_t *psd, short *buf, int buf_elements)
 /*----------------------------------------------------------------*/
 
 
+/* OSS: wait until everything is played */
+int sndDrain(SndDevice_t *psd)
+{   if(psd->sink != NULL) return _sndSinkDrain(psd);
+    if(ioctl(psd->fd, SNDCTL_DSP_SYNC, 0) == -1)
+    {   perror("sndDrain: SNDCTL_DSP_SYNC");
+        return -1;
+    }
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
+/* OSS: statistics only for sndSetSink() targets */
+int sndGetStats(SndDevice_t *psd, sndStats_t *st)
+{   if(psd->sink != NULL) return _sndSinkGetStats(psd, st);
+    return -1;
+}
+/*----------------------------------------------------------------*/
+
+
+/* OSS: device is always SOUND_DEVICE, mmap access is not supported */
+int sndSetDevice(const char *pcm_name, int access)
+{   if(access != SND_ACCESS_RW)
+    {   _errMsg("sndSetDevice: mmap access not supported");
+        return -1;
+    }
+    return 0;
+}
+/*----------------------------------------------------------------*/
+
+int sndMmapBegin(SndDevice_t *psd, short **buf, int *nFrames)
+{   return -1;  /* no mmap mode, use sndWrite() */
+}
+/*----------------------------------------------------------------*/
+
+int sndMmapCommit(SndDevice_t *psd, int nFrames)
+{   return -1;
+}
+/*----------------------------------------------------------------*/
+
+
 /***************************************************************
 * Linux OSS Version of int sndWAVPlaySound(char *Filename)
 ****************************************************************/
@@ -1963,7 +2860,7 @@ int sndWAVPlaySound(char *Filename)
      if(0!=WaveFileDataSizeBytes % DspBlockSizeBytes) n=n+1;
      WaveDspSizeBytes = n*DspBlockSizeBytes;
 #if 0
-    printf("wh.data_length:%lu\n", wh.data_length);
+    printf("wh.data_length:%lu\n", (unsigned long)wh.data_length);
     printf("DspBlockSizeBytes:%d\n", DspBlockSizeBytes);
     printf("WaveFileDataSizeBytes:%d\n", WaveFileDataSizeBytes);
     printf("WaveDspSizeBytes:%d\n", WaveDspSizeBytes);
@@ -2098,6 +2995,9 @@ linker: libasound, libm, maybe needs: libdl for function dlopen()
             -----
 */
 
+#include <errno.h>
+#include <poll.h>    /* non-blocking playback, _snd_pcm_wait_writable */
+
 
 /*----------------------------------------------------------------*/
 /***************************************************************/
@@ -2107,28 +3007,55 @@ static int _snd_pcm_open_capture(SndDevice_t *psd);
 static int _snd_pcm_open_playback(SndDevice_t *psd);
 
 static int _snd_pcm_set_parameters(SndDevice_t *psd, snd_pcm_t *handle,
-            int mono_stereo, int sampleFrequencyHz);
+            int mono_stereo, sndConfig_t *cfg);
 
-static int _snd_pcm_write_bytes(snd_pcm_t *handle, char *buf, int buf_len_bytes, int frame_size_bytes);
+static int _snd_pcm_write_bytes(SndDevice_t *psd, char *buf, int buf_len_bytes);
+static int _snd_pcm_wait_writable(SndDevice_t *psd);
+static int _snd_pcm_xrun_recover(SndDevice_t *psd, int err);
+static void _snd_pcm_note_stall(SndDevice_t *psd);
 static int _snd_pcm_read_bytes(snd_pcm_t *handle, char* buf, int buf_len_bytes, int frame_size_bytes);
 
 static int _snd_pcm_getInternalBlockSizeInBytes(SndDevice_t *psd);
 
+static int _snd_pcm_open(snd_pcm_t **handle, snd_pcm_stream_t stream, int mode);
+
 /***************************************************************/
 /*************** end of private prototypes *********************/
 /***************************************************************/
 
 
+#define SND_MAX_POLL_FDS  8      /* poll descriptors of one PCM, plugins may use more than one */
+#define SND_POLL_TIMEOUT_MS 1000 /* the device is stuck if it doesn't wake us up within this time */
+#define SND_SILENCE_FRAMES 256   /* chunk size for the silence prefill */
+
+/* device and access mode for the next sndOpen(), see sndSetDevice() */
+static char _snd_pcm_name[SND_DEVICE_NAME_LEN] = "default";
+static int  _snd_access = SND_ACCESS_RW;
+
 
 /***************************************************************/
 /*************** implementation of private functions ***********/
 /***************************************************************/
+/* open the selected PCM. If that fails, fall back to the "null" */
+/* PCM, so the program runs without sound hardware, too.           */
+static int _snd_pcm_open(snd_pcm_t **handle, snd_pcm_stream_t stream, int mode)
+{   int rc;
+
+    rc = snd_pcm_open(handle, _snd_pcm_name, stream, mode);
+    if ((rc < 0) && (0 != strcmp(_snd_pcm_name, "null")))
+    {   fprintf(stderr, "cannot open PCM \"%s\": %s\n"
+                        "==> Using PCM \"null\" instead.\n",
+                _snd_pcm_name, snd_strerror(rc));
+        rc = snd_pcm_open(handle, "null", stream, mode);
+    }
+    return rc;
+}
+/*-------------------------------------------------------------*/
 static int _snd_pcm_open_capture(SndDevice_t *psd)
 {   int rc;
 
     /* open in blocking mode */
-    rc = snd_pcm_open(&(psd->pcm_handle_capture),
-         "default", SND_PCM_STREAM_CAPTURE, 0);
+    rc = _snd_pcm_open(&(psd->pcm_handle_capture), SND_PCM_STREAM_CAPTURE, 0);
     if (rc < 0)
     {   perror("cannot open dsp capture device");
         return -1;
@@ -2139,9 +3066,9 @@ static int _snd_pcm_open_capture(SndDevice_t *psd)
 static int _snd_pcm_open_playback(SndDevice_t *psd)
 {   int rc;
 
-    /* Open PCM device for playback, blocking mode. */
-    rc = snd_pcm_open(&(psd->pcm_handle_playback),
-         "default", SND_PCM_STREAM_PLAYBACK, 0);
+    /* Open PCM device for playback, non-blocking mode: sndWrite() */
+    /* waits in poll() and so notices underruns at once.           */
+    rc = _snd_pcm_open(&(psd->pcm_handle_playback), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
     if (rc < 0)
     {   perror("cannot open dsp playback device");
         return -1;
@@ -2150,20 +3077,21 @@ static int _snd_pcm_open_playback(SndDevice_t *psd)
 }
 /*-------------------------------------------------------------*/
 static int _snd_pcm_set_parameters(SndDevice_t *psd, snd_pcm_t *handle,
-           int mono_stereo, int sampleFrequencyHz)
+           int mono_stereo, sndConfig_t *cfg)
 {   /* This structure contains information about    */
     /* the hardware and can be used to specify the  */
     /* configuration to be used for the PCM stream. */
     snd_pcm_hw_params_t *hwparams;
-    unsigned int rate = sampleFrequencyHz; /* Sample rate */
+    unsigned int rate = cfg->rate_Hz; /* Sample rate */
     unsigned int exact_rate;   /* Sample rate returned by */
                                /* snd_pcm_hw_params_set_rate_near */
     int nchannels;
     snd_pcm_uframes_t frames;
+    unsigned int periods;
     int frame_size_bytes;
     int dir;
-    snd_pcm_uframes_t buffer_size_frames;
     snd_pcm_uframes_t exact_buffer_size_frames;
+    int use_mmap;
 
 
     /* Allocate the snd_pcm_hw_params_t structure  */
@@ -2175,10 +3103,21 @@ static int _snd_pcm_set_parameters(SndDevice_t *psd, snd_pcm_t *handle,
       return(-1);
     }
 
-    /* Set access type. This can be either    */
-    /* SND_PCM_ACCESS_RW_INTERLEAVED or       */
-    /* SND_PCM_ACCESS_RW_NONINTERLEAVED.      */
-    if (snd_pcm_hw_params_set_access(handle, hwparams, SND_PCM_ACCESS_RW_INTERLEAVED) < 0) {
+    /* Set access type. Playback may use the sound card's ring    */
+    /* buffer directly (SND_PCM_ACCESS_MMAP_INTERLEAVED) if asked  */
+    /* for by sndSetDevice(), otherwise and as a fallback the data */
+    /* is copied (SND_PCM_ACCESS_RW_INTERLEAVED).                  */
+    use_mmap = 0;
+    if ((_snd_access == SND_ACCESS_MMAP) && (handle == psd->pcm_handle_playback)) {
+      if (snd_pcm_hw_params_set_access(handle, hwparams, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0) {
+        use_mmap = 1;
+      } else {
+        fprintf(stderr, "mmap access is not supported by this PCM device.\n"
+                        "==> Using read/write access instead.\n");
+      }
+    }
+    if ((!use_mmap) &&
+        (snd_pcm_hw_params_set_access(handle, hwparams, SND_PCM_ACCESS_RW_INTERLEAVED) < 0)) {
       fprintf(stderr, "Error setting access.\n");
       return(-1);
     }
@@ -2219,34 +3158,32 @@ static int _snd_pcm_set_parameters(SndDevice_t *psd, snd_pcm_t *handle,
     /* One frame is the sample data vector for all channels. */
     /* For 16 Bit stereo data, one frame has a length of four bytes. */
     frame_size_bytes = sizeof(short)*nchannels;
-    buffer_size_frames = SND_BUFFER_SIZE_BYTE / frame_size_bytes;
-    DebugCode(printf("Debugging: frame size:%d bytes buffer size:%d bytes\n",
-              (int)frame_size_bytes, (int)buffer_size_frames););
+    DebugCode(printf("Debugging: frame size:%d bytes period:%u frames x %u\n",
+              (int)frame_size_bytes, cfg->period_frames, cfg->periods););
 
     if (snd_pcm_hw_params_set_channels(handle, hwparams, nchannels) < 0) {
       fprintf(stderr, "Error setting channels.\n");
       return(-1);
     }
 
-    /* Set period size to 32 frames. */
-    frames = 32;
-    snd_pcm_hw_params_set_period_size_near(handle, hwparams, &frames, &dir);
-
+    /* Set period size, the sound card wakes us up once per period. */
+    frames = cfg->period_frames;
+    dir = 0;
+    if (snd_pcm_hw_params_set_period_size_near(handle, hwparams, &frames, &dir) < 0) {
+      fprintf(stderr, "Error setting period size.\n");
+      return(-1);
+    }
     DebugCode(printf("Debugging: frames:%d dir:%d\n", (int)frames, dir););
 
 
-    /* Set buffer size (in frames). The resulting latency is given by */
-    /* latency = periodsize * periods / (rate * bytes_per_frame)     */
-    exact_buffer_size_frames = buffer_size_frames;
-    if (snd_pcm_hw_params_set_buffer_size_near(handle, hwparams, &exact_buffer_size_frames) < 0) {
-      fprintf(stderr, "Error setting buffersize.\n");
+    /* Set number of periods. The resulting latency is given by */
+    /* latency = periodsize * periods / rate                    */
+    periods = cfg->periods;
+    dir = 0;
+    if (snd_pcm_hw_params_set_periods_near(handle, hwparams, &periods, &dir) < 0) {
+      fprintf(stderr, "Error setting periods.\n");
       return(-1);
     }
-    if (buffer_size_frames != exact_buffer_size_frames) {
-      fprintf(stderr, "The buffer size %d frames is not supported by your hardware.\n"
-                      "==> Using %d frames instead.\n", (int)buffer_size_frames, (int)exact_buffer_size_frames);
-    }
-    DebugCode(printf("Debugging: buffer size:%d frames\n", (int)exact_buffer_size_frames););
 
 
     /* Apply HW parameter settings to */
@@ -2256,10 +3193,26 @@ static int _snd_pcm_set_parameters(SndDevice_t *psd, snd_pcm_t *handle,
       return(-1);
     }
 
+    /* read back what the hardware has accepted */
+    snd_pcm_hw_params_get_period_size(hwparams, &frames, &dir);
+    snd_pcm_hw_params_get_periods(hwparams, &periods, &dir);
+    snd_pcm_hw_params_get_buffer_size(hwparams, &exact_buffer_size_frames);
+    if ((frames != cfg->period_frames) || (periods != cfg->periods)) {
+      fprintf(stderr, "%u frames x %u periods are not supported by your hardware.\n"
+                      "==> Using %d frames x %u periods instead.\n",
+                      cfg->period_frames, cfg->periods, (int)frames, periods);
+    }
+    DebugCode(printf("Debugging: buffer size:%d frames\n", (int)exact_buffer_size_frames););
+    cfg->rate_Hz       = exact_rate;
+    cfg->period_frames = (unsigned int)frames;
+    cfg->periods       = periods;
+
     /* write exact parameters to device structure */
-    psd->buffer_size_frames = buffer_size_frames;
+    psd->buffer_size_frames = exact_buffer_size_frames;
+    psd->period_frames = frames;
     psd->nChannels = nchannels;
     psd->frame_size_bytes = frame_size_bytes;
+    if (handle == psd->pcm_handle_playback) psd->use_mmap = use_mmap;
 
 
     return 0;
@@ -2270,37 +3223,133 @@ static int _snd_pcm_set_parameters(SndDevice_t *psd, snd_pcm_t *handle,
 
 /*-------------------------------------------------------------*/
 
-static int _snd_pcm_write_bytes(snd_pcm_t *handle, char *buf, int buf_len_bytes, int frame_size_bytes)
+static int _snd_pcm_write_bytes(SndDevice_t *psd, char *buf, int buf_len_bytes)
 {
-    int num_frames, frames_written, bytes_written;
+    snd_pcm_t *handle = psd->pcm_handle_playback;
+    int frame_size_bytes = psd->frame_size_bytes;
+    int num_frames, frames_written;
+    snd_pcm_sframes_t rc;
 
     /* we only use 16 bit data. One frame is the sample data vector for all channels. */
     /* For 16 Bit stereo data, one frame has a length of four bytes. */
     num_frames = buf_len_bytes / frame_size_bytes;
-
-    /* Write num_frames frames from buffer data to    */
-    /* the PCM device pointed to by pcm_handle.       */
-    /* Returns the number of frames actually written. */
-    frames_written = snd_pcm_writei(handle, buf, num_frames);
-    if(frames_written == -EPIPE)
-    {   /* EPIPE means underrun */
-        fprintf(stderr, "underrun occurred\n");
-        snd_pcm_prepare(handle);
+    _snd_pcm_note_stall(psd);
+
+    /* Write num_frames frames from buffer data to the PCM   */
+    /* device. The device is non-blocking: write what fits,  */
+    /* then wait in poll() until the next period is free.    */
+    frames_written = 0;
+    while (frames_written < num_frames)
+    {   if (psd->use_mmap)
+            rc = snd_pcm_mmap_writei(handle, buf + frames_written*frame_size_bytes,
+                                     num_frames - frames_written);
+        else
+            rc = snd_pcm_writei(handle, buf + frames_written*frame_size_bytes,
+                                num_frames - frames_written);
+        if (rc > 0)
+        {   frames_written += rc;
+            continue;
+        }
+        if ((rc == 0) || (rc == -EAGAIN))
+            rc = _snd_pcm_wait_writable(psd);
+        if ((rc == -EPIPE) || (rc == -ESTRPIPE))
+        {   /* EPIPE means underrun, ESTRPIPE suspend */
+            rc = _snd_pcm_xrun_recover(psd, (int)rc);
+        }
+        if (rc < 0)
+        {   fprintf(stderr, "error from snd_pcm_writei: %s\n", snd_strerror((int)rc));
+            break;
+        }
     }
-    else
-    {   if (frames_written < 0)
-        {   fprintf(stderr, "error from snd_pcm_writei: %s\n", snd_strerror(frames_written));
+    psd->stats.frames_written += frames_written;
+    psd->last_write_ms = _snd_now_ms();
+
+    return frames_written * frame_size_bytes;
+}
+/*-------------------------------------------------------------*/
+/* wait until at least one period can be written.              */
+/* Returns 0 or a negative ALSA error code (-EPIPE on underrun) */
+static int _snd_pcm_wait_writable(SndDevice_t *psd)
+{
+    snd_pcm_t *handle = psd->pcm_handle_playback;
+    struct pollfd fds[SND_MAX_POLL_FDS];
+    unsigned short revents;
+    int nfds, rc;
+
+    /* buffer full, but not yet running: the start threshold */
+    /* is not reached by mmap_commit, so start by hand        */
+    if (snd_pcm_state(handle) == SND_PCM_STATE_PREPARED)
+    {   rc = snd_pcm_start(handle);
+        if (rc < 0) return rc;
+    }
+
+    nfds = snd_pcm_poll_descriptors_count(handle);
+    if ((nfds <= 0) || (nfds > SND_MAX_POLL_FDS))
+    {   /* unusual plugin, let ALSA do the polling */
+        rc = snd_pcm_wait(handle, SND_POLL_TIMEOUT_MS);
+        return (rc < 0) ? rc : 0;
+    }
+    snd_pcm_poll_descriptors(handle, fds, nfds);
+
+    for (;;)
+    {   rc = poll(fds, nfds, SND_POLL_TIMEOUT_MS);
+        if (rc < 0)
+        {   if (errno == EINTR) continue;
+            return -errno;
         }
-        else
-        {   if(frames_written != num_frames)
-            {   fprintf(stderr, "short write, write %d frames\n", frames_written);
-            }
+        if (rc == 0)
+        {   fprintf(stderr, "playback device does not respond\n");
+            return -EIO;
+        }
+        snd_pcm_poll_descriptors_revents(handle, fds, nfds, &revents);
+        if (revents & POLLERR)
+        {   return (snd_pcm_state(handle) == SND_PCM_STATE_SUSPENDED) ? -ESTRPIPE : -EPIPE;
         }
+        if (revents & POLLOUT) return 0;
+    }
+}
+/*-------------------------------------------------------------*/
+/* count the underrun, restart the device and prefill one      */
+/* period of silence, so it doesn't run dry again at once      */
+static int _snd_pcm_xrun_recover(SndDevice_t *psd, int err)
+{
+    static short silence[2*SND_SILENCE_FRAMES]; /* zero, stereo */
+    snd_pcm_t *handle = psd->pcm_handle_playback;
+    snd_pcm_sframes_t rc;
+    int frames, n;
+
+    psd->stats.xruns++;
+    DebugCode(fprintf(stderr, "underrun occurred\n"););
+    if (snd_pcm_recover(handle, err, 1) < 0)
+    {   fprintf(stderr, "cannot recover from underrun: %s\n", snd_strerror(err));
+        return err;
+    }
+
+    /* at least one period must stay free for the real data */
+    frames = psd->period_frames;
+    if (frames > psd->buffer_size_frames - psd->period_frames)
+        frames = psd->buffer_size_frames - psd->period_frames;
+    while (frames > 0)
+    {   n = (frames > SND_SILENCE_FRAMES) ? SND_SILENCE_FRAMES : frames;
+        if (psd->use_mmap) rc = snd_pcm_mmap_writei(handle, silence, n);
+        else               rc = snd_pcm_writei(handle, silence, n);
+        if (rc <= 0) break;
+        frames -= rc;
+        psd->stats.silence_frames += rc;
     }
-    bytes_written = frames_written * frame_size_bytes;
+    return 0;
+}
+/*-------------------------------------------------------------*/
+/* time since the last write is the time the caller was busy   */
+static void _snd_pcm_note_stall(SndDevice_t *psd)
+{   double stall_ms;
 
-    return bytes_written;
+    if (psd->last_write_ms > 0.0)
+    {   stall_ms = _snd_now_ms() - psd->last_write_ms;
+        if (stall_ms > psd->stats.max_stall_ms) psd->stats.max_stall_ms = stall_ms;
+    }
 }
+
 /*-------------------------------------------------------------*/
 static int _snd_pcm_read_bytes(snd_pcm_t *handle, char* buf, int buf_len_bytes, int frame_size_bytes)
 {
@@ -2348,10 +3397,27 @@ static int _snd_pcm_getInternalBlockSizeInBytes(SndDevice_t *psd)
 /*---------------- public, exported functions --------------------*/
 
 SndDevice_t *sndOpen(int rw_mode, int mono_stereo)
+{
+    return sndOpenEx(rw_mode, mono_stereo, NULL);
+}
+
+
+/*------------------------------------------------------------------*/
+
+SndDevice_t *sndOpenEx(int rw_mode, int mono_stereo, sndConfig_t *cfg)
 {
     SndDevice_t *psd;
+    sndConfig_t defaultCfg;
     int berror=0;
 
+    if(_snd_sink_type != SND_SINK_DEVICE)
+        return _sndSinkOpen(rw_mode, mono_stereo, cfg);
+
+    if(cfg == NULL)
+    {   sndGetProfile(SND_PROFILE_DEFAULT, &defaultCfg);
+        cfg = &defaultCfg;
+    }
+
     psd=(SndDevice_t*)malloc(sizeof(SndDevice_t));
     _MyAssert(psd!=NULL,"sndOpen:malloc() crashed");
 
@@ -2359,6 +3425,12 @@ SndDevice_t *sndOpen(int rw_mode, int mono_stereo)
     psd->pcm_handle_capture  = NULL;
     psd->pcm_handle_playback = NULL;
     psd->rw_mode             = rw_mode;
+    psd->use_mmap            = 0;
+    psd->mmap_offset         = 0;
+    psd->period_frames       = 0;
+    psd->last_write_ms       = 0.0;
+    memset(&psd->stats, 0, sizeof(psd->stats));
+    psd->sink                = NULL;
 
     switch(rw_mode)
     {   case SND_READ_ONLY:
@@ -2386,12 +3458,12 @@ SndDevice_t *sndOpen(int rw_mode, int mono_stereo)
 
     /* set hardware parameters of used devices (handle !=NULL)*/
     if((!berror) && (psd->pcm_handle_capture!=NULL))
-    {   if(0!=_snd_pcm_set_parameters(psd, psd->pcm_handle_capture, mono_stereo, SOUNDCARD_SAMPLE_RATE))
+    {   if(0!=_snd_pcm_set_parameters(psd, psd->pcm_handle_capture, mono_stereo, cfg))
         {   berror = 1; }
     }
 
     if((!berror) && (psd->pcm_handle_playback!=NULL))
-    {   if(0!=_snd_pcm_set_parameters(psd, psd->pcm_handle_playback, mono_stereo, SOUNDCARD_SAMPLE_RATE))
+    {   if(0!=_snd_pcm_set_parameters(psd, psd->pcm_handle_playback, mono_stereo, cfg))
         {   berror = 1; }
     }
 
@@ -2408,6 +3480,7 @@ SndDevice_t *sndOpen(int rw_mode, int mono_stereo)
 
 SndDevice_t *sndClose(SndDevice_t *psd)
 {
+    if(psd->sink != NULL) return _sndSinkClose(psd);
 
     /* close the used devices (handle !=NULL)*/
     if(psd->pcm_handle_capture != NULL)
@@ -2415,7 +3488,8 @@ SndDevice_t *sndClose(SndDevice_t *psd)
         snd_pcm_close(psd->pcm_handle_capture);
     }
     if(psd->pcm_handle_playback != NULL)
-    {   snd_pcm_drain(psd->pcm_handle_playback);
+    {   snd_pcm_nonblock(psd->pcm_handle_playback, 0); /* drain must wait */
+        snd_pcm_drain(psd->pcm_handle_playback);
         snd_pcm_close(psd->pcm_handle_playback);
     }
     /* free memory, if allocated */
@@ -2434,6 +3508,7 @@ int sndRead(SndDevice_t *psd, short *buf, int buf_elements)
 {
     int rc;
 
+    if(psd->sink != NULL) return _sndSinkRead(psd, buf, buf_elements);
     _MyAssert(psd->pcm_handle_capture != NULL, "capture device not initialized!");
 
     rc = _snd_pcm_read_bytes(psd->pcm_handle_capture,
@@ -2454,12 +3529,10 @@ int sndWrite(SndDevice_t *psd, short *buf, int buf_elements)
 {
     int rc;
 
+    if(psd->sink != NULL) return _sndSinkWrite(psd, buf, buf_elements);
     _MyAssert(psd->pcm_handle_playback != NULL, "playback device not initialized!");
 
-    rc = _snd_pcm_write_bytes(psd->pcm_handle_playback,
-                             (char *) buf,
-                              buf_elements*sizeof(short),
-                              psd->frame_size_bytes);
+    rc = _snd_pcm_write_bytes(psd, (char *) buf, buf_elements*sizeof(short));
     if(rc<0) return -1;
 
     return (rc / sizeof(short));
@@ -2470,6 +3543,148 @@ int sndWrite(SndDevice_t *psd, short *buf, int buf_elements)
 
 
 
+int sndDrain(SndDevice_t *psd)
+{
+    snd_pcm_t *handle = psd->pcm_handle_playback;
+    int rc;
+
+    if (psd->sink != NULL) return _sndSinkDrain(psd);
+    if (handle == NULL) return -1;
+
+    /* blocking drain, then ready for the next stream */
+    snd_pcm_nonblock(handle, 0);
+    rc = snd_pcm_drain(handle);
+    snd_pcm_nonblock(handle, 1);
+    if (rc < 0)
+    {   fprintf(stderr, "error from snd_pcm_drain: %s\n", snd_strerror(rc));
+    }
+    if (snd_pcm_prepare(handle) < 0) return -1;
+    psd->last_write_ms = 0.0;   /* the pause is not a stall */
+    return 0;
+}
+
+
+/*------------------------------------------------------------------*/
+
+
+
+int sndGetStats(SndDevice_t *psd, sndStats_t *st)
+{
+    snd_pcm_sframes_t delay;
+
+    if (psd->sink != NULL) return _sndSinkGetStats(psd, st);
+    if (psd->pcm_handle_playback == NULL) return -1;
+
+    *st = psd->stats;
+    if (snd_pcm_delay(psd->pcm_handle_playback, &delay) == 0)
+        st->delay_frames = delay;
+    else
+        st->delay_frames = 0;   /* not running or underrun */
+    return 0;
+}
+
+
+/*------------------------------------------------------------------*/
+
+
+
+int sndSetDevice(const char *pcm_name, int access)
+{
+    if ((access != SND_ACCESS_RW) && (access != SND_ACCESS_MMAP))
+    {   _errMsg("sndSetDevice: use either SND_ACCESS_RW or SND_ACCESS_MMAP");
+        return -1;
+    }
+    if (pcm_name != NULL)
+    {   if (strlen(pcm_name) >= SND_DEVICE_NAME_LEN)
+        {   _errMsg("sndSetDevice: device name too long");
+            return -1;
+        }
+        strcpy(_snd_pcm_name, pcm_name);
+    }
+    _snd_access = access;
+    return 0;
+}
+
+
+/*------------------------------------------------------------------*/
+
+
+
+int sndMmapBegin(SndDevice_t *psd, short **buf, int *nFrames)
+{
+    snd_pcm_t *handle = psd->pcm_handle_playback;
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset, frames;
+    snd_pcm_sframes_t avail;
+    int rc;
+
+    if ((handle == NULL) || (!psd->use_mmap) || (*nFrames <= 0)) return -1;
+    _snd_pcm_note_stall(psd);
+
+    for (;;)
+    {   avail = snd_pcm_avail_update(handle);
+        if (avail < 0)
+        {   /* underrun: prepare again and refill */
+            if (_snd_pcm_xrun_recover(psd, (int)avail) < 0) return -1;
+            continue;
+        }
+        if (avail > 0) break;
+
+        /* ring buffer full: wait for the next period */
+        rc = _snd_pcm_wait_writable(psd);
+        if ((rc == -EPIPE) || (rc == -ESTRPIPE))
+            rc = _snd_pcm_xrun_recover(psd, rc);
+        if (rc < 0) return -1;
+    }
+
+    frames = *nFrames;
+    if ((snd_pcm_uframes_t)avail < frames) frames = avail;
+    rc = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+    if (rc < 0)
+    {   fprintf(stderr, "error from snd_pcm_mmap_begin: %s\n", snd_strerror(rc));
+        return -1;
+    }
+
+    /* interleaved: all channels share one area, step is one frame */
+    *buf = (short *)((char *)areas[0].addr + areas[0].first / 8 + offset * areas[0].step / 8);
+    *nFrames = (int)frames;
+    psd->mmap_offset = offset;
+    return 0;
+}
+
+
+/*------------------------------------------------------------------*/
+
+
+
+int sndMmapCommit(SndDevice_t *psd, int nFrames)
+{
+    snd_pcm_t *handle = psd->pcm_handle_playback;
+    snd_pcm_sframes_t rc;
+
+    if ((handle == NULL) || (!psd->use_mmap)) return -1;
+
+    rc = snd_pcm_mmap_commit(handle, psd->mmap_offset, nFrames);
+    if ((rc < 0) || (rc != nFrames))
+    {   if (_snd_pcm_xrun_recover(psd, rc < 0 ? (int)rc : -EPIPE) < 0) return -1;
+    }
+    else
+    {   psd->stats.frames_written += nFrames;
+    }
+    psd->last_write_ms = _snd_now_ms();
+    /* buffer full: start playback (start threshold may not be reached otherwise) */
+    if ((snd_pcm_state(handle) == SND_PCM_STATE_PREPARED) &&
+        (snd_pcm_avail_update(handle) == 0))
+    {   snd_pcm_start(handle);
+    }
+    return 0;
+}
+
+
+/*------------------------------------------------------------------*/
+
+
+
 /***************************************************************/
 /***************************************************************/
 /***************************************************************/
@@ -2497,6 +3712,9 @@ int sndWAVPlaySound(char *Filename)
     int ok=1;
     int is16BitMono, is16BitStereo;
     int i;
+    short *area;       /* mmap-Modus: Zeiger in den Ringpuffer */
+    int frames, got;
+    sndConfig_t cfg;
 
 
     if((fp=fopen(Filename, "rb")) == NULL)
@@ -2512,7 +3730,7 @@ int sndWAVPlaySound(char *Filename)
     DebugCode(printf("Info: format:%d\n",wh.format););
     DebugCode(printf("Info: channels:%d\n",wh.nChannels););
     DebugCode(printf("Info: nBytesPerSample:%d\n",wh.nBytesPerSample););
-    DebugCode(printf("Info: nSamplesPerSec:%lu\n",wh.nSamplesPerSec););
+    DebugCode(printf("Info: nSamplesPerSec:%lu\n",(unsigned long)wh.nSamplesPerSec););
     ok = 1;
     if(wh.format != 1)
     {   ok = 0; /* only PCM */
@@ -2548,15 +3766,23 @@ int sndWAVPlaySound(char *Filename)
     psd->pcm_handle_capture  = NULL;
     psd->pcm_handle_playback = NULL;
     psd->rw_mode             = SND_WRITE_ONLY;
+    psd->use_mmap            = 0;
+    psd->mmap_offset         = 0;
+    psd->period_frames       = 0;
+    psd->last_write_ms       = 0.0;
+    memset(&psd->stats, 0, sizeof(psd->stats));
+    psd->sink                = NULL;
 
     if(0!= _snd_pcm_open_playback(psd) )
     {   ok = 0;
     }
     DebugCode(printf("Info: device opened for playback, configure...\n"););
 
+    sndGetProfile(SND_PROFILE_DEFAULT, &cfg);
+    cfg.rate_Hz = wh.nSamplesPerSec;
     if((ok) && (psd->pcm_handle_playback!=NULL))
     {   if(0!=_snd_pcm_set_parameters(psd, psd->pcm_handle_playback,
-              psd->nChannels, wh.nSamplesPerSec))
+              psd->nChannels, &cfg))
         {   ok=0; }
     }
     DebugCode(printf("Info: device configured\n"););
@@ -2582,11 +3808,28 @@ int sndWAVPlaySound(char *Filename)
     memset(buf,0,buf_size); /* erase buffer */
 
     i=0;
+    /* mmap-Modus: direkt aus der Datei in den Ringpuffer lesen, ohne buf */
+    while(ok && psd->use_mmap)
+    {   frames = buf_size / psd->frame_size_bytes;
+        if(0 != sndMmapBegin(psd, &area, &frames))
+        {   ok=0;
+            _errMsg("sndWAVPlaySound: cannot write to sound device!");
+            break;
+        }
+        got = fread(area, psd->frame_size_bytes, frames, fp);
+        if(got == 0)
+        {   sndMmapCommit(psd, 0);  /* Bereich zurueckgeben, nichts spielen */
+            break;                  /* Dateiende */
+        }
+        if(0 != sndMmapCommit(psd, got))
+        {   ok=0;
+        }
+        if(got < frames) break;  /* Dateiende */
+        i++;
+    }
     /* lesen aus der Datei und schreiben auf die Soundkarte */
-    while(ok && (buf_size == fread(buf,sizeof(char),buf_size,fp)))
-    {   if(buf_size != _snd_pcm_write_bytes(psd->pcm_handle_playback,
-                                           (char *) buf, buf_size,
-                                            psd->frame_size_bytes))
+    while(ok && (!psd->use_mmap) && (buf_size == fread(buf,sizeof(char),buf_size,fp)))
+    {   if(buf_size != _snd_pcm_write_bytes(psd, (char *) buf, buf_size))
         {   ok=0;
             _errMsg("sndWAVPlaySound: cannot write to sound device!");
         }
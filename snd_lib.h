@@ -98,18 +98,58 @@
   #include <mmsystem.h>
 #endif
 
+#include <stdint.h>  /* feste Feldbreiten fuer WAV-Header, auch unter LP64 */
+
 /* ----------------public, exported defines -------------------- */
 #define SND_READ_ONLY   0   /*! Arbeitsmodus der Soundkarte: nur Aufnahme */
 #define SND_WRITE_ONLY  1   /*! Arbeitsmodus der Soundkarte: nur Wiedergabe */
 #define SND_READ_WRITE  2   /*! Voll-Duplex Modus: Aufnahme und Wiedergabe gleichzeitig */
 #define SND_MONO        1   /* don't change! Anzahl der Kanaele, Mono */
 #define SND_STEREO      2   /* don't change! Anzahl der Kanaele, Stereo */
+#define SND_ACCESS_RW   0   /*! Zugriff ueber sndWrite(), Daten werden kopiert */
+#define SND_ACCESS_MMAP 1   /*! zusaetzlich direkter Zugriff auf den Ringpuffer
+                                der Soundkarte, siehe sndMmapBegin() */
+#define SND_DEVICE_NAME_LEN 64  /*! max. Laenge des Geraetenamens */
+
+/* Ausgabeziele fuer sndSetSink() */
+#define SND_SINK_DEVICE    0  /*! Soundkarte (Voreinstellung) */
+#define SND_SINK_NULL      1  /*! verwirft die Daten im Takt der Abtastrate */
+#define SND_SINK_NULL_FAST 2  /*! verwirft die Daten sofort, so schnell es geht */
+#define SND_SINK_WAV_FILE  3  /*! schreibt den Datenstrom in eine WAV-Datei */
+#define SND_SINK_NAME_LEN  256 /*! max. Laenge des Dateinamens */
+
+/* Namen der vordefinierten Einstellungen fuer sndGetProfile() */
+#define SND_PROFILE_DEFAULT     "default"     /*! wie sndOpen(): 32 Frames x 128 */
+#define SND_PROFILE_LOW_LATENCY "low-latency" /*! kleine Perioden, ca. 9ms Puffer */
+#define SND_PROFILE_THROUGHPUT  "throughput"  /*! 4096 Frames je Periode, ca. 370ms */
+#define SND_PROFILE_POWER_SAVE  "power-save"  /*! wenige Wecker, ca. 1,5s Puffer */
 
 
 
 
 /* ----------------public, exported types ----------------------*/
 
+/*!
+ ************************************************************************
+  @par Description:
+    Laufzeitstatistik der Wiedergabe, siehe sndGetStats(). Damit laesst
+    sich die Puffergroesse unter Last bemessen: ist max_stall_ms laenger
+    als der Puffer der Soundkarte, gibt es einen Aussetzer (xrun).
+
+  @param xruns          - Anzahl der Unterlaeufe seit sndOpen()
+  @param max_stall_ms   - laengste Zeit zwischen zwei Schreibvorgaengen
+  @param delay_frames   - Frames, die noch bis zum Lautsprecher unterwegs sind
+  @param frames_written - insgesamt geschriebene Frames
+  @param silence_frames - nach Unterlaeufen eingefuegte Stille in Frames
+ ******************************************************************/
+typedef struct {
+    unsigned long xruns;          /*!<@arg Anzahl Unterlaeufe */
+    double max_stall_ms;          /*!<@arg laengste Pause zwischen Schreibvorgaengen */
+    long delay_frames;            /*!<@arg aktuelle Verzoegerung in Frames */
+    unsigned long frames_written; /*!<@arg geschriebene Frames */
+    unsigned long silence_frames; /*!<@arg eingefuegte Stille in Frames */
+} sndStats_t;
+
 #if (PLATFORM==OS_LINUX)
   typedef struct {
     int nChannels;  /*! number of channels 1:mono 2:stereo */
@@ -121,16 +161,42 @@
     snd_pcm_t *pcm_handle_playback; /*! Handle for the PCM playback device */
     snd_pcm_t *pcm_handle_capture;  /*! Handle for the PCM capture device */
     int buffer_size_frames;
+    int period_frames;             /*! tatsaechliche Periodenlaenge */
     int frame_size_bytes;
+    int use_mmap;                  /*! !=0: Wiedergabe im mmap-Modus */
+    snd_pcm_uframes_t mmap_offset; /*! Position des offenen sndMmapBegin() */
+    sndStats_t stats;              /*! Zaehler der Wiedergabe */
+    double last_write_ms;          /*! Zeitpunkt des letzten Schreibens, 0: noch keins */
   #endif // LINUX_ALSA
+    struct _sndSink *sink; /*! !=NULL: Null- oder Dateiausgabe statt Soundkarte */
   }SndDevice_t;
 #endif
 
+/*!
+ ************************************************************************
+  @par Description:
+    Puffereinstellung der Soundkarte fuer sndOpenEx(). Vor dem Aufruf
+    stehen die gewuenschten Werte drin, danach die, die das Geraet
+    tatsaechlich eingestellt hat.
+    Latenz = period_frames * periods / rate_Hz, die Anzahl der
+    Weckvorgaenge pro Sekunde ist rate_Hz / period_frames.
+
+  @param rate_Hz       - Abtastrate in Hz
+  @param period_frames - Frames (Wertepaare) pro Periode
+  @param periods       - Anzahl Perioden im Ringpuffer der Soundkarte
+ ******************************************************************/
+typedef struct {
+    unsigned int rate_Hz;        /*!<@arg Abtastrate in Hz */
+    unsigned int period_frames;  /*!<@arg Frames pro Periode */
+    unsigned int periods;        /*!<@arg Perioden im Ringpuffer */
+} sndConfig_t;
+
 #if (PLATFORM==OS_MS_WINDOWS)
   typedef struct {
       int nChannels;  /*! number of channels 1:mono 2:stereo */
       int rw_mode; /*! mode of sound device SND_READ_ONLY, SND_WRITE_ONLY, SND_READ_WRITE */
       void *pt;  /*! pointer to interal device struture */
+      struct _sndSink *sink; /*! !=NULL: Null- oder Dateiausgabe statt Soundkarte */
   }SndDevice_t;
 #endif
 
@@ -189,6 +255,121 @@ SndDevice_t *sndOpen(int rw_mode, int mono_stereo);
 
 
 
+/*!
+ ********************************************************************
+  @par Beschreibung:
+    Wie sndOpen(), aber mit waehlbarer Abtastrate und Puffergroesse.
+    In *cfg stehen vor dem Aufruf die gewuenschten Werte, danach die
+    ausgehandelten. cfg == NULL bedeutet SND_PROFILE_DEFAULT.
+    Beim Schreiben sollte man moeglichst ganze Perioden uebergeben.
+
+    Linux ALSA: Periodenlaenge, Periodenanzahl und Rate werden so nahe
+    wie moeglich eingestellt.
+    Linux OSS: die Periodenlaenge wird auf eine Zweierpotenz gerundet
+    (SNDCTL_DSP_SETFRAGMENT).
+    Windows: die Rate ist immer 44100Hz, es gibt 4 Puffer, deren Groesse
+    sich nach der beim Schreiben uebergebenen Blocklaenge richtet.
+
+  @see
+  @arg sndOpen, sndGetProfile
+
+  @param  rw_mode     - IN, SND_READ_ONLY, SND_WRITE_ONLY oder SND_READ_WRITE
+  @param  mono_stereo - IN, SND_MONO oder SND_STEREO
+  @param  cfg         - IN/OUT, gewuenschte/ausgehandelte Einstellung
+
+  @retval Zeiger auf Geraetestruktur oder NULL bei Fehler
+  @par Beispiel :
+  @verbatim
+    sndConfig_t cfg;
+    sndGetProfile(SND_PROFILE_LOW_LATENCY, &cfg);
+    psd = sndOpenEx(SND_WRITE_ONLY, SND_STEREO, &cfg);
+    printf("%u Frames x %u Perioden\n", cfg.period_frames, cfg.periods);
+  @endverbatim
+ ********************************************************************/
+SndDevice_t *sndOpenEx(int rw_mode, int mono_stereo, sndConfig_t *cfg);
+
+
+
+/*!
+ ********************************************************************
+  @par Beschreibung:
+    Liefert die Einstellung zu einem der Namen SND_PROFILE_DEFAULT,
+    SND_PROFILE_LOW_LATENCY, SND_PROFILE_THROUGHPUT oder
+    SND_PROFILE_POWER_SAVE, alle mit 44100Hz.
+
+  @param  name -  IN, Name der Einstellung
+  @param  cfg  -  OUT, Einstellung fuer sndOpenEx()
+
+  @retval 0 fuer ok, -1 bei unbekanntem Namen
+ ********************************************************************/
+int sndGetProfile(const char *name, sndConfig_t *cfg);
+
+
+
+/*!
+ ********************************************************************
+  @par Beschreibung:
+    Waehlt Geraet und Zugriffsart fuer alle folgenden Aufrufe von
+    sndOpen(). Ohne Aufruf gilt "default" und SND_ACCESS_RW.
+
+    Linux ALSA: pcm_name wird unveraendert an snd_pcm_open() gegeben,
+    es gehen also auch ALSA-Plugins wie "hw:0,0", "null" oder eine in
+    ~/.asoundrc definierte "file"-PCM. Laesst sich das Geraet nicht
+    oeffnen, nimmt sndOpen() die "null"-PCM (verwirft alle Daten),
+    damit Programme auch ohne Soundkarte laufen.
+    Bei SND_ACCESS_MMAP wird SND_PCM_ACCESS_MMAP_INTERLEAVED verlangt;
+    kann das Geraet das nicht, wird still auf SND_ACCESS_RW
+    zurueckgeschaltet.
+
+    Windows und OSS: pcm_name wird nicht ausgewertet, SND_ACCESS_MMAP
+    wird nicht unterstuetzt.
+
+  @see
+  @arg sndOpen, sndMmapBegin
+
+  @param  pcm_name -  IN, Geraetename, NULL laesst den Namen unveraendert
+  @param  access   -  IN, SND_ACCESS_RW oder SND_ACCESS_MMAP
+
+  @retval 0 fuer ok, -1 bei Fehler
+ ********************************************************************/
+int sndSetDevice(const char *pcm_name, int access);
+
+
+
+/*!
+ ********************************************************************
+  @par Beschreibung:
+    Waehlt das Ausgabeziel fuer alle folgenden Aufrufe von sndOpen()
+    und sndOpenEx(). Damit laeuft der Player auch ohne Soundkarte, z.B.
+    auf einem Build-Rechner:
+
+    SND_SINK_NULL verwirft die Daten, sndWrite() blockiert aber wie eine
+    Soundkarte mit period_frames * periods Frames Puffer, die Wiedergabe
+    dauert also so lange wie mit Soundkarte.
+    SND_SINK_NULL_FAST verwirft die Daten ohne zu warten, damit misst
+    man den reinen Durchsatz der Signalverarbeitung.
+    SND_SINK_WAV_FILE schreibt genau den Datenstrom, der sonst auf die
+    Soundkarte ginge, als 16 Bit PCM in die Datei filename. Die Laengen
+    im Header werden bei sndClose() eingetragen.
+
+    sndRead() liefert bei SND_SINK_NULL(_FAST) Nullen, bei
+    SND_SINK_WAV_FILE einen Fehler. sndMmapBegin() liefert immer -1,
+    geschrieben wird dann mit sndWrite(). sndGetStats() geht auf allen
+    Plattformen.
+
+  @see
+  @arg sndOpen, sndSetDevice
+
+  @param  sink     -  IN, SND_SINK_DEVICE, SND_SINK_NULL,
+                      SND_SINK_NULL_FAST oder SND_SINK_WAV_FILE
+  @param  filename -  IN, Ausgabedatei fuer SND_SINK_WAV_FILE, sonst NULL
+
+  @retval 0 fuer ok, -1 bei Fehler
+ ********************************************************************/
+int sndSetSink(int sink, const char *filename);
+
+
+
 /*!
  ********************************************************************
   @par Beschreibung:
@@ -337,12 +518,107 @@ int sndWrite(SndDevice_t *sd, short *buf, int buf_elements);
 
 
 
+/*!
+ ********************************************************************
+  @par Beschreibung:
+    Nur im mmap-Modus (siehe sndSetDevice): liefert einen Zeiger
+    direkt in den Ringpuffer der Soundkarte. Dort koennen bis zu
+    *nFrames Wertepaare (Stereo) bzw. Werte (Mono) geschrieben werden,
+    danach werden sie mit sndMmapCommit() freigegeben. Damit entfaellt
+    die Kopie, die sndWrite() macht.
+    Ist im Ringpuffer kein Platz, blockiert die Funktion, bis Platz
+    frei wird. Es werden hoechstens so viele Frames geliefert, wie am
+    Stueck bis zum Pufferende frei sind; fuer den Rest erneut aufrufen.
+
+  @see
+  @arg sndMmapCommit, sndSetDevice
+
+  @param  sd      -  Zeiger auf Geraetestruktur der geoffneten Soundkarte
+  @param  buf     -  OUT, Zeiger in den Ringpuffer
+  @param  nFrames -  IN: gewuenschte Anzahl Frames,
+                     OUT: tatsaechlich verfuegbare Anzahl Frames
+
+  @retval 0 fuer ok, -1 bei Fehler oder wenn das Geraet nicht im
+          mmap-Modus ist (dann sndWrite() verwenden)
+  @par Beispiel :
+  @verbatim
+    short *p;
+    int n = N_FRAMES;
+    if (0 == sndMmapBegin(psd, &p, &n))
+    {   ... n Frames nach p rechnen ...
+        sndMmapCommit(psd, n);
+    }
+  @endverbatim
+ ********************************************************************/
+int sndMmapBegin(SndDevice_t *sd, short **buf, int *nFrames);
+
+
+
+/*!
+ ********************************************************************
+  @par Beschreibung:
+    Gibt nFrames Frames, die nach sndMmapBegin() geschrieben wurden,
+    zur Wiedergabe frei. Startet die Wiedergabe, sobald der
+    Ringpuffer gefuellt ist.
+
+  @see
+  @arg sndMmapBegin
+
+  @param  sd      -  Zeiger auf Geraetestruktur der geoffneten Soundkarte
+  @param  nFrames -  IN, Anzahl geschriebener Frames, hoechstens so
+                     viele wie von sndMmapBegin() geliefert
+
+  @retval 0 fuer ok, -1 bei Fehler
+ ********************************************************************/
+int sndMmapCommit(SndDevice_t *sd, int nFrames);
+
+
+
+/*!
+ ********************************************************************
+  @par Beschreibung:
+    Liefert die Statistik der Wiedergabe. delay_frames wird beim
+    Aufruf bei der Soundkarte abgefragt, die uebrigen Werte zaehlen
+    sndWrite() und sndMmapCommit() mit.
+    Nach einem Unterlauf wird eine Periode Stille vorgeschrieben,
+    damit die Wiedergabe nicht sofort wieder leerlaeuft.
+
+    Nur Linux ALSA und Ausgabeziele von sndSetSink(), sonst -1.
+
+  @param  sd      -  Zeiger auf Geraetestruktur der geoffneten Soundkarte
+  @param  st      -  OUT, Statistik
+
+  @retval 0 fuer ok, -1 bei Fehler
+ ********************************************************************/
+int sndGetStats(SndDevice_t *sd, sndStats_t *st);
 
 
 
-/* WAV file routines for windows/linux. It is assumed,
-   that the WAV file has a simple header consisting of only a
-   format-chunk and a data-chunk, as is shown in the struct below:
+/*!
+ ********************************************************************
+  @par Beschreibung:
+    Wartet, bis alle geschriebenen Daten abgespielt sind, und macht
+    die Soundkarte fuer den naechsten Datenstrom bereit. Zwischen zwei
+    Dateien aufrufen, sonst zaehlt die Pause als Unterlauf.
+
+  @param  sd      -  Zeiger auf Geraetestruktur der geoffneten Soundkarte
+
+  @retval 0 fuer ok, -1 bei Fehler
+ ********************************************************************/
+int sndDrain(SndDevice_t *sd);
+
+
+
+
+
+
+/* WAV file routines for windows/linux. The struct below shows the
+   canonical 44 byte header consisting of only a format-chunk and a
+   data-chunk. sndWAVWriteFileHeader() writes exactly this layout.
+   When reading, the RIFF chunks of the file are walked, so files with
+   additional chunks (LIST, fact, bext, JUNK, ...) are accepted, too.
+   All fields have fixed widths, so the layout is the same on 32 bit,
+   LP64 and LLP64 platforms.
 */
 
 
@@ -374,26 +650,63 @@ int sndWrite(SndDevice_t *sd, short *buf, int buf_elements);
 
  ******************************************************************/
 typedef struct{
-    unsigned long main_chunk;   /*!<@arg  Textinhalt "RIFF" */
-    unsigned long length;       /*!<@arg  Gesamtlaenge der Datei */
-    unsigned long chunk_type;   /*!<@arg  Textinhalt "WAVE" */
-    unsigned long sub_chunk;    /*!<@arg  Textinhalt "fmt_" */
-    unsigned long sub_length;   /*!<@arg  Laenge sub_chunk, 16 Bytes */
-    unsigned short format;      /*!<@arg  1 = PCM */
-    unsigned short nChannels;   /*!<@arg  1 = MONO;
+    uint32_t main_chunk;   /*!<@arg  Textinhalt "RIFF" */
+    uint32_t length;       /*!<@arg  Gesamtlaenge der Datei */
+    uint32_t chunk_type;   /*!<@arg  Textinhalt "WAVE" */
+    uint32_t sub_chunk;    /*!<@arg  Textinhalt "fmt_" */
+    uint32_t sub_length;   /*!<@arg  Laenge sub_chunk, 16 Bytes */
+    uint16_t format;       /*!<@arg  1 = PCM */
+    uint16_t nChannels;    /*!<@arg  1 = MONO;
                            @arg  2 = STEREO */
-    unsigned long nSamplesPerSec;/*!<@arg Abtastfrequenz in Hz */
-    unsigned long nBytesPerSec;  /*!<@arg Datendurchsatz pro Sekunde */
-    unsigned short nBytesPerSample; /*!<@arg 1 = 8Bit-Mono
+    uint32_t nSamplesPerSec;/*!<@arg Abtastfrequenz in Hz */
+    uint32_t nBytesPerSec;  /*!<@arg Datendurchsatz pro Sekunde */
+    uint16_t nBytesPerSample; /*!<@arg 1 = 8Bit-Mono
                               @arg 2 = 8Bit-St. oder 16-Bit-Mono
                               @arg 4 = 16Bit-Stereo */
-    unsigned short nBitsPerSample;/*!<@arg  8 = 8 Bit per Sample
+    uint16_t nBitsPerSample;/*!<@arg  8 = 8 Bit per Sample
                              @arg 12 = 16 Bit per Sample
                              @arg 16 = 16 Bit per Sample */
-    unsigned long data_chunk;     /*!<@arg Testinhalt "data" */
-    unsigned long data_length;    /*!<@arg Leange Datenblock in Bytes*/
+    uint32_t data_chunk;     /*!<@arg Testinhalt "data" */
+    uint32_t data_length;    /*!<@arg Leange Datenblock in Bytes*/
 } sndWaveHeader_t;
 
+#define SND_WAV_MAX_CHUNKS 32  /*! max. Anzahl gemerkter RIFF-Chunks; bei mehr
+                                   fehlen hintere Metadaten-Chunks, "fmt "
+                                   und "data" sind immer dabei */
+
+/*!
+ ************************************************************************
+  @par Description:
+    Lage eines RIFF-Chunks in der Wave-Datei
+
+  @param id     - Chunk-Kennung, z.B. "fmt ", "data", "LIST", "bext"
+  @param offset - Byte-Offset der Chunk-Daten (hinter dem 8 Byte
+                  Chunk-Kopf) vom Dateianfang
+  @param length - Laenge der Chunk-Daten in Bytes (ohne Fuellbyte)
+ ******************************************************************/
+typedef struct{
+    char     id[4];    /*!<@arg Chunk-Kennung, nicht 0-terminiert */
+    uint32_t offset;   /*!<@arg Offset der Chunk-Daten in der Datei */
+    uint32_t length;   /*!<@arg Laenge der Chunk-Daten in Bytes */
+} sndWAVChunk_t;
+
+/*!
+ ************************************************************************
+  @par Description:
+    Verzeichnis aller Chunks einer Wave-Datei, wie es
+    sndWAVScanChunks() beim Durchlaufen der Datei anlegt.
+
+  @param nChunks   - Anzahl der Eintraege in chunk[]
+  @param fmtIndex  - Index des "fmt "-Chunks in chunk[]
+  @param dataIndex - Index des "data"-Chunks in chunk[]
+ ******************************************************************/
+typedef struct{
+    int nChunks;                              /*!<@arg Anzahl Eintraege */
+    int fmtIndex;                             /*!<@arg Index "fmt " */
+    int dataIndex;                            /*!<@arg Index "data" */
+    sndWAVChunk_t chunk[SND_WAV_MAX_CHUNKS];  /*!<@arg Chunks in Dateireihenfolge */
+} sndWAVChunkList_t;
+
 /*!
  ********************************************************************
   @par Description:
@@ -445,12 +758,11 @@ typedef struct{
     Funktion liest den Header aus der Wave-Datei mit Hilfe der Struktur
     sndWaveHeader_t.
 
-  @par Note: Diese Funktion geht davon aus, dass es nur einen
-    Format-Chunk und einen Data-Chunk der Wave-Datei gibt.
-    Das trifft nicht fuer jede Datei zu. In einer verbesserten
-    Version dieser Funktion muesste man den Datei-Header nach
-    dem Format-Chunk und dem Data-Chunk durchsuchen
-    und ggf. weitere Chunks ueberlesen.
+  @par Note: Die RIFF-Chunks der Datei werden mit sndWAVScanChunks()
+    durchlaufen, weitere Chunks (LIST, fact, bext, JUNK, ...) werden
+    ueberlesen. Danach steht der Dateizeiger am Anfang der
+    Sounddaten im Data-Chunk. wh enthaelt den kanonischen
+    44 Byte Header.
 
   @par Used by:
   @arg sndWAVPlaySound()
@@ -485,6 +797,162 @@ int sndWAVReadFileHeader(FILE *fp, sndWaveHeader_t *wh);
 
 
 
+/*!
+ *****************************************************************
+  @par Description:
+    Funktion durchlaeuft alle RIFF-Chunks der Wave-Datei, merkt sich
+    Kennung, Offset und Laenge jedes Chunks in cl und fuellt wh aus
+    dem Format-Chunk und dem Data-Chunk. Danach steht der Dateizeiger
+    am Anfang der Sounddaten. Mit sndWAVSeekData() kann spaeter ohne
+    erneutes Durchsuchen wieder dorthin positioniert werden.
+
+    WAVE_FORMAT_EXTENSIBLE mit PCM-Subformat wird als PCM (format=1)
+    gemeldet. Ist die Laengenangabe des Data-Chunks groesser als die
+    Datei (z.B. bei abgebrochener Aufnahme), wird sie gekuerzt.
+
+  @see
+  @arg sndWAVReadFileHeader(), sndWAVSeekData()
+
+  @param  fp -  IN, Zeiger auf die bereits geoeffnete Datei
+  @param  wh -  IN/OUT, Zeiger auf Struktur der Daten des Headers
+  @param  cl -  IN/OUT, Chunk-Verzeichnis, darf NULL sein
+
+  @retval 0 for ok, -1 on error
+
+  @par Beispiel :
+
+  @verbatim
+  sndWaveHeader_t wh;
+  sndWAVChunkList_t cl;
+  int i;
+  ...
+  if(0!=sndWAVScanChunks(fp, &wh, &cl))
+    puts("error in sndWAVScanChunks");
+  for(i=0; i<cl.nChunks; i++)
+    printf("%.4s: %lu Bytes\n", cl.chunk[i].id,
+           (unsigned long)cl.chunk[i].length);
+  ...
+  sndWAVSeekData(fp, &cl);  // zurueck zum Anfang der Sounddaten
+  @endverbatim
+ ********************************************************************/
+int sndWAVScanChunks(FILE *fp, sndWaveHeader_t *wh, sndWAVChunkList_t *cl);
+
+
+
+/*!
+ *****************************************************************
+  @par Description:
+    Positioniert den Dateizeiger auf den Anfang der Sounddaten,
+    wie sie zuvor von sndWAVScanChunks() gefunden wurden.
+
+  @see
+  @arg sndWAVScanChunks()
+
+  @param  fp -  IN, Zeiger auf die bereits geoeffnete Datei
+  @param  cl -  IN, Chunk-Verzeichnis aus sndWAVScanChunks()
+
+  @retval 0 for ok, -1 on error
+ ********************************************************************/
+int sndWAVSeekData(FILE *fp, const sndWAVChunkList_t *cl);
+
+
+
+#define SND_WAV_MAP_READAHEAD_FRAMES 65536  /*! Readahead-Fenster, ca. 1.5s bei 44.1kHz */
+
+/*!
+ ************************************************************************
+  @par Description:
+    Speicherabbildung einer Wave-Datei (siehe sndWAVMapFile). Die
+    Sounddaten koennen ohne Kopie direkt aus data gelesen werden,
+    Stereo-Daten liegen abwechselnd Links,Rechts (little endian).
+
+  @param wh      - Header, aus dem abgebildeten Dateikopf gelesen
+  @param cl      - Chunk-Verzeichnis der Datei
+  @param data    - Anfang der Sounddaten im Data-Chunk
+  @param nFrames - Anzahl der Abtastwerte / Abtastwertepaare
+ ******************************************************************/
+typedef struct{
+    sndWaveHeader_t wh;          /*!<@arg Header der Wavedatei */
+    sndWAVChunkList_t cl;        /*!<@arg Chunk-Verzeichnis */
+    const int16_t *data;         /*!<@arg Sounddaten, nur lesen */
+    uint32_t nFrames;            /*!<@arg Anzahl Abtastwerte(paare) */
+    const unsigned char *base;   /*!<@arg intern: Anfang der Abbildung */
+    uint32_t size;               /*!<@arg intern: Groesse der Abbildung */
+    uint32_t advisedFrames;      /*!<@arg intern: bis hier vorab angefordert */
+} sndWAVMap_t;
+
+
+/*!
+ *****************************************************************
+  @par Description:
+    Bildet eine Wave-Datei schreibgeschuetzt in den Speicher ab
+    (Linux: mmap, Windows: MapViewOfFile). Header und Chunk-
+    Verzeichnis werden aus der Abbildung gelesen, map->data zeigt
+    direkt auf die Sounddaten. Der Zugriff erfolgt ohne fread()
+    und ohne Kopie in einen eigenen Puffer. Linux: die Abbildung
+    wird als sequentiell markiert (MADV_SEQUENTIAL).
+
+  @see
+  @arg sndWAVUnmapFile(), sndWAVMapAdvise()
+
+  @param  Filename -  IN, Name der Wave-Datei
+  @param  map      -  IN/OUT, Beschreibung der Abbildung
+
+  @retval 0 for ok, -1 on error
+
+  @par Beispiel :
+
+  @verbatim
+  sndWAVMap_t map;
+  const sndStereo16_t *x;
+  uint32_t i;
+  ...
+  if(0!=sndWAVMapFile("madonna.wav", &map))
+    puts("error in sndWAVMapFile");
+  x = (const sndStereo16_t *) map.data;
+  for(i=0; i<map.nFrames; i++)
+  {  if((i % 4096) == 0) sndWAVMapAdvise(&map, i);
+     // Abtastwertepaar x[i] verarbeiten...
+  }
+  sndWAVUnmapFile(&map);
+  @endverbatim
+ ********************************************************************/
+int sndWAVMapFile(const char *Filename, sndWAVMap_t *map);
+
+
+/*!
+ *****************************************************************
+  @par Description:
+    Fordert die naechsten SND_WAV_MAP_READAHEAD_FRAMES Abtastwerte
+    ab framePos vorab an (Linux: MADV_WILLNEED), damit beim
+    Abspielen keine Seitenfehler auf die Platte warten muessen.
+    Ein neues Fenster wird erst angefordert, wenn die Haelfte des
+    vorherigen verbraucht ist. Unter Windows ohne Wirkung.
+
+  @param  map      -  IN/OUT, Beschreibung der Abbildung
+  @param  framePos -  IN, aktuelle Leseposition in Abtastwerten
+
+  @retval 0 for ok, -1 on error
+ ********************************************************************/
+int sndWAVMapAdvise(sndWAVMap_t *map, uint32_t framePos);
+
+
+/*!
+ *****************************************************************
+  @par Description:
+    Hebt die Abbildung einer Wave-Datei wieder auf.
+
+  @see
+  @arg sndWAVMapFile()
+
+  @param  map      -  IN/OUT, Beschreibung der Abbildung
+
+  @retval 0 for ok, -1 on error
+ ********************************************************************/
+int sndWAVUnmapFile(sndWAVMap_t *map);
+
+
+
 
 /*!
  *******************************************************************
@@ -523,6 +991,24 @@ int sndWAVWriteFileHeader(FILE *fp, sndWaveHeader_t wh);
 
 
 
+/*!
+ *******************************************************************
+  @par Description:
+    Fuellt den kanonischen 44 Byte Header fuer 16 Bit PCM, z.B. fuer
+    sndWAVWriteFileHeader().
+
+  @param wh          - OUT, Header
+  @param nChannels   - IN, 1 = Mono, 2 = Stereo
+  @param rate_Hz     - IN, Abtastfrequenz in Hz
+  @param data_length - IN, Laenge der Sounddaten in Bytes
+
+  @retval 0 for ok, -1 on error
+ **************************************************************/
+int sndWAVInitHeader16(sndWaveHeader_t *wh, int nChannels, uint32_t rate_Hz,
+                       uint32_t data_length);
+
+
+
 /*!
  **************************************************************
   @par Description:
@@ -907,6 +1393,66 @@ int sndWAVReadSampleStereo16(FILE *fp, sndStereo16_t *x);
 
 
 
+/*!
+ ******************************************************************
+  @par Description:
+    Funktion liest einen Block von bis zu nFrames 16Bit Stereo
+    Samplepaaren mit einem einzigen fread() aus der Wavedatei ein.
+    Gegenueber sndWAVReadSampleStereo16() entfaellt der
+    Bibliotheksaufruf pro Samplepaar.
+
+  @par Used by:
+
+  @see
+  @arg sndWAVReadSampleStereo16
+
+  @param fp      - IN, Zeiger auf bereits geoffnete Datei
+  @param x       - IN/OUT, Feld fuer mindestens nFrames Samplepaare
+  @param nFrames - IN, Anzahl der zu lesenden Samplepaare
+
+  @retval  Anzahl der gelesenen Samplepaare (0 am Dateiende),
+           -1: error
+
+  @par Beispiel :
+
+  @verbatim
+   sndStereo16_t x[1024];
+   int i, n;
+   FILE *fp;
+   ...
+   while(0 < (n = sndWAVReadBlockStereo16(fp, x, 1024)))
+   {  for(i=0; i<n; i++)
+      {  // Abtastwertepaar x[i] verarbeiten...
+      }
+   }
+    ...
+  @endverbatim
+ *****************************************************************/
+int sndWAVReadBlockStereo16(FILE *fp, sndStereo16_t *x, int nFrames);
+
+
+
+/*!
+ *****************************************************************
+  @par Description:
+    Gegenstueck zu sndWAVReadBlockStereo16(): schreibt nFrames
+    16 Bit Stereo Samplepaare mit einem einzigen fwrite() in die
+    Wavedatei. Den Header schreibt man vorher mit
+    sndWAVWriteFileHeader(), z.B. aus sndWAVInitHeader16().
+
+  @see
+  @arg sndWAVReadBlockStereo16, sndWAVInitHeader16
+
+  @param fp      - IN, Zeiger auf bereits geoffnete Datei
+  @param x       - IN, Feld mit nFrames Samplepaaren
+  @param nFrames - IN, Anzahl der zu schreibenden Samplepaare
+
+  @retval  Anzahl der geschriebenen Samplepaare, -1: error
+ *****************************************************************/
+int sndWAVWriteBlockStereo16(FILE *fp, const sndStereo16_t *x, int nFrames);
+
+
+
 
 
 
@@ -0,0 +1,245 @@
+/* spectrum_thread.c :
+   Spektrum-Analyzer, siehe spectrum_thread.h.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "spectrum_thread.h"
+#include "sram_snapshot.h"
+#include "fft.h"
+
+
+static PTL_ring_t tap;                /* Ausgabe -> Spektrum-Thread, float mono */
+static volatile int tapReady = 0;
+static PTL_atomic_t tapDropped = 0;
+
+/* Zuordnung der FFT-Bins zu den Baendern, einmal berechnet */
+typedef struct
+{   int kLo[N_SPEC_BANDS], kHi[N_SPEC_BANDS];  /* Bins kLo...kHi */
+    float f_Hz[N_SPEC_BANDS];
+    float norm;                   /* Binleistung -> Leistung relativ Vollaussteuerung */
+} spec_bands_t;
+
+/* Anzeige pro Band */
+typedef struct
+{   float avgP[N_SPEC_BANDS];     /* gemittelte Leistung */
+    float peak_dB[N_SPEC_BANDS];
+    float hold_s[N_SPEC_BANDS];   /* Restzeit, bis der Spitzenwert faellt */
+} spec_display_t;
+
+/* Prototyp der Funktionen, die der Thread nutzt */
+static void init_bands(spec_bands_t *b, double sumW2);
+static void analyse(const fft_plan_t *plan, const float *x, const float *win,
+                    const spec_bands_t *b, float *P_band);
+static void update_display(spec_display_t *d, const float *P_band, double dt);
+static void publish(const spec_bands_t *b, const spec_display_t *d);
+
+
+/*---------------------------------------------*/
+int SpecTapCreate(void)
+{
+    if (tapReady) return 0;
+    if (0 != PTL_RingCreate(&tap, sizeof(float), SPEC_TAP_FRAMES))
+    {   puts("SpecTapCreate: cannot create ring");
+        return -1;
+    }
+    tapReady = 1;
+    return 0;
+}
+
+/*---------------------------------------------*/
+void SpecTapWrite(const short *xy, int nFrames)
+{   float *p;
+    unsigned int n, i;
+
+    if (!tapReady) return;
+    while (nFrames > 0)
+    {   n = PTL_RingWriteReserve(&tap, nFrames, (void **)&p);
+        if (n == 0)
+        {   /* voll: Rest verwerfen, nicht warten */
+            PTL_AtomicStore(&tapDropped, PTL_AtomicLoad(&tapDropped) + nFrames);
+            return;
+        }
+        for (i = 0; i < n; i++) p[i] = 0.5f * ((float)xy[2*i] + (float)xy[2*i+1]);
+        PTL_RingWriteCommit(&tap, n);
+        xy += 2*n;
+        nFrames -= n;
+    }
+}
+
+/*---------------------------------------------*/
+unsigned long SpecTapGetDropped(void)
+{
+    return (unsigned long)PTL_AtomicLoad(&tapDropped);
+}
+
+
+/****************** Threadfunktion und Funktionen, die der Thread nutzt *****/
+PTL_THREAD_RET_TYPE SpectrumThreadFunc(void* pt)
+{   sRam_t parameter;  // fuer lokale Kopie des shared RAM
+    long generation = -1;
+    static float x[SPEC_FFT_SIZE];    /* die letzten SPEC_FFT_SIZE Werte */
+    static float win[SPEC_FFT_SIZE];
+    static float P_band[N_SPEC_BANDS];
+    static spec_bands_t bands;
+    static spec_display_t disp;
+    fft_plan_t plan;
+    float *p;
+    unsigned int n;
+    int nNew = 0, used, k;
+    double dt = (double)SPEC_HOP / F_S;
+    double t_last;
+
+    printf("SpectrumThreadFunc ist gestartet...");
+
+    if (0 != FFT_plan_create(&plan, SPEC_FFT_SIZE))
+    {   puts("SpectrumThreadFunc: kein FFT-Plan");
+        PTL_SemSignal(&endSema);
+        return 0;
+    }
+    init_bands(&bands, FFT_hann_window(win, SPEC_FFT_SIZE));
+    for (k = 0; k < N_SPEC_BANDS; k++)
+    {   disp.avgP[k] = 0;
+        disp.peak_dB[k] = SPEC_FLOOR_DB;
+        disp.hold_s[k] = 0;
+    }
+    publish(&bands, &disp);
+    t_last = PTL_GetTime();
+
+    do
+    {   sRamReadSnapshot(&parameter, &generation);
+
+        if (tapReady)
+        {   /* zu weit zurueck: alte Werte ueberspringen, nur das Neueste zaehlt */
+            used = PTL_RingGetUsedSlots(&tap);
+            while (used > SPEC_FFT_SIZE + SPEC_HOP)
+            {   n = PTL_RingReadReserve(&tap, used - SPEC_FFT_SIZE, (void **)&p);
+                PTL_RingReadCommit(&tap, n);
+                used -= n;
+                nNew = 0;
+            }
+            /* je SPEC_HOP neue Werte eine FFT */
+            while (0 < (n = PTL_RingReadReserve(&tap, SPEC_HOP - nNew, (void **)&p)))
+            {   memcpy(&x[SPEC_FFT_SIZE - SPEC_HOP + nNew], p, n * sizeof(float));
+                PTL_RingReadCommit(&tap, n);
+                nNew += n;
+                if (nNew == SPEC_HOP)
+                {   analyse(&plan, x, win, &bands, P_band);
+                    update_display(&disp, P_band, dt);
+                    publish(&bands, &disp);
+                    memmove(x, &x[SPEC_HOP], (SPEC_FFT_SIZE - SPEC_HOP) * sizeof(float));
+                    nNew = 0;
+                    t_last = PTL_GetTime();
+                }
+            }
+        }
+
+        /* nichts gespielt (die Ausgabe liefert sonst mindestens alle
+           93ms einen Block): Anzeige faellt wie bei Stille */
+        if (PTL_GetTime() - t_last > 0.25)
+        {   for (k = 0; k < N_SPEC_BANDS; k++) P_band[k] = 0;
+            update_display(&disp, P_band, dt);
+            publish(&bands, &disp);
+            t_last += dt;
+        }
+
+        PTL_Sleep(0.01);
+
+    } while(parameter.cmd_end == 0);
+
+    FFT_plan_destroy(&plan);
+    printf("SpectrumThreadFunc terminiert...");
+    PTL_SemSignal(&endSema);
+
+    return 0;
+}
+
+/*---------------------------------------------*/
+/* Band k reicht von SPEC_F_MIN*r^k bis SPEC_F_MIN*r^(k+1). Schmale Baender
+   unten, in die kein Bin faellt, nehmen den Bin, der der Mitte am naechsten ist */
+static void init_bands(spec_bands_t *b, double sumW2)
+{   double r = pow(SPEC_F_MAX / SPEC_F_MIN, 1.0 / N_SPEC_BANDS);
+    double df = (double)F_S / SPEC_FFT_SIZE;
+    double lo, hi;
+    int k;
+
+    for (k = 0; k < N_SPEC_BANDS; k++)
+    {   lo = SPEC_F_MIN * pow(r, k);
+        hi = lo * r;
+        b->f_Hz[k] = (float)(lo * sqrt(r));
+        b->kLo[k] = (int)ceil(lo / df);
+        b->kHi[k] = (int)ceil(hi / df) - 1;
+        if (b->kHi[k] < b->kLo[k])
+        {   b->kLo[k] = b->kHi[k] = (int)floor(b->f_Hz[k] / df + 0.5);
+        }
+        if (b->kHi[k] > SPEC_FFT_SIZE/2) b->kHi[k] = SPEC_FFT_SIZE/2;
+    }
+    /* Sinus mit Amplitude A: Summe der Binleistungen (positive Frequenzen)
+       = A^2 * N * sumW2 / 4, bezogen auf A = 32768 */
+    b->norm = (float)(4.0 / (SPEC_FFT_SIZE * sumW2 * 32768.0 * 32768.0));
+}
+
+/*---------------------------------------------*/
+/* Leistung je Band aus einem Block von SPEC_FFT_SIZE Werten */
+static void analyse(const fft_plan_t *plan, const float *x, const float *win,
+                    const spec_bands_t *b, float *P_band)
+{   static float re[SPEC_FFT_SIZE + 2], im[SPEC_FFT_SIZE/2 + 1];
+    double P;
+    int i, k;
+
+    for (i = 0; i < SPEC_FFT_SIZE; i++) re[i] = x[i] * win[i];
+    FFT_real_forward(plan, re, re, im);
+
+    for (k = 0; k < N_SPEC_BANDS; k++)
+    {   P = 0;
+        for (i = b->kLo[k]; i <= b->kHi[k]; i++) P += (double)re[i] * re[i] + (double)im[i] * im[i];
+        P_band[k] = (float)(P * b->norm);
+    }
+}
+
+/*---------------------------------------------*/
+static void update_display(spec_display_t *d, const float *P_band, double dt)
+{   float a = (float)(1.0 - exp(-dt / SPEC_AVG_S));
+    float L;
+    int k;
+
+    for (k = 0; k < N_SPEC_BANDS; k++)
+    {   d->avgP[k] += a * (P_band[k] - d->avgP[k]);
+
+        L = (P_band[k] > 1e-10f) ? 10 * log10f(P_band[k]) : SPEC_FLOOR_DB;
+        if (L >= d->peak_dB[k])
+        {   d->peak_dB[k] = L;
+            d->hold_s[k] = SPEC_PEAK_HOLD_S;
+        }
+        else if (d->hold_s[k] > 0)
+        {   d->hold_s[k] -= dt;
+        }
+        else
+        {   d->peak_dB[k] -= SPEC_PEAK_FALL_DB_S * dt;
+            if (d->peak_dB[k] < L) d->peak_dB[k] = L;
+        }
+    }
+}
+
+/*---------------------------------------------*/
+static void publish(const spec_bands_t *b, const spec_display_t *d)
+{   static spec_data_t s;
+    int k, changed;
+
+    for (k = 0; k < N_SPEC_BANDS; k++)
+    {   s.f_Hz[k] = b->f_Hz[k];
+        s.level_dB[k] = (d->avgP[k] > 1e-10f) ? 10 * log10f(d->avgP[k]) : SPEC_FLOOR_DB;
+        s.peak_dB[k] = d->peak_dB[k];
+    }
+
+    /* plotSema nur fuer das Umkopieren halten */
+    PTL_SemWait(&plotSema);
+    changed = (0 != memcmp(&spec_data, &s, sizeof(spec_data_t)));
+    if (changed) spec_data = s;
+    PTL_SemSignal(&plotSema);
+
+    /* bei Stille steht die Anzeige irgendwann: dann nicht neu zeichnen */
+    if (changed) PTL_AtomicStore(&plotDirty, 1);
+}
@@ -0,0 +1,49 @@
+/* spectrum_thread.h :
+   Spektrum des gespielten Signals fuer das Plotfenster.
+
+   Die Ausgabe des Players legt jeden Block, den sie an die Soundkarte
+   gibt, mit SpecTapWrite() als Mono-Signal (L+R)/2 in einen lock-freien
+   Ring (PTL_ring_t). Ist der Ring voll, weil der Analyzer nicht
+   nachkommt, werden die Werte verworfen: die Ausgabe wartet nie.
+
+   Der Spektrum-Thread holt SPEC_HOP Werte auf einmal, rechnet eine FFT
+   ueber die letzten SPEC_FFT_SIZE Werte (Hann-Fenster, 50% Ueberlappung)
+   und fasst die Leistung in N_SPEC_BANDS logarithmisch verteilte Baender
+   zusammen. Pro Band wird die Leistung mit SPEC_AVG_S gemittelt, der
+   Spitzenwert SPEC_PEAK_HOLD_S gehalten und faellt dann mit
+   SPEC_PEAK_FALL_DB_S. Ergebnis in spec_data (plotSema), bei Aenderung
+   wird plotDirty gesetzt.
+   Ein Sinus mit voller Aussteuerung zeigt etwa 0 dBFS.
+*/
+
+#ifndef _spectrum_thread_h_
+#define _spectrum_thread_h_
+
+#include "ptl_lib.h"
+#include "globals.h"
+
+#define SPEC_FFT_SIZE       4096          /* ca. 93ms, 10,8 Hz Aufloesung */
+#define SPEC_HOP            (SPEC_FFT_SIZE/2)
+#define SPEC_TAP_FRAMES     16384         /* Ring, Zweierpotenz, ca. 370ms */
+#define SPEC_F_MIN          20.0
+#define SPEC_F_MAX          20000.0
+#define SPEC_FLOOR_DB       (-100.0f)     /* Stille */
+#define SPEC_AVG_S          0.3           /* Zeitkonstante der Mittelung */
+#define SPEC_PEAK_HOLD_S    1.5
+#define SPEC_PEAK_FALL_DB_S 20.0
+
+/* Ring anlegen, einmal vor dem Start von Player und Spektrum-Thread.
+   Rueckgabe: 0 fuer ok, -1 bei Fehler (SpecTapWrite() tut dann nichts) */
+int SpecTapCreate(void);
+
+/* nFrames Wertepaare (Links,Rechts abwechselnd) abgeben, blockiert nie.
+   Nur aus einem Thread aufrufen (der Ausgabe des Players) */
+void SpecTapWrite(const short *xy, int nFrames);
+
+/* bisher verworfene Werte, weil der Ring voll war */
+unsigned long SpecTapGetDropped(void);
+
+/* Prototyp der Threadfunktion */
+PTL_THREAD_RET_TYPE SpectrumThreadFunc(void* pt);
+
+#endif
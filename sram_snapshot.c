@@ -0,0 +1,50 @@
+/* sram_snapshot.c :
+   Seqlock ueber eine Kopie des shared RAM. Die Echtzeit-Threads lesen
+   die Parameter ohne Semaphor, nur bei geaenderter Generation und nur
+   an Blockgrenzen.
+*/
+
+#include <string.h>
+
+#include "ptl_lib.h"
+#include "globals.h"
+#include "sram_snapshot.h"
+
+
+static sRam_t snapshot;           /* veroeffentlichte Kopie von sRam */
+static PTL_atomic_t sequence = 0; /* ungerade: Schreiber kopiert gerade */
+
+
+/*---------------------------------------------*/
+void sRamPublish(void)
+{
+    PTL_AtomicIncrement(&sequence);   /* ungerade: Leser muessen warten */
+    memcpy(&snapshot, &sRam, sizeof(sRam_t));
+    PTL_AtomicIncrement(&sequence);   /* gerade: neue Generation gueltig */
+}
+/*---------------------------------------------*/
+long sRamGetGeneration(void)
+{
+    return PTL_AtomicLoad(&sequence);
+}
+/*---------------------------------------------*/
+int sRamReadSnapshot(sRam_t *dst, long *generation)
+{   long s1, s2 = 0;
+
+    if (PTL_AtomicLoad(&sequence) == *generation)
+    {   return 0;   /* nichts geaendert, keine Kopie */
+    }
+    do
+    {   s1 = PTL_AtomicLoad(&sequence);
+        if (s1 & 1)
+        {   continue;  /* Schreiber kopiert gerade, nur wenige Bytes lang */
+        }
+        memcpy(dst, &snapshot, sizeof(sRam_t));
+        PTL_MemoryBarrier();
+        s2 = PTL_AtomicLoad(&sequence);
+    } while ((s1 & 1) || (s1 != s2));
+
+    *generation = s1;
+    return 1;
+}
+/*---------------------------------------------*/
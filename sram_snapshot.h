@@ -0,0 +1,29 @@
+/* sram_snapshot.h */
+
+#ifndef _sram_snapshot_h_
+#define _sram_snapshot_h_
+
+#include "globals.h"
+
+/* Lock-freie Kopie des shared RAM fuer die Echtzeit-Threads.
+
+   Schreiber (GUI-Callbacks, main) aendern sRam wie bisher unter
+   sRamSema und rufen vor PTL_SemSignal(&sRamSema) sRamPublish() auf.
+   Leser (Player, Plotter) holen sich mit sRamReadSnapshot() eine
+   konsistente Kopie, ohne je auf sRamSema zu warten. Die Kopie wird
+   nur gemacht, wenn sich die Generation seit dem letzten Aufruf
+   geaendert hat (Seqlock: ungerade Generation = Schreiber aktiv).
+*/
+
+/* sRam veroeffentlichen, nur mit gehaltenem sRamSema aufrufen */
+void sRamPublish(void);
+
+/* aktuelle Generation (gerade Zahl, steigt mit jedem sRamPublish) */
+long sRamGetGeneration(void);
+
+/* Kopie holen, falls *generation veraltet ist.
+   *generation vor dem ersten Aufruf auf -1 setzen.
+   Rueckgabe: 1 wenn dst aktualisiert wurde, 0 wenn unveraendert */
+int sRamReadSnapshot(sRam_t *dst, long *generation);
+
+#endif
@@ -5,26 +5,49 @@ WAV-Player mit integriertem Equalizer
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
 #include "ptl_lib.h"
 #include "snd_lib.h"
 #include "globals.h"
+#include "sram_snapshot.h"
 #include "player_thread.h"
 #include "plotter_thread.h"
+#include "spectrum_thread.h"
+#include "render.h"
+#include "batch.h"
+#include "fft.h"
+#include "conv.h"
+#include "fir_eq.h"
 #include "gui.h"
 
 /* globale Daten */
 sRam_t sRam;
+static int dither = 0;     /* Option -t, Startwert fuer sRam.flag_dither */
+static conv_ir_t ir;       /* Option -ir, Impulsantwort des Faltungshalls */
+static fir_eq_t fir_eq;    /* Entwuerfe des linearphasigen Equalizers */
 plot_data_t plot_data;
+spec_data_t spec_data;
 PTL_sem_t sRamSema;
 PTL_sem_t endSema;
 PTL_sem_t plotSema;
+PTL_atomic_t plotDirty = 1;
 
 /* Prototypen der Funktionen die main()  benutzt*/
 void CreateSemaphores(void);
 void InitGlobals(void);
+void InitSettings(void);
 void UserInterface(void);
 int  PrintMenue(void);
 void ExecuteMenue(int c);
+int  RenderMain(int argc, char *argv[]);
+int  RenderTestMain(int argc, char *argv[]);
+int  BatchMain(int argc, char *argv[]);
+int  FftBenchMain(void);
+int  ConvBenchMain(void);
+int  RingBenchMain(void);
+int  EqBenchMain(void);
+int  ReadBenchMain(int argc, char *argv[]);
 
 
 
@@ -33,14 +56,114 @@ void ExecuteMenue(int c);
 /*---------------------------------------------*/
 
 int main(int argc, char *argv[])
-{   PTL_thread_t ThreadID, PlotterThreadID;
+{   PTL_thread_t ThreadID, PlotterThreadID, SpectrumThreadID, FirEqThreadID;
+    int shift, access = SND_ACCESS_RW;
 
     printf("WAV-Player Version 2.0\n");
 
+    /* Optionen vor denen der GUI:
+         -q <n>    Tiefe der Player-Queues in Bloecken
+         -d <pcm>  Geraetename der Soundkarte (ALSA: z.B. hw:0,0 oder null)
+         -m        direkter Zugriff auf den Ringpuffer der Soundkarte (mmap)
+         -p <name> Puffereinstellung der Soundkarte: default, low-latency,
+                   throughput (Voreinstellung) oder power-save
+         -s null   ohne Soundkarte, Daten im Takt der Abtastrate verwerfen
+         -s fast   ohne Soundkarte, Daten so schnell wie moeglich verwerfen
+         -w <wav>  Ausgabe in eine WAV-Datei statt auf die Soundkarte
+         -t        TPDF-Dither bei der Wandlung nach 16 Bit
+         -ir <wav> Impulsantwort fuer den Faltungshall (16Bit mono/stereo)
+       oder, ohne GUI und Soundkarte:
+         -render <in.wav> <out.wav> [-j n] [-verify] [Einstellungen], siehe RenderMain()
+         -rendertest [dir]         parallel gegen am Stueck, siehe RenderTestMain()
+         -batch <outdir> <in>... [-j n] [Einstellungen], siehe BatchMain()
+         -fftbench                 Rechenzeit der FFT, siehe FftBenchMain()
+         -convbench                Faltungshall gegen FIR, siehe ConvBenchMain()
+         -ringbench                Player-Queues: Queue gegen Ring, siehe RingBenchMain()
+         -eqbench                  Rechenkerne des Equalizers, siehe EqBenchMain()
+         -readbench <wav>          Einlesen: Wertepaar, Block, Abbildung, siehe ReadBenchMain() */
+    if ((argc >= 4) && (0 == strcmp(argv[1], "-render")))
+    {   return RenderMain(argc, argv);
+    }
+    if ((argc >= 2) && (0 == strcmp(argv[1], "-rendertest")))
+    {   return RenderTestMain(argc, argv);
+    }
+    if ((argc >= 4) && (0 == strcmp(argv[1], "-batch")))
+    {   return BatchMain(argc, argv);
+    }
+    if ((argc >= 2) && (0 == strcmp(argv[1], "-fftbench")))
+    {   return FftBenchMain();
+    }
+    if ((argc >= 2) && (0 == strcmp(argv[1], "-convbench")))
+    {   return ConvBenchMain();
+    }
+    if ((argc >= 2) && (0 == strcmp(argv[1], "-ringbench")))
+    {   return RingBenchMain();
+    }
+    if ((argc >= 2) && (0 == strcmp(argv[1], "-eqbench")))
+    {   return EqBenchMain();
+    }
+    if ((argc >= 3) && (0 == strcmp(argv[1], "-readbench")))
+    {   return ReadBenchMain(argc, argv);
+    }
+    while ((argc >= 2) && (argv[1][0] == '-'))
+    {   if ((argc >= 3) && (0 == strcmp(argv[1], "-q")))
+        {   if (0 != PlayerSetQueueDepth(atoi(argv[2])))
+            {   printf("Queue-Tiefe 1...%d\n", PLAYER_QUEUE_DEPTH_MAX);
+                return -1;
+            }
+            shift = 2;
+        }
+        else if ((argc >= 3) && (0 == strcmp(argv[1], "-d")))
+        {   if (0 != sndSetDevice(argv[2], access)) return -1;
+            shift = 2;
+        }
+        else if ((argc >= 3) && (0 == strcmp(argv[1], "-p")))
+        {   if (0 != PlayerSetSoundProfile(argv[2]))
+            {   printf("Profile: %s, %s, %s, %s\n", SND_PROFILE_DEFAULT,
+                       SND_PROFILE_LOW_LATENCY, SND_PROFILE_THROUGHPUT,
+                       SND_PROFILE_POWER_SAVE);
+                return -1;
+            }
+            shift = 2;
+        }
+        else if ((argc >= 3) && (0 == strcmp(argv[1], "-s")))
+        {   if (0 == strcmp(argv[2], "null"))      sndSetSink(SND_SINK_NULL, NULL);
+            else if (0 == strcmp(argv[2], "fast")) sndSetSink(SND_SINK_NULL_FAST, NULL);
+            else
+            {   puts("-s null oder -s fast");
+                return -1;
+            }
+            shift = 2;
+        }
+        else if ((argc >= 3) && (0 == strcmp(argv[1], "-w")))
+        {   if (0 != sndSetSink(SND_SINK_WAV_FILE, argv[2])) return -1;
+            shift = 2;
+        }
+        else if ((argc >= 3) && (0 == strcmp(argv[1], "-ir")))
+        {   if (0 != CONV_load_ir(&ir, argv[2])) return -1;
+            printf("Impulsantwort: %d Werte, %d Stuecke\n", ir.nFrames, ir.nParts);
+            shift = 2;
+        }
+        else if (0 == strcmp(argv[1], "-t"))
+        {   dither = 1;
+            shift = 1;
+        }
+        else if (0 == strcmp(argv[1], "-m"))
+        {   access = SND_ACCESS_MMAP;
+            if (0 != sndSetDevice(NULL, access)) return -1;
+            shift = 1;
+        }
+        else break;     /* unbekannt: fuer die GUI stehen lassen */
+
+        argv[shift] = argv[0];  /* Option fuer die GUI entfernen */
+        argc -= shift;
+        argv += shift;
+    }
 
     /* globale Daten initialisieren, create semaphores */
     CreateSemaphores();
     InitGlobals();
+    SpecTapCreate();
     /* thread starten */
     if(0!=PTL_CreateThread(&ThreadID, WavPlayerThreadFunc, NULL))
     { puts("error starting thread");
@@ -50,6 +173,14 @@ int main(int argc, char *argv[])
     { puts("error starting thread");
       return -1;
     }
+    if(0!=PTL_CreateThread(&SpectrumThreadID, SpectrumThreadFunc, NULL))
+    { puts("error starting thread");
+      return -1;
+    }
+    if(0!=PTL_CreateThread(&FirEqThreadID, FirEqThreadFunc, NULL))
+    { puts("error starting thread");
+      return -1;
+    }
 
 
 #if 0
@@ -59,11 +190,16 @@ int main(int argc, char *argv[])
     PTL_SemWait(&sRamSema);
     sRam.cmd_play = 0;
     sRam.cmd_end  = 1;
+    sRamPublish();
     PTL_SemSignal(&sRamSema);
     puts("WAV-Player: main() wartet auf das Ende des Player-Threads...\n");
     PTL_SemWait(&endSema);
     puts("WAV-Player: main() wartet auf das Ende des Plotter-Threads...\n");
     PTL_SemWait(&endSema);
+    puts("WAV-Player: main() wartet auf das Ende des Spektrum-Threads...\n");
+    PTL_SemWait(&endSema);
+    puts("WAV-Player: main() wartet auf das Ende des FIR-Entwurfs...\n");
+    PTL_SemWait(&endSema);
     puts("WAV-Player: main() ist beendet...\n");
 #else
     gui(argc, argv);
@@ -86,17 +222,42 @@ void InitGlobals(void)
     strcpy(sRam.Dateiname, "");
     sRam.cmd_play = 0; // nicht spielen
     sRam.cmd_end  = 0; // Thread soll weiter laufen
+    InitSettings();
+
+    for(i=0; i< N_PLOT_POINTS; i++)
+    {   plot_data.f_Hz[i] = 0;
+        plot_data.H_dB[i] = 0;
+    }
+
+    /* Startwerte fuer die Echtzeit-Threads veroeffentlichen */
+    PTL_SemWait(&sRamSema);
+    sRamPublish();
+    PTL_SemSignal(&sRamSema);
+
+}
+/*---------------------------------------------*/
+/* Einstellungen der DSP-Kette in sRam: alle Stufen aus. Entwuerfe des
+   linearphasigen Equalizers aus einem frueheren Aufruf werden freigegeben */
+void InitSettings(void)
+{   int i;
+
     sRam.flag_EQ_is_active =0;   /*  ohne EQ */
     sRam.flag_Echo_is_active =0; /*  ohne Echo */
+    memset(&sRam.Echo, 0, sizeof(sRam.Echo));
+    sRam.Echo.nTaps = 1;         /* Tap 0 stellt die GUI ein */
     sRam.A_TP = 0;
     sRam.A_BP = 0;
     sRam.A_HP = 0;
     sRam.B = 1.0;
-
-    for(i=0; i< N_PLOT_POINTS; i++)
-    {   plot_data.f_Hz[i] = 0;
-        plot_data.H_dB[i] = 0;
-    }
+    sRam.flag_EQ_linear_phase = 0; /* TP/BP/HP als IIR-Filter */
+    for (i = 0; i < 2; i++)
+        if (fir_eq.slot[i].nFrames > 0) CONV_free_ir(&fir_eq.slot[i]);
+    FIR_EQ_init(&fir_eq);
+    sRam.FirEq = &fir_eq;
+    sRam.flag_dither = dither;   /* Option -t */
+    sRam.flag_Conv_is_active = 0; /* ohne Faltungshall */
+    sRam.Conv_wet = 0.3f;
+    sRam.Conv_IR = (ir.nFrames > 0) ? &ir : NULL;  /* Option -ir */
 
     sRam.TP.a1=0;
     sRam.TP.a2=0;
@@ -106,6 +267,10 @@ void InitGlobals(void)
     sRam.BP = sRam.TP;
     sRam.HP = sRam.TP;
 
+    /* parametrischer EQ: Terzband-EQ, alle Baender 0 dB, aus */
+    sRam.flag_PEQ_is_active = 0;
+    PEQ_graphic_bands(sRam.PEQ_band, PEQ_MAX_BANDS, 20.0, 20000.0, NULL);
+    PEQ_design(&sRam.PEQ, sRam.PEQ_band, PEQ_MAX_BANDS, F_S);
 }
 /*---------------------------------------------*/
 void UserInterface(void)
@@ -124,6 +289,9 @@ int  PrintMenue(void)
     printf("a: Name der WAV-Datei eingeben\n");
     printf("b: play\n");
     printf("c: stop\n");
+    printf("d: parametrischen EQ ein/aus\n");
+    printf("e: Band des parametrischen EQ einstellen\n");
+    printf("f: Fuellstand der Player-Queues, Statistik der Soundkarte, Latenz\n");
     printf("q: Programmende\n");
     printf("-------------------\n");
     printf(">:");
@@ -134,6 +302,9 @@ int  PrintMenue(void)
 /*---------------------------------------------*/
 void ExecuteMenue(int c)
 {   char Name[128];
+    peq_band_t band, old;
+    int k, dsp, out, depth;
+    sndStats_t st;
     switch(c)
     {   case 'a':
         case 'A': printf("Dateiname: ");
@@ -142,18 +313,59 @@ void ExecuteMenue(int c)
                   /* hier konnte man testen, ob es die Datei wirklich gibt ?!*/
                   PTL_SemWait(&sRamSema);
                   strcpy(sRam.Dateiname, Name);
+                  sRamPublish();
                   PTL_SemSignal(&sRamSema);
                   break;
         case 'b':
         case 'B': PTL_SemWait(&sRamSema);
                   sRam.cmd_play = 1;
+                  sRamPublish();
                   PTL_SemSignal(&sRamSema);
                   break;
         case 'c':
         case 'C': PTL_SemWait(&sRamSema);
                   sRam.cmd_play = 0;
+                  sRamPublish();
                   PTL_SemSignal(&sRamSema);
                   break;
+        case 'd':
+        case 'D': PTL_SemWait(&sRamSema);
+                  sRam.flag_PEQ_is_active = !sRam.flag_PEQ_is_active;
+                  printf("parametrischer EQ %s\n", sRam.flag_PEQ_is_active ? "ein" : "aus");
+                  sRamPublish();
+                  PTL_SemSignal(&sRamSema);
+                  break;
+        case 'e':
+        case 'E': printf("Band (0...%d), Typ (0 Glocke, 1/2 Kuhschwanz unten/oben, 3 TP, 4 HP, 5 Kerbe),\n"
+                         "f0/Hz, Q, Verstaerkung/dB: ", PEQ_MAX_BANDS-1);
+                  fflush(stdin);
+                  if (5 != scanf("%d %d %f %f %f", &k, &band.type, &band.f0_Hz, &band.Q, &band.gain_dB)
+                      || (k < 0) || (k >= PEQ_MAX_BANDS))
+                  {   puts("ungueltige Eingabe");
+                      break;
+                  }
+                  PTL_SemWait(&sRamSema);
+                  old = sRam.PEQ_band[k];
+                  sRam.PEQ_band[k] = band;
+                  if (0 != PEQ_design(&sRam.PEQ, sRam.PEQ_band, PEQ_MAX_BANDS, F_S))
+                  {   puts("ungueltige Bandparameter");
+                      /* Koeffizienten sind unveraendert, Einstellung zuruecknehmen */
+                      sRam.PEQ_band[k] = old;
+                  }
+                  sRamPublish();
+                  PTL_SemSignal(&sRamSema);
+                  break;
+        case 'f':
+        case 'F': depth = PlayerGetQueueLevels(&dsp, &out);
+                  if (depth < 0) puts("Player laeuft nicht");
+                  else printf("Queues: Leser->DSP %d/%d, DSP->Ausgabe %d/%d\n", dsp, depth, out, depth);
+                  k = PlayerGetDspLatency();
+                  printf("Latenz der DSP-Kette: %d Wertepaare (%.1f ms)\n", k, 1e3 * k / F_S);
+                  if (0 == PlayerGetSoundStats(&st))
+                      printf("Soundkarte: %lu Unterlaeufe, laengste Pause %.1f ms, "
+                             "Verzoegerung %ld Frames, %lu Frames Stille eingefuegt\n",
+                             st.xruns, st.max_stall_ms, st.delay_frames, st.silence_frames);
+                  break;
         case 'q':
         case 'Q': puts("Ende einleiten...");break;
         default:  printf("unbekanntes Kommando!");
@@ -161,4 +373,553 @@ void ExecuteMenue(int c)
     }
 }
 /*---------------------------------------------*/
+/* Einstellungen fuer -render und -batch, ab argv[i] bis zum Ende:
+     -tp <fu_Hz> <A_TP>          Tiefpass des Equalizers
+     -bp <f0_Hz> <Q> <A_BP>      Bandpass des Equalizers
+     -hp <fo_Hz> <A_HP>          Hochpass des Equalizers
+     -linphase                   Equalizer linearphasig als FIR-Filter,
+                                 Ausgabe um FIR_EQ_LATENCY verzoegert
+     -b <B>                      Gewichtung am Ausgang, 0...1
+     -peq <band> <gain_dB>       Band des parametrischen EQ, mehrfach
+     -echo <n0> <gain> <fb>      Echo, Tap 0, Verzoegerung in Abtastwerten
+     -dither                     TPDF-Dither bei der Wandlung nach 16 Bit
+     -tap <nL> <nR> <gain> <pan> weiterer Abgriff des Echos, mehrfach,
+                                 pan -1 (links) ... +1 (rechts)
+     -ir <wav> <wet>             Faltungshall mit dieser Impulsantwort,
+                                 Anteil wet 0...1
+   Wie in der GUI ist eine Stufe ohne Angabe aus. Ergebnis in sRam.
+   Semaphoren und globale Daten legt der Aufrufer einmal an
+   (CreateSemaphores, InitGlobals). */
+static int ParseRenderSettings(int argc, char *argv[], int i)
+{   fir_eq_target_t t;
+    int k;
+
+    /* nichts aus einem vorigen Aufruf mitnehmen (-rendertest) */
+    if (ir.nFrames > 0) CONV_free_ir(&ir);
+    InitSettings();
 
+    for (; i < argc; i++)
+    {   if ((i+2 < argc) && (0 == strcmp(argv[i], "-tp")))
+        {   sRam.TP = compute_TP_Filter_Parameters(atof(argv[i+1]), F_S);
+            sRam.A_TP = atof(argv[i+2]);
+            sRam.flag_EQ_is_active = 1;
+            i += 2;
+        }
+        else if ((i+3 < argc) && (0 == strcmp(argv[i], "-bp")))
+        {   sRam.BP = compute_BP_Filter_Parameters(atof(argv[i+1]), atof(argv[i+2]), F_S);
+            sRam.A_BP = atof(argv[i+3]);
+            sRam.flag_EQ_is_active = 1;
+            i += 3;
+        }
+        else if ((i+2 < argc) && (0 == strcmp(argv[i], "-hp")))
+        {   sRam.HP = compute_HP_Filter_Parameters(atof(argv[i+1]), F_S);
+            sRam.A_HP = atof(argv[i+2]);
+            sRam.flag_EQ_is_active = 1;
+            i += 2;
+        }
+        else if (0 == strcmp(argv[i], "-linphase"))
+        {   sRam.flag_EQ_linear_phase = 1;
+        }
+        else if ((i+1 < argc) && (0 == strcmp(argv[i], "-b")))
+        {   sRam.B = atof(argv[i+1]);
+            i += 1;
+        }
+        else if ((i+2 < argc) && (0 == strcmp(argv[i], "-peq")))
+        {   k = atoi(argv[i+1]);
+            if ((k < 0) || (k >= PEQ_MAX_BANDS))
+            {   printf("PEQ-Band 0...%d\n", PEQ_MAX_BANDS-1);
+                return -1;
+            }
+            sRam.PEQ_band[k].gain_dB = atof(argv[i+2]);
+            sRam.flag_PEQ_is_active = 1;
+            i += 2;
+        }
+        else if ((i+3 < argc) && (0 == strcmp(argv[i], "-echo")))
+        {   sRam.Echo.tap[0].delay_n[0] = atoi(argv[i+1]);
+            sRam.Echo.tap[0].delay_n[1] = atoi(argv[i+1]);
+            sRam.Echo.tap[0].gain       = atof(argv[i+2]);
+            sRam.Echo.feedback          = atof(argv[i+3]);
+            if ((sRam.Echo.tap[0].delay_n[0] < 0) || (sRam.Echo.tap[0].delay_n[0] > ECHO_MAX_DELAY))
+            {   printf("Echo-Verzoegerung 0...%d\n", ECHO_MAX_DELAY);
+                return -1;
+            }
+            sRam.flag_Echo_is_active = 1;
+            i += 3;
+        }
+        else if (0 == strcmp(argv[i], "-dither"))
+        {   sRam.flag_dither = 1;
+        }
+        else if ((i+4 < argc) && (0 == strcmp(argv[i], "-tap")))
+        {   if (sRam.Echo.nTaps >= ECHO_MAX_TAPS)
+            {   printf("hoechstens %d Taps\n", ECHO_MAX_TAPS);
+                return -1;
+            }
+            k = sRam.Echo.nTaps;
+            sRam.Echo.tap[k].delay_n[0] = atoi(argv[i+1]);
+            sRam.Echo.tap[k].delay_n[1] = atoi(argv[i+2]);
+            sRam.Echo.tap[k].gain       = atof(argv[i+3]);
+            sRam.Echo.tap[k].pan        = atof(argv[i+4]);
+            if ((sRam.Echo.tap[k].delay_n[0] < 0) || (sRam.Echo.tap[k].delay_n[0] > ECHO_MAX_DELAY)
+                || (sRam.Echo.tap[k].delay_n[1] < 0) || (sRam.Echo.tap[k].delay_n[1] > ECHO_MAX_DELAY)
+                || (sRam.Echo.tap[k].pan < -1) || (sRam.Echo.tap[k].pan > 1))
+            {   printf("Tap: Verzoegerung 0...%d, pan -1...1\n", ECHO_MAX_DELAY);
+                return -1;
+            }
+            sRam.Echo.nTaps++;
+            sRam.flag_Echo_is_active = 1;
+            i += 4;
+        }
+        else if ((i+2 < argc) && (0 == strcmp(argv[i], "-ir")))
+        {   if (ir.nFrames > 0) CONV_free_ir(&ir);
+            if (0 != CONV_load_ir(&ir, argv[i+1])) return -1;
+            sRam.Conv_IR  = &ir;
+            sRam.Conv_wet = atof(argv[i+2]);
+            sRam.flag_Conv_is_active = 1;
+            i += 2;
+        }
+        else
+        {   printf("unbekannte Einstellung: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (sRam.flag_PEQ_is_active &&
+        (0 != PEQ_design(&sRam.PEQ, sRam.PEQ_band, PEQ_MAX_BANDS, F_S)))
+    {   puts("parametrischer EQ: ungueltige Einstellung");
+        return -1;
+    }
+    /* ohne Entwerfer-Thread: einmal entwerfen, die Einstellung bleibt */
+    if (sRam.flag_EQ_is_active && sRam.flag_EQ_linear_phase)
+    {   FIR_EQ_set_target(&t, &sRam.TP, &sRam.BP, &sRam.HP, sRam.A_TP, sRam.A_BP, sRam.A_HP, sRam.B);
+        if (0 > FIR_EQ_update(&fir_eq, &t))
+        {   puts("linearphasiger Equalizer: Entwurf fehlgeschlagen");
+            return -1;
+        }
+        printf("Equalizer linearphasig: %d Taps, Latenz %d Wertepaare (%.1f ms), "
+               "max. %.2f dB Abweichung 20Hz...20kHz\n", FIR_EQ_TAPS, FIR_EQ_LATENCY,
+               1e3 * FIR_EQ_LATENCY / F_S, FIR_EQ_error_dB(&t, 20.0, 20000.0));
+    }
+
+    return 0;
+}
+/*---------------------------------------------*/
+/* Offline-Rendern:
+     -render <in.wav> <out.wav> [-j n] [-verify] [Einstellungen]
+   -j n:    Datei in n Segmenten parallel rechnen, 0: eines pro CPU,
+            ohne -j am Stueck, siehe RenderWAVFileParallel()
+   -verify: zusaetzlich am Stueck nach <out.wav>.seq.wav rechnen und
+            vergleichen, Fehler bei mehr als RenderParallelTolerance()
+   Einstellungen siehe ParseRenderSettings() */
+int RenderMain(int argc, char *argv[])
+{   const char *inName = argv[2], *outName = argv[3];
+    char refName[BATCH_NAME_LEN];
+    render_stats_t st, st_ref;
+    render_diff_t d;
+    int i = 4, nSegments = 1, verify = 0, tol, ret;
+
+    CreateSemaphores();
+    InitGlobals();
+    if ((i+1 < argc) && (0 == strcmp(argv[i], "-j")))
+    {   nSegments = atoi(argv[i+1]);
+        i += 2;
+    }
+    if ((i < argc) && (0 == strcmp(argv[i], "-verify")))
+    {   verify = 1;
+        i += 1;
+    }
+    if (0 != ParseRenderSettings(argc, argv, i)) return -1;
+
+    if (nSegments == 1) ret = RenderWAVFile(inName, outName, &sRam, &st);
+    else ret = RenderWAVFileParallel(inName, outName, &sRam, nSegments, &st);
+    if (0 != ret)
+    {   puts("Rendern fehlgeschlagen");
+        return -1;
+    }
+    printf("%s -> %s: %lu Wertepaare in %.3f s, %.1f-fache Echtzeit\n",
+           inName, outName, st.nFrames, st.seconds, st.realtime_factor);
+
+    if (verify)
+    {   snprintf(refName, sizeof(refName), "%s.seq.wav", outName);
+        if ((0 != RenderWAVFile(inName, refName, &sRam, &st_ref))
+            || (0 != RenderCompareWAV(refName, outName, &d)))
+        {   puts("Vergleich fehlgeschlagen");
+            return -1;
+        }
+        tol = RenderParallelTolerance(&sRam);
+        printf("am Stueck: %.3f s, Vorlauf %lu Wertepaare\n",
+               st_ref.seconds, RenderWarmupFrames(&sRam));
+        printf("Vergleich: %lu von %lu Wertepaaren abweichend, max. %d LSB (Grenze %d)",
+               d.nDiff, d.nFrames, d.maxDiff, tol);
+        if (d.nDiff > 0) printf(", erstes bei %lu", d.firstDiff);
+        printf("\n");
+        remove(refName);
+        if (d.maxDiff > tol)
+        {   printf("Abweichung groesser als %d LSB\n", tol);
+            return -1;
+        }
+    }
+    return 0;
+}
+/*---------------------------------------------*/
+/* Selbsttest fuer RenderWAVFileParallel():
+     -rendertest [dir]
+   schreibt ein Testsignal (Rauschen und 40 Hz, RENDER_TEST_SECONDS lang)
+   nach <dir>/rendertest_in.wav, rendert es fuer jede Einstellung aus
+   tests[] in RENDER_TEST_SEGMENTS Segmenten und am Stueck und prueft die
+   Abweichung gegen RenderParallelTolerance(). Die Dateien werden danach
+   geloescht. Rueckgabe -1, wenn eine Einstellung die Grenze verletzt. */
+#define RENDER_TEST_SECONDS  48
+#define RENDER_TEST_SEGMENTS 4
+
+int RenderTestMain(int argc, char *argv[])
+{   static const char *const tests[] = {
+        "-tp 20 10",
+        "-bp 30 50 10",
+        "-hp 20 10",
+        "-peq 0 12",
+        "-peq 0 -12 -peq 1 12",
+        "-peq 0 12 -peq 1 12 -peq 2 12 -peq 3 12 -peq 4 12 -peq 5 12 -peq 6 12",
+        "-tp 300 2 -bp 1000 2 3 -peq 5 6 -echo 8000 0.4 0.3 -b 0.5",
+        "-tp 300 2 -bp 1000 2 3 -peq 5 6 -echo 8000 0.4 0.3 -b 0.5 -dither" };
+    const char *dir = (argc >= 3) ? argv[2] : ".";
+    char inName[BATCH_NAME_LEN], parName[BATCH_NAME_LEN], seqName[BATCH_NAME_LEN];
+    char line[256], *targv[64], *tok;
+    sndStereo16_t x[1024];
+    sndWaveHeader_t wh;
+    render_diff_t d;
+    unsigned long n, nFrames = (unsigned long)RENDER_TEST_SECONDS * F_S;
+    unsigned int seed = 1;
+    FILE *fp;
+    int i, k, targc, tol, ret = 0;
+
+    CreateSemaphores();
+    InitGlobals();
+    snprintf(inName, sizeof(inName), "%s/rendertest_in.wav", dir);
+    snprintf(parName, sizeof(parName), "%s/rendertest_par.wav", dir);
+    snprintf(seqName, sizeof(seqName), "%s/rendertest_seq.wav", dir);
+
+    /* Testsignal: gleichverteiltes Rauschen und ein tiefer Sinus */
+    fp = fopen(inName, "wb");
+    if ((NULL == fp)
+        || (0 != sndWAVInitHeader16(&wh, SND_STEREO, F_S, (uint32_t)(nFrames * sizeof(sndStereo16_t))))
+        || (0 != sndWAVWriteFileHeader(fp, wh)))
+    {   printf("cannot write %s\n", inName);
+        if (NULL != fp) fclose(fp);
+        return -1;
+    }
+    for (n = 0; (n < nFrames) && (ret == 0); n += k)
+    {   k = (nFrames - n > 1024) ? 1024 : (int)(nFrames - n);
+        for (i = 0; i < k; i++)
+        {   seed = seed * 1103515245u + 12345u;
+            x[i].val_li = (short)((int)(seed >> 17) - 16384
+                                 + (int)(8000.0 * sin(2.0 * M_PI * 40.0 * (n + i) / F_S)));
+            seed = seed * 1103515245u + 12345u;
+            x[i].val_re = (short)((int)(seed >> 17) - 16384);
+        }
+        if (k != sndWAVWriteBlockStereo16(fp, x, k)) ret = -1;
+    }
+    if ((0 != fclose(fp)) || (ret != 0))
+    {   printf("cannot write %s\n", inName);
+        remove(inName);
+        return -1;
+    }
+
+    printf("%-72s %8s %7s %7s\n", "Einstellung", "Vorlauf", "max LSB", "Grenze");
+    for (i = 0; i < (int)(sizeof(tests) / sizeof(tests[0])); i++)
+    {   /* Einstellung wie auf der Kommandozeile zerlegen */
+        snprintf(line, sizeof(line), "%s", tests[i]);
+        targc = 0;
+        for (tok = strtok(line, " "); (NULL != tok) && (targc < 64); tok = strtok(NULL, " "))
+            targv[targc++] = tok;
+        if ((0 != ParseRenderSettings(targc, targv, 0))
+            || (0 != RenderWAVFileParallel(inName, parName, &sRam, RENDER_TEST_SEGMENTS, NULL))
+            || (0 != RenderWAVFile(inName, seqName, &sRam, NULL))
+            || (0 != RenderCompareWAV(seqName, parName, &d)))
+        {   printf("%-72s Fehler\n", tests[i]);
+            ret = -1;
+            continue;
+        }
+        tol = RenderParallelTolerance(&sRam);
+        printf("%-72s %8lu %7d %7d%s\n", tests[i], RenderWarmupFrames(&sRam), d.maxDiff, tol,
+               (d.maxDiff > tol) ? "  <- zu gross" : "");
+        if (d.maxDiff > tol) ret = -1;
+    }
+    remove(inName);
+    remove(parName);
+    remove(seqName);
+    if (ret != 0) puts("paralleles Rendern weicht ab!");
+    return ret;
+}
+/*---------------------------------------------*/
+/* Viele Dateien parallel rendern:
+     -batch <outdir> <in.wav|dir>... [-j n] [Einstellungen]
+   Verzeichnisse stehen fuer alle *.wav darin, die Ergebnisse landen
+   unter gleichem Namen in <outdir>. -j: Anzahl Worker-Threads,
+   Voreinstellung einer pro CPU. Einstellungen siehe ParseRenderSettings(). */
+int BatchMain(int argc, char *argv[])
+{   const char *outDir = argv[2];
+    batch_list_t l = {0};
+    batch_stats_t st;
+    batch_job_t *job;
+    int i, nWorkers = 0, ret;
+
+    CreateSemaphores();
+    InitGlobals();
+    for (i = 3; (i < argc) && (argv[i][0] != '-'); i++)
+    {   if (0 > BatchAddInput(&l, argv[i], outDir))
+        {   BatchFree(&l);
+            return -1;
+        }
+    }
+    if ((i+1 < argc) && (0 == strcmp(argv[i], "-j")))
+    {   nWorkers = atoi(argv[i+1]);
+        i += 2;
+    }
+    if ((l.nJobs == 0) || (0 != ParseRenderSettings(argc, argv, i)))
+    {   if (l.nJobs == 0) puts("keine WAV-Dateien gefunden");
+        BatchFree(&l);
+        return -1;
+    }
+
+    ret = BatchRun(&l, nWorkers, &sRam, &st);
+    for (i = 0; i < l.nJobs; i++)
+    {   job = &l.job[i];
+        if (0 != job->result)
+            printf("%s: Fehler\n", job->inName);
+        else
+            printf("%s -> %s: %.1f s Audio in %.3f s, %.1f-fache Echtzeit\n",
+                   job->inName, job->outName, job->st.audio_seconds,
+                   job->st.seconds, job->st.realtime_factor);
+    }
+    printf("%d Dateien, %d Fehler, %d Worker: %.1f s Audio in %.3f s, %.1f-fache Echtzeit\n",
+           st.nJobs, st.nFailed, st.nWorkers, st.audio_seconds, st.seconds, st.realtime_factor);
+    BatchFree(&l);
+    return ret;
+}
+/*---------------------------------------------*/
+/* Genauigkeit und Rechenzeit der FFT fuer alle Laengen FFT_MIN_SIZE ...
+   FFT_MAX_SIZE, komplex und reell. Genauigkeit: groesster Fehler gegen
+   die direkt gerechnete DFT, relativ zum groessten Bin; ab 8192 nur 64
+   Bins als Stichprobe. Dazu der Anteil einer CPU, den der Spektrum-
+   Analyzer mit dieser Laenge braucht (eine reelle FFT je halber Laenge) */
+int FftBenchMain(void)
+{   double e_c, e_r, us_c, us_r;
+    int n, ld, nCheck, ret = 0;
+
+    printf("%8s %10s %10s %11s %11s %13s %10s\n", "N", "Fehler c", "Fehler r",
+           "us komplex", "us reell", "ns/(N*ld N)", "Analyzer");
+    for (n = FFT_MIN_SIZE, ld = 6; n <= FFT_MAX_SIZE; n *= 2, ld++)
+    {   nCheck = (n <= 4096) ? 0 : 64;
+        e_c  = FFT_check_accuracy(n, 0, nCheck);
+        e_r  = FFT_check_accuracy(n, 1, nCheck);
+        us_c = FFT_benchmark(n, 0, 0.2);
+        us_r = FFT_benchmark(n, 1, 0.2);
+        printf("%8d %10.2e %10.2e %11.2f %11.2f %13.3f %9.3f%%%s\n", n, e_c, e_r, us_c, us_r,
+               1e3 * us_c / ((double)n * ld), 100.0 * us_r * 1e-6 * F_S / (n / 2),
+               (n == SPEC_FFT_SIZE) ? "  <- Analyzer" : "");
+        /* float: etwa 1e-7 * ld N, grosszuegig */
+        if ((e_c < 0) || (e_r < 0) || (e_c > 1e-5) || (e_r > 1e-5)) ret = -1;
+    }
+    if (ret != 0) puts("FFT ungenau!");
+    return ret;
+}
+/*---------------------------------------------*/
+/* Faltungshall gegen direkte FIR-Faltung fuer verschiedene Laengen der
+   Impulsantwort: Rechenzeit je Wertepaar (stereo), Anteil einer CPU bei
+   F_S und Abweichung der partitionierten von der direkten Faltung (bis
+   16384 Werte, darueber dauert die Referenz zu lange) */
+int ConvBenchMain(void)
+{   static const int len[] = { 256, 1024, 4096, 16384, 65536, CONV_MAX_IR_FRAMES };
+    double ns_d, ns_p, e;
+    int i, ret = 0;
+
+    printf("Block %d Wertepaare = %.1f ms Latenz\n", CONV_BLOCK, 1e3 * CONV_BLOCK / F_S);
+    printf("%8s %12s %12s %10s %10s %9s %10s\n", "Laenge", "ns direkt", "ns partit.",
+           "CPU dir.", "CPU part.", "Faktor", "Fehler");
+    for (i = 0; i < (int)(sizeof(len) / sizeof(len[0])); i++)
+    {   ns_d = CONV_benchmark(len[i], 1, 0.5);
+        ns_p = CONV_benchmark(len[i], 0, 0.5);
+        e = (len[i] <= 16384) ? CONV_check_accuracy(len[i], 4 * CONV_BLOCK + 2 * len[i]) : 0;
+        if ((ns_d < 0) || (ns_p < 0) || (e < 0))
+        {   printf("%8d Fehler\n", len[i]);
+            ret = -1;
+            continue;
+        }
+        printf("%8d %12.1f %12.1f %9.2f%% %9.2f%% %9.1f ", len[i], ns_d, ns_p,
+               100.0 * ns_d * 1e-9 * F_S, 100.0 * ns_p * 1e-9 * F_S, ns_d / ns_p);
+        if (len[i] <= 16384) printf("%10.2e\n", e);
+        else printf("%10s\n", "-");
+        if (e > 1e-5) ret = -1;
+    }
+    if (ret != 0) puts("Faltung ungenau!");
+    return ret;
+}
+/*---------------------------------------------*/
+/* Uebergabe der Player-Bloecke zwischen zwei Threads fuer verschiedene
+   Tiefen und Bloecke je Aufruf, Bloecke je Sekunde: PTL_queue_t (zwei
+   Kopien je Block), der Ring des Players (Semaphore nur bei vollem oder
+   leerem Ring, nur einzeln) und PTL_ring_t direkt mit Reserve/Commit.
+   Tiefen sind Zweierpotenzen, damit der Ring so gross ist wie die Queue.
+   Passt die Batchgroesse nicht in die Ringgroesse, muss der Ring am Ende
+   kuerzen ("Schnitte"), sonst ist das ein Fehler. Zum Vergleich: der
+   Player braucht bei F_S gut 10 Bloecke je Sekunde */
+int RingBenchMain(void)
+{   static const int test[][2] = {   /* Tiefe, Batch */
+        { 1, 1 }, { 2, 1 }, { 4, 1 }, { 16, 1 }, { PLAYER_QUEUE_DEPTH_MAX, 1 },
+        { 16, 3 }, { 16, 8 }, { PLAYER_QUEUE_DEPTH_MAX, PLAYER_BENCH_BATCH_MAX } };
+    double q, p, r;
+    long cuts;
+    int i, depth, batch, ret = 0;
+
+    printf("%6s %6s %13s %13s %13s %8s %8s %9s\n", "Tiefe", "Batch", "Queue Bl./s",
+           "Pipe Bl./s", "Ring Bl./s", "Pipe/Q", "Ring/Q", "Schnitte");
+    for (i = 0; i < (int)(sizeof(test) / sizeof(test[0])); i++)
+    {   depth = test[i][0];
+        batch = test[i][1];
+        q = PlayerQueueBenchmark(PLAYER_BENCH_QUEUE, depth, batch, 0.5, NULL);
+        p = (batch == 1) ? PlayerQueueBenchmark(PLAYER_BENCH_PIPE, depth, 1, 0.5, NULL) : 0;
+        r = PlayerQueueBenchmark(PLAYER_BENCH_RING, depth, batch, 0.5, &cuts);
+        if ((q <= 0) || (p < 0) || (r <= 0))
+        {   printf("%6d %6d Fehler\n", depth, batch);
+            ret = -1;
+            continue;
+        }
+        printf("%6d %6d %13.0f ", depth, batch, q);
+        if (batch == 1) printf("%13.0f ", p);
+        else            printf("%13s ", "-");
+        printf("%13.0f ", r);
+        if (batch == 1) printf("%8.2f ", p / q);
+        else            printf("%8s ", "-");
+        printf("%8.2f %9ld\n", r / q, cuts);
+        if (((depth % batch) != 0) && (cuts == 0))
+        {   printf("%6d %6d Ring nie am Ende gekuerzt\n", depth, batch);
+            ret = -1;
+        }
+    }
+    return ret;
+}
+/*---------------------------------------------*/
+/* Rechenkerne des Equalizers (TP/BP/HP, EQ_filter_block()) auf derselben
+   Eingabe: Wertepaare je Sekunde, Anteil einer CPU bei F_S und Abweichung
+   gegen die skalare Referenz, die 0 sein muss (gleiche Rechenreihenfolge) */
+int EqBenchMain(void)
+{   static const int kernel[] = { EQ_KERNEL_SCALAR, EQ_KERNEL_SSE, EQ_KERNEL_AVX };
+    double fps, fps_scalar = 0;
+    float d;
+    int i, ret = 0;
+
+    printf("%8s %14s %9s %8s %11s\n", "Kern", "Wertepaare/s", "CPU", "Faktor", "Abweichung");
+    for (i = 0; i < (int)(sizeof(kernel) / sizeof(kernel[0])); i++)
+    {   fps = EQ_benchmark(kernel[i], 0.5, &d);
+        if (fps < 0)
+        {   printf("%8s nicht verfuegbar\n", EQ_kernel_name(kernel[i]));
+            continue;
+        }
+        if (kernel[i] == EQ_KERNEL_SCALAR) fps_scalar = fps;
+        printf("%8s %14.0f %8.3f%% %8.2f %11.2e\n", EQ_kernel_name(kernel[i]), fps,
+               100.0 * F_S / fps, (fps_scalar > 0) ? fps / fps_scalar : 0.0, d);
+        if (d != 0.0f) ret = -1;
+    }
+    if (ret != 0) puts("Kerne rechnen verschieden!");
+    return ret;
+}
+/*---------------------------------------------*/
+/* Einlesen einer 16Bit-Stereo-Wavedatei, Wertepaare je Sekunde:
+     -readbench <wav>
+   sndWAVReadSampleStereo16() je Wertepaar, sndWAVReadBlockStereo16() mit
+   READ_BENCH_BLOCK Wertepaaren und die Speicherabbildung (sndWAVMapFile).
+   Jede Art liest die Datei ganz, so oft bis READ_BENCH_SECONDS um sind;
+   nach dem ersten Durchlauf liegt sie im Cache, gemessen wird also der
+   Aufwand der Aufrufe, nicht der Platte. Die Pruefsummen muessen gleich
+   sein. */
+#define READ_BENCH_BLOCK   1024
+#define READ_BENCH_SECONDS 0.5
+
+static unsigned long read_bench_sum(unsigned long sum, const sndStereo16_t *x, int n)
+{   int i;
+
+    for (i = 0; i < n; i++)
+        sum = sum * 31u + (unsigned short)x[i].val_li * 65537u + (unsigned short)x[i].val_re;
+    return sum;
+}
+
+int ReadBenchMain(int argc, char *argv[])
+{   static const char *const name[] = { "Wertepaar", "Block", "Abbildung" };
+    static sndStereo16_t x[READ_BENCH_BLOCK];
+    sndWAVChunkList_t cl;
+    sndWaveHeader_t wh;
+    sndWAVMap_t map;
+    unsigned long frames, sum[3], nFrames = 0;
+    double t0, t, fps[3];
+    uint32_t i;
+    FILE *fp;
+    int art, n, ret = 0;
+
+    (void)argc;
+    fp = fopen(argv[2], "rb");
+    if ((NULL == fp) || (0 != sndWAVScanChunks(fp, &wh, &cl)))
+    {   printf("cannot open %s\n", argv[2]);
+        if (NULL != fp) fclose(fp);
+        return -1;
+    }
+    if ((wh.nChannels != 2) || (wh.nBitsPerSample != 16))
+    {   puts("nur 16Bit Stereo");
+        fclose(fp);
+        return -1;
+    }
+    nFrames = sndWAVGetNumberOfSamples(wh);
+    printf("%s: %lu Wertepaare, %.1f s\n", argv[2], nFrames, (double)nFrames / wh.nSamplesPerSec);
+
+    for (art = 0; art < 3; art++)
+    {   fps[art] = -1;
+        sum[art] = 0;
+        if ((art == 2) && (0 != sndWAVMapFile(argv[2], &map))) continue;
+        frames = 0;
+        t0 = PTL_GetTime();
+        do
+        {   sum[art] = 0;
+            if (art == 0)
+            {   sndWAVSeekData(fp, &cl);
+                for (i = 0; (i < nFrames) && (0 == sndWAVReadSampleStereo16(fp, &x[0])); i++)
+                    sum[art] = read_bench_sum(sum[art], x, 1);
+            }
+            else if (art == 1)
+            {   sndWAVSeekData(fp, &cl);
+                for (i = 0; i < nFrames; i += n)
+                {   n = (nFrames - i > READ_BENCH_BLOCK) ? READ_BENCH_BLOCK : (int)(nFrames - i);
+                    n = sndWAVReadBlockStereo16(fp, x, n);
+                    if (n <= 0) break;
+                    sum[art] = read_bench_sum(sum[art], x, n);
+                }
+            }
+            else
+            {   i = map.nFrames;
+                sum[art] = read_bench_sum(0, (const sndStereo16_t *)map.data, (int)i);
+            }
+            if (i != nFrames)
+            {   printf("%s: nur %lu von %lu Wertepaaren gelesen\n", name[art], (unsigned long)i, nFrames);
+                ret = -1;
+                break;
+            }
+            frames += nFrames;
+            t = PTL_GetTime() - t0;
+        } while (t < READ_BENCH_SECONDS);
+        if (art == 2) sndWAVUnmapFile(&map);
+        if ((ret == 0) && (t > 0)) fps[art] = frames / t;
+    }
+    fclose(fp);
+
+    printf("%10s %14s %9s %8s %18s\n", "Art", "Wertepaare/s", "CPU", "Faktor", "Pruefsumme");
+    for (art = 0; art < 3; art++)
+    {   if (fps[art] <= 0)
+        {   printf("%10s nicht verfuegbar\n", name[art]);
+            continue;
+        }
+        printf("%10s %14.0f %8.3f%% %8.2f %18lx\n", name[art], fps[art],
+               100.0 * wh.nSamplesPerSec / fps[art],
+               (fps[0] > 0) ? fps[art] / fps[0] : 0.0, sum[art]);
+        if (sum[art] != sum[0]) ret = -1;
+    }
+    if (ret != 0) puts("Lesearten liefern verschiedene Daten!");
+    return ret;
+}
+/*---------------------------------------------*/